@@ -14,9 +14,9 @@ given in any order.
 #define texREPEAT 2
 #define texCLAMP 3
 
-void vecCopy(int dim, double v[], double copy[]);
-void vecAdd(int dim, double v[], double w[], double vPlusW[]);
-void vecScale(int dim, double c, double w[], double cTimesW[]);
+void vecCopy(int dim, vecReal v[], vecReal copy[]);
+void vecAdd(int dim, vecReal v[], vecReal w[], vecReal vPlusW[]);
+void vecScale(int dim, vecReal c, vecReal w[], vecReal cTimesW[]);
 
 typedef struct texTexture texTexture;
 /* Feel free to read from this struct's members, but don't write to them. */
@@ -26,9 +26,9 @@ struct texTexture {
   int filtering;     /* texQUADRATIC or texNEAREST */
   int topBottom;     /* texREPEAT or texCLAMP */
   int leftRight;     /* texREPEAT or texCLAMP */
-  double *data;      /* width * height * texelDim doubles, row-major order */
-  double *aux;       /* texelDim doubles, for use as scratch space */
-  double *sample;    /* texelDim doubles, where samples are returned */
+  vecReal *data;     /* width * height * texelDim numbers, row-major order */
+  vecReal *aux;      /* texelDim numbers, for use as scratch space */
+  vecReal *sample;   /* texelDim numbers, where samples are returned */
 };
 
 /*** Private ***/
@@ -42,7 +42,7 @@ struct texTexture {
 /* Sets all texels within the texture. Assumes that the texture has already
 been initialized. Assumes that texel has the same texel dimension as the
 texture. */
-void texClearTexels(texTexture *tex, double texel[]) {
+void texClearTexels(texTexture *tex, vecReal texel[]) {
   int index, bound, k;
   bound = tex->texelDim * tex->width * tex->height;
   for (index = 0; index < bound; index += tex->texelDim)
@@ -54,12 +54,12 @@ color. The width and height do not have to be powers of 2. Returns 0 if no
 error occurred. The user must remember to call texDestroy when finished with
 the texture. */
 int texInitializeSolid(texTexture *tex, int width, int height, int texelDim,
-                       double texel[]) {
+                       vecReal texel[]) {
   tex->width = width;
   tex->height = height;
   tex->texelDim = texelDim;
   tex->data =
-      (double *)malloc((width * height + 2) * texelDim * sizeof(double));
+      (vecReal *)malloc((width * height + 2) * texelDim * sizeof(vecReal));
   if (tex->data != NULL) {
     tex->aux = &(tex->data[tex->width * tex->height * tex->texelDim]);
     tex->sample = &(tex->aux[tex->texelDim]);
@@ -87,8 +87,8 @@ int texInitializeFile(texTexture *tex, const char *path) {
     return 1;
   } else {
     /* STB Image starts in the upper-left, while I want the lower-left. */
-    tex->data = (double *)malloc((tex->width * tex->height + 2) *
-                                 tex->texelDim * sizeof(double));
+    tex->data = (vecReal *)malloc((tex->width * tex->height + 2) *
+                                 tex->texelDim * sizeof(vecReal));
     if (tex->data != NULL) {
       tex->aux = &(tex->data[tex->width * tex->height * tex->texelDim]);
       tex->sample = &(tex->aux[tex->texelDim]);
@@ -137,7 +137,7 @@ void texSetLeftRight(texTexture *tex, int leftRight) {
 /* Gets a single texel within the texture. Assumes that the texture has already
 been initialized. Assumes that texel has the same texel dimension as the
 texture. */
-void texGetTexel(texTexture *tex, int s, int t, double texel[]) {
+void texGetTexel(texTexture *tex, int s, int t, vecReal texel[]) {
   int k;
   for (k = 0; k < tex->texelDim; k += 1)
     texel[k] = tex->data[(s + tex->width * t) * tex->texelDim + k];
@@ -146,7 +146,7 @@ void texGetTexel(texTexture *tex, int s, int t, double texel[]) {
 /* Sets a single texel within the texture. Assumes that the texture has already
 been initialized. Assumes that texel has the same texel dimension as the
 texture. */
-void texSetTexel(texTexture *tex, int x, int y, double texel[]) {
+void texSetTexel(texTexture *tex, int x, int y, vecReal texel[]) {
   if (0 <= x && x < tex->width && 0 <= y && y < tex->height &&
       tex->data != NULL) {
     int index, k;
@@ -165,7 +165,7 @@ void texDestroy(texTexture *tex) { free(tex->data); }
 and t parameters are texture coordinates. The texture itself is assumed to have
 texture coordinates [0, 1] x [0, 1]. Assumes that the texture has already been
 initialized. The result is placed in tex->sample for reading by the user. */
-void texSample(texTexture *tex, double s, double t) {
+void texSample(texTexture *tex, vecReal s, vecReal t) {
   /* Handle clamping vs. repeating. */
   if (tex->leftRight == texREPEAT)
     s = s - floor(s);
@@ -184,15 +184,15 @@ void texSample(texTexture *tex, double s, double t) {
       t = 1.0;
   }
   /* Handle nearest-neighbor vs. quadratic filtering. */
-  double u, v;
+  vecReal u, v;
   u = s * (tex->width - 1.0);
   v = t * (tex->height - 1.0);
   int i;
   if (tex->filtering == texQUADRATIC) {
-    double ufrac = u - floor(u);
-    double vfrac = v - floor(v);
+    vecReal ufrac = u - floor(u);
+    vecReal vfrac = v - floor(v);
 
-    double scalar = ufrac * vfrac;
+    vecReal scalar = ufrac * vfrac;
 
     texGetTexel(tex, (int)ceil(u), (int)ceil(v), tex->aux);
     vecScale(tex->texelDim, scalar, tex->aux, tex->sample);
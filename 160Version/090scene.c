@@ -4,20 +4,40 @@
 through the accessor functions. */
 typedef struct sceneNode sceneNode;
 struct sceneNode {
-  double *unif;
+  vecReal *unif;
   texTexture **tex;
   meshMesh *mesh;
   sceneNode *firstChild, *nextSibling;
+  /* An optional chain of levels of detail, finest first (see sceneSetLODs).
+  lod is the level chosen most recently, which mesh points to. */
+  int lodNum, lod;
+  meshMesh **lodMeshes;
+  vecReal *lodErrors;
+  /* Whether the node's own uniforms have changed since updateUniform last saw
+  them, and the renderer's viewingStamp when updateViewing last did. */
+  int dirty;
+  unsigned int viewingStamp;
+  /* The node's own store of transformed vertices, so that nodes that share a
+  mesh do not evict each other's (see meshRenderCached). */
+  meshCache cache;
 };
 
+/* A level of detail is fine enough while its error covers at most this many
+pixels on screen. */
+#define sceneLODTOLERANCE 1.0
+/* A node only moves to a coarser level once that level's error falls to this
+fraction of the tolerance, so that a node near the boundary between two levels
+does not flip between them from frame to frame. */
+#define sceneLODHYSTERESIS 0.7
+
 /* Initializes a sceneNode struct. Uniforms and texture pointers are copied
 into the node. Pointers to the mesh, first child, and next sibling are copied.
 The user must remember to call sceneDestroy or sceneDestroyRecursively when
 finished. Returns 0 if no error occurred. */
-int sceneInitialize(sceneNode *node, renRenderer *ren, double unif[],
+int sceneInitialize(sceneNode *node, renRenderer *ren, vecReal unif[],
                     texTexture **tex, meshMesh *mesh, sceneNode *firstChild,
                     sceneNode *nextSibling) {
-  node->unif = (double *)malloc(ren->unifDim * sizeof(double) +
+  node->unif = (vecReal *)malloc(ren->unifDim * sizeof(vecReal) +
                                 ren->texNum * sizeof(texTexture *));
   if (node->unif != NULL) {
     node->tex = (texTexture **)&(node->unif[ren->unifDim]);
@@ -27,6 +47,13 @@ int sceneInitialize(sceneNode *node, renRenderer *ren, double unif[],
     node->mesh = mesh;
     node->firstChild = firstChild;
     node->nextSibling = nextSibling;
+    node->lodNum = 0;
+    node->lod = 0;
+    node->lodMeshes = NULL;
+    node->lodErrors = NULL;
+    node->dirty = 1;
+    node->viewingStamp = ren->viewingStamp - 1;
+    meshCacheInitialize(&node->cache);
   }
   return (node->unif == NULL);
 }
@@ -34,10 +61,9 @@ int sceneInitialize(sceneNode *node, renRenderer *ren, double unif[],
 /* Adds a sibling to the given node. The sibling shows up as the youngest of
 its siblings. */
 void sceneAddSibling(sceneNode *node, sceneNode *sibling) {
-  if (node->nextSibling == NULL)
-    node->nextSibling = sibling;
-  else
-    sceneAddSibling(node->nextSibling, sibling);
+  while (node->nextSibling != NULL)
+    node = node->nextSibling;
+  node->nextSibling = sibling;
 }
 
 /* Adds a child to the given node. The child shows up as the youngest of its
@@ -49,10 +75,20 @@ void sceneAddChild(sceneNode *node, sceneNode *child) {
     sceneAddSibling(node->firstChild, child);
 }
 
-/* Copies the (ren->unifDim)-dimensional vector from unif into the node. */
-void sceneSetUniform(sceneNode *node, renRenderer *ren, double unif[]) {
+/* Copies the (ren->unifDim)-dimensional vector from unif into the node, and
+marks the node as moved, so that its modeling transformation and those of its
+descendants are worked out again at the next render. Uniforms must be changed
+through this function or sceneSetOneUniform for that to happen. */
+void sceneSetUniform(sceneNode *node, renRenderer *ren, vecReal unif[]) {
   int i;
   for (i = 0; i < ren->unifDim; i += 1) node->unif[i] = unif[i];
+  node->dirty = 1;
+}
+
+/* Sets the node's uniform at the given index, and marks the node as moved. */
+void sceneSetOneUniform(sceneNode *node, int index, vecReal unif) {
+  node->unif[index] = unif;
+  node->dirty = 1;
 }
 
 /* Sets the node's ith texture to the given one. */
@@ -61,34 +97,212 @@ void sceneSetTexture(sceneNode *node, renRenderer *ren, int i,
   if (0 <= i && i < ren->texNum) node->tex[i] = tex;
 }
 
+/* Gives the node a chain of lodNum levels of detail, which replaces its mesh.
+The meshes are ordered finest first, and errors[l] is the geometric error of
+meshes[l] (see meshSphereError etc.), which must grow with l. The pointers to
+the meshes are copied. The node starts at the finest level. Returns 0 if no
+error occurred. */
+int sceneSetLODs(sceneNode *node, int lodNum, meshMesh *meshes[],
+                 vecReal errors[]) {
+  meshMesh **lodMeshes = (meshMesh **)malloc(lodNum * sizeof(meshMesh *) +
+                                             lodNum * sizeof(vecReal));
+  if (lodMeshes == NULL)
+    return 1;
+  free(node->lodMeshes);
+  node->lodMeshes = lodMeshes;
+  node->lodErrors = (vecReal *)&lodMeshes[lodNum];
+  int l;
+  for (l = 0; l < lodNum; l += 1) {
+    node->lodMeshes[l] = meshes[l];
+    node->lodErrors[l] = errors[l];
+  }
+  node->lodNum = lodNum;
+  node->lod = 0;
+  node->mesh = meshes[0];
+  return 0;
+}
+
+/* Returns how far the node's mesh is from the camera, judged by the center of
+its bounding box, sent through transformVertex with the node's uniforms. Under
+perspective that is the clip space W; under orthographic projection, where W is
+always 1, it is -Z. */
+vecReal sceneDepth(sceneNode *node, renRenderer *ren) {
+  vecReal vary[renVARYDIMBOUND];
+  vecReal *center = meshGetCenter(node->mesh);
+  if (center == NULL)
+    return 0.0;
+  ren->transformVertex(ren, node->unif, center, vary);
+  if (ren->projectionType == renPERSPECTIVE)
+    return vary[renVARYW];
+  return -vary[renVARYZ];
+}
+
+/* Returns how many pixels on screen one unit spans, at the given depth (see
+sceneDepth), assuming that the modeling transformations do not scale. */
+vecReal scenePixelsPerUnit(renRenderer *ren, vecReal depth) {
+  vecReal height = ren->projection[renPROJT] - ren->projection[renPROJB];
+  if (ren->projectionType == renPERSPECTIVE)
+    return renGetViewportHeight(ren) * -ren->projection[renPROJN] /
+           (height * depth);
+  return renGetViewportHeight(ren) / height;
+}
+
+/* Chooses the node's level of detail from the current camera, using the
+node's uniforms as they stand, and returns the mesh to draw. The coarsest level
+whose error covers at most sceneLODTOLERANCE pixels is chosen, but with
+hysteresis toward the level chosen last time. depth is the node's depth, as
+sceneDepth gives it; nodes without a chain of levels ignore it and just return
+their mesh. */
+meshMesh *sceneChooseLOD(sceneNode *node, renRenderer *ren, vecReal depth) {
+  if (node->lodNum == 0)
+    return node->mesh;
+  int lod = node->lod;
+  if (ren->projectionType == renPERSPECTIVE && depth <= 0.0)
+    /* The camera is inside or past the node, so nothing can be spared. */
+    lod = 0;
+  else {
+    vecReal pixels = scenePixelsPerUnit(ren, depth);
+    while (lod > 0 && node->lodErrors[lod] * pixels > sceneLODTOLERANCE)
+      lod -= 1;
+    while (lod + 1 < node->lodNum && node->lodErrors[lod + 1] * pixels <=
+           sceneLODTOLERANCE * sceneLODHYSTERESIS)
+      lod += 1;
+  }
+  node->lod = lod;
+  node->mesh = node->lodMeshes[lod];
+  return node->mesh;
+}
+
+/* Brings the node's uniforms up to date, given that unifParent has changed
+since the last render if parentMoved. Returns whether the node's modeling
+transformation changed. Without updateViewing (see renSetUpdateViewing),
+updateUniform does everything, so it runs every time. */
+int sceneUpdate(sceneNode *node, renRenderer *ren, vecReal *unifParent,
+                int parentMoved) {
+  int moved = parentMoved || node->dirty || ren->updateViewing == NULL;
+  if (moved) {
+    ren->updateUniform(ren, node->unif, unifParent);
+    node->dirty = 0;
+  }
+  if (ren->updateViewing != NULL && node->viewingStamp != ren->viewingStamp) {
+    ren->updateViewing(ren, node->unif);
+    node->viewingStamp = ren->viewingStamp;
+  }
+  return moved;
+}
+
+/* Does the work of sceneRender, with parentMoved as in sceneUpdate. Each
+younger sibling gets the uniforms of the sibling before it as its parent's.
+Only children are reached by recursion; siblings are walked in a loop, so that
+long lists of siblings do not make deep recursion. */
+void sceneRenderTree(sceneNode *node, renRenderer *ren, vecReal *unifParent,
+                     int parentMoved) {
+  for (; node != NULL; node = node->nextSibling) {
+    int moved = sceneUpdate(node, ren, unifParent, parentMoved);
+    vecReal depth = (node->lodNum > 0) ? sceneDepth(node, ren) : 0.0;
+    meshRenderCached(sceneChooseLOD(node, ren, depth), &node->cache, ren,
+                     node->unif, node->tex);
+    if (node->firstChild != NULL)
+      sceneRenderTree(node->firstChild, ren, node->unif, moved);
+    unifParent = node->unif;
+    parentMoved = moved;
+  }
+}
+
 /* Renders the node, its younger siblings, and their descendants. If the node
 has no parent, then unifParent is NULL. Otherwise, unifParent is the parent
-node's uniform vector. */
-void sceneRender(sceneNode *node, renRenderer *ren, double *unifParent) {
-  /* Your job is to implement this function!! */
-  ren->updateUniform(ren, node->unif, unifParent);
-  // printf("%f\n",node->unif[renUNIFRHO]);
-  //printf("rendering mesh\n");
-  meshRender(node->mesh, ren, node->unif, node->tex);
-  //printf("mesh rendered\n");
-
-  if (node->firstChild != NULL) {
-    sceneRender(node->firstChild, ren, node->unif);
+node's uniform vector, which is assumed to have changed. Only the nodes that
+have moved, or whose ancestors have, get their modeling transformations worked
+out again (see sceneUpdate). */
+void sceneRender(sceneNode *node, renRenderer *ren, vecReal *unifParent) {
+  sceneRenderTree(node, ren, unifParent, unifParent != NULL);
+}
+
+/* One node of the scene, as sceneRenderFrontToBack queues it up. */
+typedef struct sceneItem sceneItem;
+struct sceneItem {
+  sceneNode *node;
+  meshMesh *mesh;   /* at the level of detail chosen for this frame */
+  vecReal depth;    /* distance from the camera; smaller is nearer */
+  int order;        /* place in the order in which sceneRender draws */
+};
+
+/* Returns the number of nodes among the node, its younger siblings, and their
+descendants. */
+int sceneCount(sceneNode *node) {
+  int count = 0;
+  for (; node != NULL; node = node->nextSibling) {
+    count += 1;
+    if (node->firstChild != NULL)
+      count += sceneCount(node->firstChild);
   }
+  return count;
+}
+
+/* Updates the uniforms of the node, its younger siblings, and their
+descendants, in exactly the order and with exactly the parents that
+sceneRender uses, and appends them to items. parentMoved is as in
+sceneUpdate. */
+void sceneCollect(sceneNode *node, renRenderer *ren, vecReal *unifParent,
+                  int parentMoved, sceneItem items[], int *itemNum) {
+  for (; node != NULL; node = node->nextSibling) {
+    int moved = sceneUpdate(node, ren, unifParent, parentMoved);
+    vecReal depth = sceneDepth(node, ren);
+    items[*itemNum].node = node;
+    items[*itemNum].mesh = sceneChooseLOD(node, ren, depth);
+    items[*itemNum].depth = depth;
+    items[*itemNum].order = *itemNum;
+    *itemNum += 1;
+    if (node->firstChild != NULL)
+      sceneCollect(node->firstChild, ren, node->unif, moved, items, itemNum);
+    unifParent = node->unif;
+    parentMoved = moved;
+  }
+}
 
-  if (node->nextSibling != NULL) {
-    sceneRender(node->nextSibling, ren, node->unif);
+int sceneCompareItems(const void *a, const void *b) {
+  const sceneItem *x = (const sceneItem *)a, *y = (const sceneItem *)b;
+  if (x->depth != y->depth)
+    return (x->depth < y->depth) ? -1 : 1;
+  return x->order - y->order;
+}
+
+/* Renders the same nodes as sceneRender, with the same uniforms, but nearest
+first, so that the depth test rejects more of the farther nodes before they
+are shaded. Every node is opaque, since the renderer does not blend. All of
+the uniforms are updated first, in sceneRender's order, and then the meshes
+are drawn. */
+void sceneRenderFrontToBack(sceneNode *node, renRenderer *ren,
+                            vecReal *unifParent) {
+  int itemNum = 0, i;
+  sceneItem *items = (sceneItem *)malloc(sceneCount(node) * sizeof(sceneItem));
+  if (items == NULL) {
+    sceneRender(node, ren, unifParent);
+    return;
   }
+  sceneCollect(node, ren, unifParent, unifParent != NULL, items, &itemNum);
+  qsort(items, itemNum, sizeof(sceneItem), sceneCompareItems);
+  for (i = 0; i < itemNum; i += 1)
+    meshRenderCached(items[i].mesh, &items[i].node->cache, ren,
+                     items[i].node->unif, items[i].node->tex);
+  free(items);
 }
 
 /* Deallocates the resources backing this scene node. Does not destroy the
-resources backing the mesh or textures. */
-void sceneDestroy(sceneNode *node) { free(node->unif); }
+resources backing the meshes or textures. */
+void sceneDestroy(sceneNode *node) {
+  free(node->unif);
+  free(node->lodMeshes);
+  meshCacheDestroy(&node->cache);
+}
 
-/* Calls sceneDestroy recursively on the node's descendants and younger
-siblings, and then on the node itself. */
+/* Calls sceneDestroy on the node, its younger siblings, and their
+descendants. Only the descendants are reached by recursion. */
 void sceneDestroyRecursively(sceneNode *node) {
-  if (node->firstChild != NULL) sceneDestroyRecursively(node->firstChild);
-  if (node->nextSibling != NULL) sceneDestroyRecursively(node->nextSibling);
-  sceneDestroy(node);
+  while (node != NULL) {
+    sceneNode *next = node->nextSibling;
+    if (node->firstChild != NULL) sceneDestroyRecursively(node->firstChild);
+    sceneDestroy(node);
+    node = next;
+  }
 }
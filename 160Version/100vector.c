@@ -4,11 +4,24 @@
 This file specifies the interfaces for various vector functions.
 */
 
+/*** Scalar type ***/
+
+/* The type of the numbers in every vector and matrix, and so in the vertices,
+uniforms, varyings and texels that are built from them. It is float, which
+halves the memory that they take and doubles the number of them that fit in a
+SIMD register. Compile with -DvecDOUBLE to make it double, for checking the
+float build against. */
+#ifdef vecDOUBLE
+typedef double vecReal;
+#else
+typedef float vecReal;
+#endif
+
 /*** In general dimensions ***/
 
 /* Assumes that there are dim + 2 arguments, the last dim of which are doubles.
 Sets the dim-dimensional vector v to those doubles. */
-void vecSet(int dim, double v[], ...){
+void vecSet(int dim, vecReal v[], ...){
 
 	va_list argumentPointer;
 	va_start(argumentPointer,v);
@@ -20,36 +33,36 @@ void vecSet(int dim, double v[], ...){
 }
 
 /* Copies the dim-dimensional vector v to the dim-dimensional vector copy. */
-void vecCopy(int dim, double v[], double copy[]) {
+void vecCopy(int dim, vecReal v[], vecReal copy[]) {
 	for (int i = 0; i < dim; i++) {
 		copy[i] = v[i];
 	}
 }
 
 /* Adds the dim-dimensional vectors v and w. */
-void vecAdd(int dim, double v[], double w[], double vPlusW[]) {
+void vecAdd(int dim, vecReal v[], vecReal w[], vecReal vPlusW[]) {
 	for (int i = 0; i < dim; i++) {
 		vPlusW[i] = v[i] + w[i];
 	}
 }
 
 /* Subtracts the dim-dimensional vectors v and w. */
-void vecSubtract(int dim, double v[], double w[], double vMinusW[]) {
+void vecSubtract(int dim, vecReal v[], vecReal w[], vecReal vMinusW[]) {
 	for (int i = 0; i < dim; i++) {
 		vMinusW[i] = v[i] - w[i];
 	}
 }
 
 /* Scales the dim-dimensional vector w by the number c. */
-void vecScale(int dim, double c, double w[], double cTimesW[]) {
+void vecScale(int dim, vecReal c, vecReal w[], vecReal cTimesW[]) {
 	for (int i = 0; i < dim; i++) {
 		cTimesW[i] = c * w[i];
 	}
 }
 
 /* Returns the dot product of the dim-dimensional vectors v and w. */
-double vecDot(int dim, double v[], double w[]) {
-	double sum = 0.0;
+vecReal vecDot(int dim, vecReal v[], vecReal w[]) {
+	vecReal sum = 0.0;
 	for (int i = 0; i < dim; i++) {
 		sum += v[i]*w[i];
 	}
@@ -57,27 +70,161 @@ double vecDot(int dim, double v[], double w[]) {
 }
 
 /* Returns the length of the dim-dimensional vector v. */
-double vecLength(int dim, double v[]) {
+vecReal vecLength(int dim, vecReal v[]) {
 	return sqrt(vecDot(dim, v, v));
 }
 
 /* Returns the length of the dim-dimensional vector v. If the length is
 non-zero, then also places a scaled version of v into the dim-dimensional
 vector unit, so that unit has length 1. */
-double vecUnit(int dim, double v[], double unit[]) {
-	double len = vecLength(dim, v);
+vecReal vecUnit(int dim, vecReal v[], vecReal unit[]) {
+	vecReal len = vecLength(dim, v);
 	if (len == 0.0) {
 		return len;
 	} else {
-		double frac = 1/len;
+		vecReal frac = 1/len;
 		vecScale(dim, frac, v, unit);
 		return len;
 	}
 }
 
+/*** In specific dimensions ***/
+
+/* These do what the general functions above do, for vectors of 2, 3 or 4
+numbers. They are inline and have no loops, so that in a shader, which runs
+once per pixel, the compiler can keep the vectors in registers. */
+
+static inline void vec2Set(vecReal v[2], vecReal a, vecReal b) {
+	v[0] = a;
+	v[1] = b;
+}
+
+static inline void vec3Set(vecReal v[3], vecReal a, vecReal b, vecReal c) {
+	v[0] = a;
+	v[1] = b;
+	v[2] = c;
+}
+
+static inline void vec4Set(vecReal v[4], vecReal a, vecReal b, vecReal c,
+		vecReal d) {
+	v[0] = a;
+	v[1] = b;
+	v[2] = c;
+	v[3] = d;
+}
+
+static inline void vec2Copy(const vecReal v[2], vecReal copy[2]) {
+	copy[0] = v[0];
+	copy[1] = v[1];
+}
+
+static inline void vec3Copy(const vecReal v[3], vecReal copy[3]) {
+	copy[0] = v[0];
+	copy[1] = v[1];
+	copy[2] = v[2];
+}
+
+static inline void vec4Copy(const vecReal v[4], vecReal copy[4]) {
+	copy[0] = v[0];
+	copy[1] = v[1];
+	copy[2] = v[2];
+	copy[3] = v[3];
+}
+
+static inline void vec2Add(const vecReal v[2], const vecReal w[2],
+		vecReal vPlusW[2]) {
+	vPlusW[0] = v[0] + w[0];
+	vPlusW[1] = v[1] + w[1];
+}
+
+static inline void vec3Add(const vecReal v[3], const vecReal w[3],
+		vecReal vPlusW[3]) {
+	vPlusW[0] = v[0] + w[0];
+	vPlusW[1] = v[1] + w[1];
+	vPlusW[2] = v[2] + w[2];
+}
+
+static inline void vec4Add(const vecReal v[4], const vecReal w[4],
+		vecReal vPlusW[4]) {
+	vPlusW[0] = v[0] + w[0];
+	vPlusW[1] = v[1] + w[1];
+	vPlusW[2] = v[2] + w[2];
+	vPlusW[3] = v[3] + w[3];
+}
+
+static inline void vec2Subtract(const vecReal v[2], const vecReal w[2],
+		vecReal vMinusW[2]) {
+	vMinusW[0] = v[0] - w[0];
+	vMinusW[1] = v[1] - w[1];
+}
+
+static inline void vec3Subtract(const vecReal v[3], const vecReal w[3],
+		vecReal vMinusW[3]) {
+	vMinusW[0] = v[0] - w[0];
+	vMinusW[1] = v[1] - w[1];
+	vMinusW[2] = v[2] - w[2];
+}
+
+static inline void vec4Subtract(const vecReal v[4], const vecReal w[4],
+		vecReal vMinusW[4]) {
+	vMinusW[0] = v[0] - w[0];
+	vMinusW[1] = v[1] - w[1];
+	vMinusW[2] = v[2] - w[2];
+	vMinusW[3] = v[3] - w[3];
+}
+
+static inline void vec2Scale(vecReal c, const vecReal w[2],
+		vecReal cTimesW[2]) {
+	cTimesW[0] = c * w[0];
+	cTimesW[1] = c * w[1];
+}
+
+static inline void vec3Scale(vecReal c, const vecReal w[3],
+		vecReal cTimesW[3]) {
+	cTimesW[0] = c * w[0];
+	cTimesW[1] = c * w[1];
+	cTimesW[2] = c * w[2];
+}
+
+static inline void vec4Scale(vecReal c, const vecReal w[4],
+		vecReal cTimesW[4]) {
+	cTimesW[0] = c * w[0];
+	cTimesW[1] = c * w[1];
+	cTimesW[2] = c * w[2];
+	cTimesW[3] = c * w[3];
+}
+
+static inline vecReal vec2Dot(const vecReal v[2], const vecReal w[2]) {
+	return v[0]*w[0] + v[1]*w[1];
+}
+
+static inline vecReal vec3Dot(const vecReal v[3], const vecReal w[3]) {
+	return v[0]*w[0] + v[1]*w[1] + v[2]*w[2];
+}
+
+static inline vecReal vec4Dot(const vecReal v[4], const vecReal w[4]) {
+	return v[0]*w[0] + v[1]*w[1] + v[2]*w[2] + v[3]*w[3];
+}
+
+static inline vecReal vec3Length(const vecReal v[3]) {
+	return sqrt(vec3Dot(v, v));
+}
+
+/* Like vecUnit, for 3-dimensional vectors, except that unit is set to the zero
+vector if v has length zero, so that it is never left unwritten. unit may be
+v. */
+static inline vecReal vec3Unit(const vecReal v[3], vecReal unit[3]) {
+	vecReal len = vec3Length(v);
+	if (len == 0.0)
+		vec3Set(unit, 0.0, 0.0, 0.0);
+	else
+		vec3Scale(1/len, v, unit);
+	return len;
+}
+
 /* Computes the cross product of the 3-dimensional vectors v and w, and places
 it into vCrossW. */
-void vec3Cross(double v[3], double w[3], double vCrossW[3]) {
+void vec3Cross(vecReal v[3], vecReal w[3], vecReal vCrossW[3]) {
 	vCrossW[0] = (v[1]*w[2]) - (v[2]*w[1]);
 	vCrossW[1] = (v[2]*w[0]) - (v[0]*w[2]);
 	vCrossW[2] = (v[0]*w[1]) - (v[1]*w[0]);
@@ -86,7 +233,7 @@ void vec3Cross(double v[3], double w[3], double vCrossW[3]) {
 /* Computes the 3-dimensional vector v from its spherical coordinates.
 rho >= 0.0 is the radius. 0 <= phi <= pi is the co-latitude. -pi <= theta <= pi
 is the longitude or azimuth. */
-void vec3Spherical(double rho, double phi, double theta, double v[3]) {  // phi  = pi/2 , theta = pi
+void vec3Spherical(vecReal rho, vecReal phi, vecReal theta, vecReal v[3]) {  // phi  = pi/2 , theta = pi
 	v[0] = rho*sin(phi)*cos(theta);
 	v[1] = rho*sin(phi)*sin(theta);
 	v[2] = rho*cos(phi);
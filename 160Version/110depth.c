@@ -1,55 +1,304 @@
 
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 /*** Creating and destroying ***/
 
+/* The depth buffer also keeps, for each depthTILE x depthTILE tile of pixels,
+a lower bound on the tile's Z-values. Since greater Z-values are nearer, that
+bound is at least as far as anything in the tile, and anything that is no
+nearer than the bound is hidden. */
+#define depthTILE 8
+
+/* Storage formats. Every format hands out Z-values as doubles, converted
+exactly from what is stored. A Z-value that the format cannot represent is
+stored rounded toward the viewer, so that a pixel that ties with what is
+already there still fails the depth test. */
+/* Eight bytes per pixel. */
+#define depthDOUBLE 0
+/* Four bytes per pixel. */
+#define depthFLOAT 1
+/* Four bytes per pixel, holding 24 bits of fixed point, which cover Z from -1
+(0) to just under 1 (depthFIXEDMAX), in steps of depthFIXEDSTEP. That is the
+range of Z after the viewport transformation. Z outside it is clamped. */
+#define depthFIXED24 2
+#define depthFIXEDMAX 0xFFFFFF
+#define depthFIXEDSTEP (1.0 / 8388608.0)
+
+/* Storage layouts. In the linear layout pixel (i, j) is at i + width * j. In
+the tiled layout each tile is contiguous, and within a tile the pixels are in
+the same order as in the linear layout, so that each row of a tile is still
+contiguous. */
+#define depthLINEAR 0
+#define depthTILED 1
+
+/* For multisampling, a buffer can hold depthSAMPLEMAX or fewer Z-values per
+pixel, one in each sample plane. Each sample plane is laid out like a whole
+buffer of one sample per pixel, so sample s of the pixel at index is at
+index + s * planeSize. */
+#define depthSAMPLEMAX 8
+
 /* Feel free to read the struct's members, but don't write them, except through
-the accessors below such as depthSetZ, etc. */
+the accessors below such as depthSetZ, etc. Clearing is done lazily: it only
+starts a new generation, and each tile is filled with the clear value the first
+time that it is touched in that generation (see depthTouch). */
 typedef struct depthBuffer depthBuffer;
 struct depthBuffer {
-	int width, height;
-	double *z;			/* width * height doubles */
+	int width, height, format, layout;
+	int sampleNum, planeSize;
+	double sampleX[depthSAMPLEMAX];	/* each sample's offset from the center */
+	double sampleY[depthSAMPLEMAX];	/* of its pixel, in pixels */
+	double *zDouble;		/* Z-values, if depthDOUBLE */
+	float *zFloat;			/* Z-values, if depthFLOAT */
+	unsigned int *zFixed;	/* Z-values, if depthFIXED24 */
+	int tileCols, tileRows;
+	double *tileZ;			/* tileCols * tileRows lower bounds */
+	unsigned int *tileGen;	/* generation in which each tile was last filled */
+	unsigned int gen;		/* generation of the latest clear */
+	double clearZ;			/* Z of the latest clear, as stored */
 };
 
-/* Initializes a depth buffer. When you are finished with the buffer, you must
-call depthDestroy to deallocate its backing resources. */
-int depthInitialize(depthBuffer *buf, int width, int height) {
-	buf->z = (double *)malloc(width * height * sizeof(double));
-	if (buf->z != NULL) {
-		buf->width = width;
-		buf->height = height;
+/* Returns the fixed-point depth nearest to z, rounding toward the viewer if up
+is nonzero and away from it otherwise. */
+static inline unsigned int depthFixed(double z, int up) {
+	double d = (z + 1.0) / depthFIXEDSTEP;
+	d = up ? ceil(d) : floor(d);
+	if (d <= 0.0)
+		return 0;
+	return (d >= depthFIXEDMAX) ? depthFIXEDMAX : (unsigned int)d;
+}
+
+/* Returns z rounded to the nearest Z-value that the buffer can store, toward
+the viewer if up is nonzero and away from it otherwise. */
+double depthRoundZ(depthBuffer *buf, double z, int up) {
+	if (buf->format == depthFLOAT) {
+		float f = (float)z;
+		if (up && f < z)
+			f = nextafterf(f, INFINITY);
+		else if (!up && f > z)
+			f = nextafterf(f, -INFINITY);
+		return f;
+	} else if (buf->format == depthFIXED24)
+		return depthFixed(z, up) * depthFIXEDSTEP - 1.0;
+	else
+		return z;
+}
+
+void depthClearZs(depthBuffer *buf, double z);
+
+/* The standard sample positions, in sixteenths of a pixel from its center:
+rotated grids, so that nearly horizontal and nearly vertical edges both get as
+many distinct steps as there are samples. */
+static const int depthSAMPLES4[4][2] = {{-2, -6}, {6, -2}, {-6, 2}, {2, 6}};
+static const int depthSAMPLES8[8][2] = {{1, -3}, {-1, 3}, {5, 1}, {-3, -5},
+	{-5, 5}, {-7, -1}, {3, 7}, {7, -7}};
+
+/* Initializes a depth buffer with the given format (depthDOUBLE, depthFLOAT or
+depthFIXED24) and layout (depthLINEAR or depthTILED), and sampleNum samples per
+pixel: 1, or 4 or 8 for multisampling. The buffer starts out cleared to 0.0.
+When you are finished with the buffer, you must call depthDestroy to deallocate
+its backing resources. Returns 0 if no error occurred. */
+int depthInitialize(depthBuffer *buf, int width, int height, int format,
+		int layout, int sampleNum) {
+	int tileCols = (width + depthTILE - 1) / depthTILE;
+	int tileRows = (height + depthTILE - 1) / depthTILE;
+	/* The tiled layout rounds the buffer up to whole tiles. */
+	int pixNum = (layout == depthTILED) ?
+		tileCols * tileRows * depthTILE * depthTILE : width * height;
+	size_t size = (format == depthDOUBLE) ? sizeof(double) : 4;
+	int s;
+	if (format < depthDOUBLE || format > depthFIXED24 ||
+			layout < depthLINEAR || layout > depthTILED) {
+		fprintf(stderr, "error: depthInitialize: unknown format or layout.\n");
+		return 1;
+	}
+	if (sampleNum != 1 && sampleNum != 4 && sampleNum != 8) {
+		fprintf(stderr, "error: depthInitialize: %d samples per pixel is not "
+			"1, 4 or 8.\n", sampleNum);
+		return 1;
+	}
+	void *z = malloc((size_t)pixNum * sampleNum * size);
+	buf->tileZ = (double *)malloc(tileCols * tileRows * sizeof(double));
+	buf->tileGen = (unsigned int *)calloc(tileCols * tileRows,
+		sizeof(unsigned int));
+	if (z == NULL || buf->tileZ == NULL || buf->tileGen == NULL) {
+		free(z);
+		free(buf->tileZ);
+		free(buf->tileGen);
+		return 1;
 	}
-	return (buf->z == NULL);
+	buf->width = width;
+	buf->height = height;
+	buf->format = format;
+	buf->layout = layout;
+	buf->sampleNum = sampleNum;
+	buf->planeSize = pixNum;
+	for (s = 0; s < sampleNum; s += 1) {
+		const int *offset = (sampleNum == 8) ? depthSAMPLES8[s] :
+			((sampleNum == 4) ? depthSAMPLES4[s] : NULL);
+		buf->sampleX[s] = (offset == NULL) ? 0.0 : offset[0] / 16.0;
+		buf->sampleY[s] = (offset == NULL) ? 0.0 : offset[1] / 16.0;
+	}
+	buf->zDouble = (format == depthDOUBLE) ? (double *)z : NULL;
+	buf->zFloat = (format == depthFLOAT) ? (float *)z : NULL;
+	buf->zFixed = (format == depthFIXED24) ? (unsigned int *)z : NULL;
+	buf->tileCols = tileCols;
+	buf->tileRows = tileRows;
+	buf->gen = 0;
+	depthClearZs(buf, 0.0);
+	return 0;
+}
+
+/*** Unchecked access ***/
+
+/* These are for the rasterizer's inner loops. They assume that the pixel is in
+the buffer and, except for depthTouch, that its tile has been touched since the
+latest clear. */
+
+/* Returns the index, in the buffer's storage, of pixel (i, j), or of its
+sample 0. Along a row, the index goes up by one from pixel to pixel, at least
+until the end of the tile (tiled layout) or of the row (linear layout). */
+static inline int depthIndex(const depthBuffer *buf, int i, int j) {
+	if (buf->layout == depthLINEAR)
+		return i + buf->width * j;
+	return ((i / depthTILE + buf->tileCols * (j / depthTILE)) * depthTILE +
+		j % depthTILE) * depthTILE + i % depthTILE;
+}
+
+/* Returns the Z-value at the given index. An unchecked depthGetZ. */
+static inline double depthLoadZ(const depthBuffer *buf, int index) {
+	if (buf->format == depthFLOAT)
+		return buf->zFloat[index];
+	else if (buf->format == depthFIXED24)
+		return buf->zFixed[index] * depthFIXEDSTEP - 1.0;
+	else
+		return buf->zDouble[index];
+}
+
+/* Sets the Z-value at the given index to z, rounded toward the viewer. An
+unchecked depthSetZ: it does not lower the tile's bound, so the caller must not
+make the Z-value farther. */
+static inline void depthStoreZ(depthBuffer *buf, int index, double z) {
+	if (buf->format == depthFLOAT) {
+		float f = (float)z;
+		if (f < z)
+			f = nextafterf(f, INFINITY);
+		buf->zFloat[index] = f;
+	} else if (buf->format == depthFIXED24)
+		buf->zFixed[index] = depthFixed(z, 1);
+	else
+		buf->zDouble[index] = z;
 }
 
+/* Fills the tile with the clear value, if it has not been touched since the
+latest clear. */
+void depthFillTile(depthBuffer *buf, int tile) {
+	int x0 = tile % buf->tileCols * depthTILE;
+	int y0 = tile / buf->tileCols * depthTILE;
+	int x1 = (x0 + depthTILE < buf->width) ? x0 + depthTILE : buf->width;
+	int y1 = (y0 + depthTILE < buf->height) ? y0 + depthTILE : buf->height;
+	int i, j, s;
+	for (s = 0; s < buf->sampleNum; s += 1)
+		for (j = y0; j < y1; j += 1) {
+			int index = depthIndex(buf, x0, j) + s * buf->planeSize;
+			for (i = 0; i < x1 - x0; i += 1)
+				depthStoreZ(buf, index + i, buf->clearZ);
+		}
+	buf->tileZ[tile] = buf->clearZ;
+	buf->tileGen[tile] = buf->gen;
+}
+
+/* Makes the Z-values of the tile that contains pixel (i, j) ready to read. */
+static inline void depthTouch(depthBuffer *buf, int i, int j) {
+	int tile = i / depthTILE + buf->tileCols * (j / depthTILE);
+	if (buf->tileGen[tile] != buf->gen)
+		depthFillTile(buf, tile);
+}
+
+/* Touches every tile that meets pixels [i0, i1] of row j. */
+static inline void depthTouchRow(depthBuffer *buf, int i0, int i1, int j) {
+	int i;
+	for (i = i0 / depthTILE * depthTILE; i <= i1; i += depthTILE)
+		depthTouch(buf, i, j);
+}
+
+/*** Checked access ***/
+
 /* Sets every Z-value to the given z. Typically you use this function at the
-start of each frame, passing a large negative value for z. */
+start of each frame, passing a large negative value for z. It takes constant
+time; the tiles are filled as they are touched. */
 void depthClearZs(depthBuffer *buf, double z) {
-	int i, j;
-	for (i = 0; i < buf->width; i += 1)
-		for (j = 0; j < buf->height; j += 1)
-			buf->z[i + buf->width * j] = z;
+	buf->clearZ = depthRoundZ(buf, z, 1);
+	buf->gen += 1;
+	/* After four billion clears, the generations wrap around. */
+	if (buf->gen == 0) {
+		memset(buf->tileGen, 0,
+			buf->tileCols * buf->tileRows * sizeof(unsigned int));
+		buf->gen = 1;
+	}
 }
 
-/* Sets the Z-value at pixel (i, j) to the given z. */
+/* Sets the Z-value at pixel (i, j), at every one of its samples, to the given
+z. */
 void depthSetZ(depthBuffer *buf, int i, int j, double z) {
-	if (0 <= i && i < buf->width && 0 <= j && j < buf->height)
-		buf->z[i + buf->width * j] = z;
+	if (0 <= i && i < buf->width && 0 <= j && j < buf->height) {
+		int index = depthIndex(buf, i, j), s;
+		depthTouch(buf, i, j);
+		for (s = 0; s < buf->sampleNum; s += 1)
+			depthStoreZ(buf, index + s * buf->planeSize, z);
+		double *tileZ = &buf->tileZ[i / depthTILE +
+			buf->tileCols * (j / depthTILE)];
+		if (depthLoadZ(buf, index) < *tileZ)
+			*tileZ = depthLoadZ(buf, index);
+	}
 }
 
-/* Returns the Z-value at pixel (i, j). */
+/* Returns the Z-value at pixel (i, j), or at its sample 0 if the buffer is
+multisampled. */
 double depthGetZ(depthBuffer *buf, int i, int j) {
-	if (0 <= i && i < buf->width && 0 <= j && j < buf->height)
-		return buf->z[i + buf->width * j];
-	else
+	if (0 <= i && i < buf->width && 0 <= j && j < buf->height) {
+		int tile = i / depthTILE + buf->tileCols * (j / depthTILE);
+		if (buf->tileGen[tile] != buf->gen)
+			return buf->clearZ;
+		return depthLoadZ(buf, depthIndex(buf, i, j));
+	} else
 		/* There's no right answer, but we have to return something. */
 		return 0.0;
 }
 
+/* Returns the lower bound on the Z-values in the tile that contains pixel
+(i, j). Assumes that the pixel is in the buffer. */
+double depthGetTileZ(depthBuffer *buf, int i, int j) {
+	int tile = i / depthTILE + buf->tileCols * (j / depthTILE);
+	return (buf->tileGen[tile] == buf->gen) ? buf->tileZ[tile] : buf->clearZ;
+}
+
+/* Informs the buffer that every Z-value in the tile that contains pixel (i, j),
+at every sample, is now at least z, so that the tile's bound can be raised.
+Assumes that the pixel is in the buffer. */
+void depthRaiseTileZ(depthBuffer *buf, int i, int j, double z) {
+	double *tileZ = &buf->tileZ[i / depthTILE +
+		buf->tileCols * (j / depthTILE)];
+	depthTouch(buf, i, j);
+	/* The Z-values were rounded toward the viewer when stored, so they are at
+	least z rounded away from it. */
+	z = depthRoundZ(buf, z, 0);
+	if (z > *tileZ)
+		*tileZ = z;
+}
+
 /* Deallocates the resources backing the buffer. This function must be called
 when you are finished using a buffer. */
 void depthDestroy(depthBuffer *buf) {
-	if (buf->z != NULL)
-		free(buf->z);
-	buf->z = NULL;
+	free(buf->zDouble);
+	free(buf->zFloat);
+	free(buf->zFixed);
+	free(buf->tileZ);
+	free(buf->tileGen);
+	buf->zDouble = NULL;
+	buf->zFloat = NULL;
+	buf->zFixed = NULL;
 }
@@ -0,0 +1,339 @@
+/*
+@ Author:  Sabastian Mugazambi & Tore Banta
+@ Date: 01/07/2017
+This file has a framebuffer: the colors of the frame being drawn, kept in
+memory, pixel (i, j) at i + width * j with (0, 0) in the lower left corner.
+The renderer draws into it, and nothing else, so that rendering does not need a
+window. When the frame is done, it can be shown in the window with fbPresent,
+or written to a file with fbWritePPM or fbWritePNG. To build without the pixel
+library at all, define fbHEADLESS before including this file; fbPresent is then
+left out.
+A multisampled framebuffer keeps several colors per pixel, one in each sample
+plane, which the rasterizer writes wherever a triangle covers a sample. When
+the frame is done, fbResolve averages them into the pixel's color.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef fbHEADLESS
+#include "000pixel.h"
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define fbX86 1
+#endif
+
+/*** Creating and destroying ***/
+
+/* Four bytes per pixel: red, green, blue, alpha, each 0 to 255. */
+#define fbRGBA8 0
+/* Four floats per pixel: red, green, blue, alpha, nominally 0.0 to 1.0 but not
+clamped, for high dynamic range. */
+#define fbFLOAT 1
+
+/* Feel free to read the struct's members, but don't write them, except through
+the accessors below such as fbSetRGB, etc. Sample plane s starts at
+4 * width * height * s. Plane 0 holds sample 0, until fbResolve replaces it
+with the pixels' colors. */
+typedef struct fbFramebuffer fbFramebuffer;
+struct fbFramebuffer {
+	int width, height, format, sampleNum;
+	unsigned char *rgba8;	/* 4 * width * height * sampleNum bytes, if fbRGBA8 */
+	float *rgba;			/* 4 * width * height * sampleNum floats, if fbFLOAT */
+};
+
+/* Initializes a framebuffer in the given format, fbRGBA8 or fbFLOAT, with
+sampleNum samples per pixel, which must match the depth buffer's. When you are
+finished with it, you must call fbDestroy to deallocate its backing resources.
+Returns 0 if no error occurred. */
+int fbInitialize(fbFramebuffer *fb, int width, int height, int format,
+		int sampleNum) {
+	size_t size = (size_t)4 * width * height * sampleNum;
+	fb->width = width;
+	fb->height = height;
+	fb->format = format;
+	fb->sampleNum = sampleNum;
+	fb->rgba8 = NULL;
+	fb->rgba = NULL;
+	if (sampleNum < 1) {
+		fprintf(stderr, "error: fbInitialize: %d samples per pixel.\n",
+			sampleNum);
+		return 1;
+	}
+	if (format == fbRGBA8)
+		fb->rgba8 = (unsigned char *)malloc(size);
+	else if (format == fbFLOAT)
+		fb->rgba = (float *)malloc(size * sizeof(float));
+	else {
+		fprintf(stderr, "error: fbInitialize: unknown format %d.\n", format);
+		return 1;
+	}
+	return (fb->rgba8 == NULL && fb->rgba == NULL);
+}
+
+/* Deallocates the resources backing the framebuffer. */
+void fbDestroy(fbFramebuffer *fb) {
+	free(fb->rgba8);
+	free(fb->rgba);
+}
+
+/*** Drawing ***/
+
+/* Converts a color channel to a byte, clamping it to [0, 1] first. */
+unsigned char fbByte(double channel) {
+	channel = (channel < 0.0) ? 0.0 : ((channel > 1.0) ? 1.0 : channel);
+	return (unsigned char)(channel * 255.0 + 0.5);
+}
+
+/* Sets every pixel, at every sample, to the given color, with alpha 1.
+Typically you use this function at the start of each frame. */
+void fbClearRGB(fbFramebuffer *fb, double red, double green, double blue) {
+	int pixNum = fb->width * fb->height * fb->sampleNum, i = 0;
+	if (fb->format == fbRGBA8) {
+		unsigned char pixel[4] = {fbByte(red), fbByte(green), fbByte(blue), 255};
+#ifdef fbX86
+		int word;
+		memcpy(&word, pixel, 4);
+		__m128i four = _mm_set1_epi32(word);
+		for (; i + 4 <= pixNum; i += 4)
+			_mm_storeu_si128((__m128i *)&fb->rgba8[4 * i], four);
+#endif
+		for (; i < pixNum; i += 1)
+			memcpy(&fb->rgba8[4 * i], pixel, 4);
+	} else {
+#ifdef fbX86
+		__m128 one = _mm_set_ps(1.0f, (float)blue, (float)green, (float)red);
+		for (; i < pixNum; i += 1)
+			_mm_storeu_ps(&fb->rgba[4 * i], one);
+#endif
+		for (; i < pixNum; i += 1) {
+			fb->rgba[4 * i] = (float)red;
+			fb->rgba[4 * i + 1] = (float)green;
+			fb->rgba[4 * i + 2] = (float)blue;
+			fb->rgba[4 * i + 3] = 1.0f;
+		}
+	}
+}
+
+/* Sets the samples of pixel (i, j) that are in mask, bit s for sample s, to
+the given color. For speed, (i, j) is not checked; the caller must keep it
+inside the framebuffer, as the rasterizer does. */
+void fbSetSamplesRGB(fbFramebuffer *fb, int i, int j, unsigned int mask,
+		double red, double green, double blue) {
+	int index = 4 * (i + fb->width * j), plane = 4 * fb->width * fb->height;
+	if (fb->format == fbRGBA8) {
+		unsigned char pixel[3] = {fbByte(red), fbByte(green), fbByte(blue)};
+		while (mask != 0) {
+			memcpy(&fb->rgba8[index + plane * __builtin_ctz(mask)], pixel, 3);
+			mask &= mask - 1;
+		}
+	} else
+		while (mask != 0) {
+			float *rgba = &fb->rgba[index + plane * __builtin_ctz(mask)];
+			rgba[0] = (float)red;
+			rgba[1] = (float)green;
+			rgba[2] = (float)blue;
+			mask &= mask - 1;
+		}
+}
+
+/* Sets pixel (i, j), at every sample, to the given color. For speed, (i, j) is
+not checked; the caller must keep it inside the framebuffer, as the rasterizer
+does. */
+void fbSetRGB(fbFramebuffer *fb, int i, int j, double red, double green,
+		double blue) {
+	fbSetSamplesRGB(fb, i, j, (1u << fb->sampleNum) - 1, red, green, blue);
+}
+
+/* Places the color of pixel (i, j) in rgb. Returns 0, 0, 0 if (i, j) is outside
+the framebuffer. If the framebuffer is multisampled, then the color is sample
+0's until fbResolve is called. */
+void fbGetRGB(fbFramebuffer *fb, int i, int j, double rgb[3]) {
+	int k;
+	if (0 <= i && i < fb->width && 0 <= j && j < fb->height) {
+		int index = 4 * (i + fb->width * j);
+		for (k = 0; k < 3; k += 1)
+			rgb[k] = (fb->format == fbRGBA8) ?
+				fb->rgba8[index + k] / 255.0 : fb->rgba[index + k];
+	} else
+		rgb[0] = rgb[1] = rgb[2] = 0.0;
+}
+
+/* Replaces the color of each pixel with the average of its samples, so that
+the pixels can be presented or written. Call it once, when the frame is done;
+it does nothing if the framebuffer is not multisampled. */
+void fbResolve(fbFramebuffer *fb) {
+	int pixNum = fb->width * fb->height, index, s, k;
+	if (fb->sampleNum == 1)
+		return;
+	for (index = 0; index < 4 * pixNum; index += 4)
+		for (k = 0; k < 3; k += 1) {
+			if (fb->format == fbRGBA8) {
+				int sum = 0;
+				for (s = 0; s < fb->sampleNum; s += 1)
+					sum += fb->rgba8[index + 4 * pixNum * s + k];
+				fb->rgba8[index + k] = (sum + fb->sampleNum / 2) / fb->sampleNum;
+			} else {
+				float sum = 0.0f;
+				for (s = 0; s < fb->sampleNum; s += 1)
+					sum += fb->rgba[index + 4 * pixNum * s + k];
+				fb->rgba[index + k] = sum / fb->sampleNum;
+			}
+		}
+}
+
+/*** Presenting ***/
+
+#ifndef fbHEADLESS
+/* Copies the whole framebuffer to the window, once per frame. The pixel library
+takes colors one pixel at a time, so this is where all of those calls now
+happen, in one tight loop, rather than scattered through the rasterizer. */
+void fbPresent(fbFramebuffer *fb) {
+	double rgb[3];
+	int i, j;
+	for (j = 0; j < fb->height; j += 1)
+		for (i = 0; i < fb->width; i += 1) {
+			fbGetRGB(fb, i, j, rgb);
+			pixSetRGB(i, j, rgb[0], rgb[1], rgb[2]);
+		}
+}
+#endif
+
+/* Writes the framebuffer to a binary PPM file, top row first, clamping each
+channel to [0, 1]. Needs no window. Returns 0 if no error occurred. */
+int fbWritePPM(fbFramebuffer *fb, const char *path) {
+	FILE *file = fopen(path, "wb");
+	double rgb[3];
+	int i, j, k;
+	if (file == NULL) {
+		fprintf(stderr, "error: fbWritePPM: could not open %s.\n", path);
+		return 1;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", fb->width, fb->height);
+	for (j = fb->height - 1; j >= 0; j -= 1)
+		for (i = 0; i < fb->width; i += 1) {
+			fbGetRGB(fb, i, j, rgb);
+			for (k = 0; k < 3; k += 1)
+				fputc(fbByte(rgb[k]), file);
+		}
+	if (fclose(file) != 0) {
+		fprintf(stderr, "error: fbWritePPM: could not write %s.\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+/* Stores value in the 4 bytes, most significant first. */
+void fbPutBigEndian(unsigned char *bytes, unsigned int value) {
+	bytes[0] = value >> 24;
+	bytes[1] = value >> 16;
+	bytes[2] = value >> 8;
+	bytes[3] = value;
+}
+
+/* Returns the CRC-32 of the bytes, continuing from crc, which is 0 to start. */
+unsigned int fbCRC(unsigned int crc, const unsigned char *bytes, size_t n) {
+	size_t i;
+	int k;
+	crc = ~crc;
+	for (i = 0; i < n; i += 1) {
+		crc ^= bytes[i];
+		for (k = 0; k < 8; k += 1)
+			crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+	}
+	return ~crc;
+}
+
+/* Writes one PNG chunk: its length, type, data and CRC. */
+void fbWriteChunk(FILE *file, const char *type, const unsigned char *data,
+		size_t n) {
+	unsigned char word[4];
+	fbPutBigEndian(word, (unsigned int)n);
+	fwrite(word, 1, 4, file);
+	fwrite(type, 1, 4, file);
+	fwrite(data, 1, n, file);
+	unsigned int crc = fbCRC(fbCRC(0, (const unsigned char *)type, 4), data, n);
+	fbPutBigEndian(word, crc);
+	fwrite(word, 1, 4, file);
+}
+
+/* Writes the framebuffer to an 8-bit RGB PNG file, top row first, clamping
+each channel to [0, 1]. To need no compression library, the image data are
+stored in uncompressed deflate blocks, so the file is about as large as a PPM.
+Returns 0 if no error occurred. */
+int fbWritePNG(fbFramebuffer *fb, const char *path) {
+	/* Each row is a filter type byte, 0 for none, and then the pixels. */
+	size_t rowSize = 1 + 3 * (size_t)fb->width;
+	size_t rawSize = rowSize * fb->height;
+	size_t blockNum = (rawSize + 65534) / 65535;
+	unsigned char *raw = (unsigned char *)malloc(rawSize);
+	unsigned char *idat = (unsigned char *)malloc(2 + 5 * blockNum + rawSize + 4);
+	double rgb[3];
+	size_t b, at = 0;
+	int i, j, k;
+	if (raw == NULL || idat == NULL) {
+		free(raw);
+		free(idat);
+		return 1;
+	}
+	for (j = fb->height - 1; j >= 0; j -= 1) {
+		raw[at] = 0;
+		at += 1;
+		for (i = 0; i < fb->width; i += 1) {
+			fbGetRGB(fb, i, j, rgb);
+			for (k = 0; k < 3; k += 1) {
+				raw[at] = fbByte(rgb[k]);
+				at += 1;
+			}
+		}
+	}
+	/* A zlib stream: header, stored blocks of at most 65535 bytes, and the
+	Adler-32 checksum of the raw data. */
+	unsigned int adlerA = 1, adlerB = 0;
+	idat[0] = 0x78;
+	idat[1] = 0x01;
+	at = 2;
+	for (b = 0; b < blockNum; b += 1) {
+		size_t first = b * 65535;
+		size_t n = (rawSize - first < 65535) ? rawSize - first : 65535;
+		idat[at] = (b + 1 == blockNum);
+		idat[at + 1] = n & 0xFF;
+		idat[at + 2] = n >> 8;
+		idat[at + 3] = ~n & 0xFF;
+		idat[at + 4] = (~n >> 8) & 0xFF;
+		memcpy(&idat[at + 5], &raw[first], n);
+		at += 5 + n;
+	}
+	for (b = 0; b < rawSize; b += 1) {
+		adlerA = (adlerA + raw[b]) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	fbPutBigEndian(&idat[at], (adlerB << 16) | adlerA);
+	at += 4;
+
+	unsigned char header[13];
+	fbPutBigEndian(header, fb->width);
+	fbPutBigEndian(&header[4], fb->height);
+	header[8] = 8;		/* bits per channel */
+	header[9] = 2;		/* RGB */
+	header[10] = header[11] = header[12] = 0;
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "error: fbWritePNG: could not open %s.\n", path);
+		free(raw);
+		free(idat);
+		return 1;
+	}
+	fwrite("\x89PNG\r\n\x1a\n", 1, 8, file);
+	fbWriteChunk(file, "IHDR", header, 13);
+	fbWriteChunk(file, "IDAT", idat, at);
+	fbWriteChunk(file, "IEND", NULL, 0);
+	free(raw);
+	free(idat);
+	if (fclose(file) != 0) {
+		fprintf(stderr, "error: fbWritePNG: could not write %s.\n", path);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+@ Author:  Sabastian Mugazambi & Tore Banta
+@ Date: 01/07/2017
+This file has a heat map, for finding out where a frame's pixels cost the most.
+While a renderer has one (see renSetHeatMap), the rasterizer counts, at each
+pixel, how many times it was depth tested, how many times it was written
+because it passed, and how many times it was shaded. heatRender then paints
+one of those counts into a framebuffer in false color, in place of the picture.
+Pixels that the depth tiles hide are never tested, so they are not counted.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* What heatRender paints. */
+#define heatTESTED 0       /* depth tests */
+#define heatSHADED 1       /* calls to colorPixel, or pixels to colorPixels */
+#define heatOVERWRITTEN 2  /* writes after the first, i.e. wasted writes */
+
+/* Feel free to read the struct's members, but don't write them. Each array
+has pixel (i, j) at i + width * j. */
+typedef struct heatMap heatMap;
+struct heatMap {
+  int width, height;
+  unsigned int *tested, *written, *shaded;
+};
+
+/* Initializes a heat map, with every count 0. When you are finished with it,
+you must call heatDestroy. Returns 0 if no error occurred. */
+int heatInitialize(heatMap *heat, int width, int height) {
+  heat->width = width;
+  heat->height = height;
+  heat->tested = (unsigned int *)calloc(3 * width * height,
+                                        sizeof(unsigned int));
+  if (heat->tested == NULL)
+    return 1;
+  heat->written = &heat->tested[width * height];
+  heat->shaded = &heat->tested[2 * width * height];
+  return 0;
+}
+
+/* Deallocates the resources backing the heat map. */
+void heatDestroy(heatMap *heat) {
+  free(heat->tested);
+}
+
+/* Sets every count to 0. Typically you use this function at the start of each
+frame. */
+void heatClear(heatMap *heat) {
+  memset(heat->tested, 0,
+         3 * heat->width * heat->height * sizeof(unsigned int));
+}
+
+/* Counts one span of up to 64 pixels of a row, starting at the given index.
+Bit l of covered is set if the lth pixel was depth tested, and of passed if it
+passed and was written. If shaded, then the pixels that passed were also
+shaded. */
+void heatCount(heatMap *heat, int index, unsigned long long covered,
+               unsigned long long passed, int shaded) {
+  while (covered != 0) {
+    heat->tested[index + __builtin_ctzll(covered)] += 1;
+    covered &= covered - 1;
+  }
+  while (passed != 0) {
+    int l = __builtin_ctzll(passed);
+    passed &= passed - 1;
+    heat->written[index + l] += 1;
+    if (shaded)
+      heat->shaded[index + l] += 1;
+  }
+}
+
+/* Returns the count of the given kind, heatTESTED etc., at the index. */
+unsigned int heatGet(const heatMap *heat, int kind, int index) {
+  if (kind == heatTESTED)
+    return heat->tested[index];
+  if (kind == heatSHADED)
+    return heat->shaded[index];
+  return (heat->written[index] > 1) ? heat->written[index] - 1 : 0;
+}
+
+/* Paints the counts of the given kind into the framebuffer, which must be the
+heat map's size. 0 is black, and counts from 1 to max go through blue, cyan,
+green, yellow and red; anything above max is white. Keeping max the same from
+frame to frame keeps the colors comparable. */
+void heatRender(const heatMap *heat, fbFramebuffer *fb, int kind,
+                unsigned int max) {
+  static const double ramp[5][3] = {
+      {0.0, 0.0, 1.0}, {0.0, 1.0, 1.0}, {0.0, 1.0, 0.0},
+      {1.0, 1.0, 0.0}, {1.0, 0.0, 0.0}};
+  int i, j;
+  for (j = 0; j < heat->height; j += 1)
+    for (i = 0; i < heat->width; i += 1) {
+      unsigned int count = heatGet(heat, kind, i + heat->width * j);
+      if (count == 0)
+        fbSetRGB(fb, i, j, 0.0, 0.0, 0.0);
+      else if (count > max)
+        fbSetRGB(fb, i, j, 1.0, 1.0, 1.0);
+      else {
+        double t = (max > 1) ? 4.0 * (count - 1) / (max - 1) : 4.0;
+        int k = (t >= 4.0) ? 3 : (int)t;
+        double f = t - k;
+        fbSetRGB(fb, i, j, ramp[k][0] + f * (ramp[k + 1][0] - ramp[k][0]),
+                 ramp[k][1] + f * (ramp[k + 1][1] - ramp[k][1]),
+                 ramp[k][2] + f * (ramp[k + 1][2] - ramp[k][2]));
+      }
+    }
+}
+
+/* Prints the mean and the maximum of the counts of the given kind, over the
+pixels that were tested at all. */
+void heatPrintSummary(const heatMap *heat, int kind, FILE *file) {
+  const char *names[3] = {"tested", "shaded", "overwritten"};
+  long sum = 0, pixNum = 0;
+  unsigned int max = 0;
+  int index;
+  for (index = 0; index < heat->width * heat->height; index += 1)
+    if (heat->tested[index] > 0) {
+      unsigned int count = heatGet(heat, kind, index);
+      sum += count;
+      pixNum += 1;
+      max = (count > max) ? count : max;
+    }
+  fprintf(file, "heat map: %s %.2f per pixel on average, %u at most, over %ld "
+          "pixels\n", names[kind], (pixNum > 0) ? (double)sum / pixNum : 0.0,
+          max, pixNum);
+}
@@ -4,6 +4,10 @@
 This file has a struct for rendering.
 */
 
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
 #define renORTHOGRAPHIC 0
 #define renPERSPECTIVE 1
 #define renPROJL 0
@@ -12,6 +16,38 @@ This file has a struct for rendering.
 #define renPROJT 3
 #define renPROJF 4
 #define renPROJN 5
+#define renIMMEDIATE 0
+#define renDEFERRED 1
+#define renCULLBACK 0
+#define renCULLNONE 1
+#define renCULLFRONT 2
+#define renSTATSTEXT 0
+#define renSTATSJSON 1
+
+/* What the pipeline did, and how long each stage took, since the last
+renResetStats. Only culledNum and degenerateNum are counted all the time; the
+rest only while the renderer's statistics are on (see renSetStats). Times are
+in seconds. Stages that run on the tile threads add up the CPU time of every
+thread (see renThreadNow), so with several cores they can exceed the frame
+time, but time that a thread spends waiting for a core is not counted. */
+typedef struct renStats renStats;
+struct renStats {
+  long vertexNum;       /* vertices transformed */
+  long triangleNum;     /* triangles submitted to clipping */
+  long culledNum;       /* discarded by the cull mode */
+  long degenerateNum;   /* discarded for having zero area */
+  long rejectedNum;     /* discarded for being outside the frustum */
+  long clippedNum;      /* clipped against some plane of the frustum */
+  long clipOutNum;      /* triangles that the clipped ones became */
+  long coveredNum;      /* pixels covered and depth tested */
+  long passedNum;       /* pixels that passed the depth test */
+  long failedNum;       /* pixels that failed it */
+  long shadedNum;       /* pixels given to colorPixel or colorPixels */
+  double vertexTime;    /* transforming vertices */
+  double primitiveTime; /* clipping, setting up and binning triangles */
+  double rasterTime;    /* rasterizing, including shading in immediate mode */
+  double shadeTime;     /* shading in deferred mode */
+};
 
 typedef struct renRenderer renRenderer;
 
@@ -20,16 +56,35 @@ struct renRenderer {
   int texNum;
   int varyDim;
   int attrDim;
-  void (*colorPixel)(renRenderer *, double[], texTexture *[], double[], double[]);
-  void (*transformVertex)(renRenderer *, double[], double[], double[]);
-  void (*updateUniform)(renRenderer *, double[], double[]);
+  void (*colorPixel)(renRenderer *, vecReal[], texTexture *[], vecReal[],
+                     vecReal[]);
+  /* Optional batched colorPixel, or NULL. See renSetColorPixels. */
+  void (*colorPixels)(renRenderer *, vecReal[], texTexture *[], int,
+                      const vecReal[], int, vecReal[], int);
+  void (*transformVertex)(renRenderer *, vecReal[], vecReal[], vecReal[]);
+  /* Optional batched transformVertex, or NULL. See renSetTransformVertices. */
+  void (*transformVertices)(renRenderer *, vecReal[], int, const vecReal[],
+                            int, vecReal[], int);
+  void (*updateUniform)(renRenderer *, vecReal[], vecReal[]);
+  /* Optional, or NULL. See renSetUpdateViewing. */
+  void (*updateViewing)(renRenderer *, vecReal[]);
   depthBuffer *depth;
-  double cameraRotation[3][3];
-  double cameraTranslation[3];
-  double viewing[4][4];
-  double projection[6];
+  fbFramebuffer *framebuffer; /* where the colors go */
+  heatMap *heat;               /* NULL unless counting, see renSetHeatMap */
+  vecReal cameraRotation[3][3];
+  vecReal cameraTranslation[3];
+  vecReal viewing[4][4];
+  unsigned int viewingStamp;   /* changes whenever viewing does */
+  vecReal projection[6];
   int projectionType;
-  double viewport[4][4];
+  vecReal viewport[4][4];
+  int viewWidth, viewHeight;   /* 0 for the whole buffer, see renSetViewportSize */
+  struct tileBinner *binner;  /* NULL unless rendering through tiles */
+  int shadingMode;             /* renIMMEDIATE or renDEFERRED */
+  unsigned int varyMask;       /* varyings that colorPixel reads, or 0 for all */
+  int cullMode;                /* renCULLBACK, renCULLNONE or renCULLFRONT */
+  int statsOn;                 /* see renSetStats */
+  renStats stats;
 };
 
 /* Sets the camera's rotation and translation, in a manner suitable for third-
@@ -38,9 +93,9 @@ itself is displaced from that target by a distance rho, in the direction
 specified by the spherical coordinates phi and theta (as in vec3Spherical).
 Under normal use, where 0 < phi < pi, the camera's up-direction is world-up, or
 as close to it as possible. */
-void renLookAt(renRenderer *ren, double target[3], double rho, double phi,
-        double theta) {
-    double z[3], y[3], yStd[3] = {0.0, 1.0, 0.0}, zStd[3] = {0.0, 0.0, 1.0};
+void renLookAt(renRenderer *ren, vecReal target[3], vecReal rho, vecReal phi,
+        vecReal theta) {
+    vecReal z[3], y[3], yStd[3] = {0.0, 1.0, 0.0}, zStd[3] = {0.0, 0.0, 1.0};
     vec3Spherical(1.0, phi, theta, z);  /// z = 0.0, 0.0, 0.1
     vec3Spherical(1.0, M_PI / 2.0 - phi, theta + M_PI, y); // y = 0.0 , 0.0, -0.5
     mat33BasisRotation(yStd, zStd, y, z, ren->cameraRotation);
@@ -55,20 +110,42 @@ From that position, the camera's sight direction is described by the spherical
 coordinates phi and theta (as in vec3Spherical). Under normal use, where
 0 < phi < pi, the camera's up-direction is world-up, or as close to it as
 possible. */
-void renLookFrom(renRenderer *ren, double position[3], double phi,
-        double theta) {
-    double negZ[3], y[3];
-    double yStd[3] = {0.0, 1.0, 0.0}, negZStd[3] = {0.0, 0.0, -1.0};
+void renLookFrom(renRenderer *ren, vecReal position[3], vecReal phi,
+        vecReal theta) {
+    vecReal negZ[3], y[3];
+    vecReal yStd[3] = {0.0, 1.0, 0.0}, negZStd[3] = {0.0, 0.0, -1.0};
     vec3Spherical(1.0, phi, theta, negZ);
     vec3Spherical(1.0, M_PI / 2.0 - phi, theta + M_PI, y);
     mat33BasisRotation(yStd, negZStd, y, negZ, ren->cameraRotation);
     vecCopy(3, position, ren->cameraTranslation);
 }
 
-/* Updates the renderer's viewing transformation, based on the camera. */
+/* Makes the viewport the lower left width x height pixels of the depth buffer
+and framebuffer, so that the scene is drawn smaller, into just those pixels,
+as for dynamic resolution. 0 x 0, the default, is the whole buffer. The size
+must fit in the buffers. It takes effect at the next renUpdateViewing. */
+void renSetViewportSize(renRenderer *ren, int width, int height) {
+  ren->viewWidth = width;
+  ren->viewHeight = height;
+}
+
+/* Returns the width of the viewport, in pixels. */
+int renGetViewportWidth(const renRenderer *ren) {
+  return (ren->viewWidth > 0) ? ren->viewWidth : ren->depth->width;
+}
+
+/* Returns the height of the viewport, in pixels. */
+int renGetViewportHeight(const renRenderer *ren) {
+  return (ren->viewHeight > 0) ? ren->viewHeight : ren->depth->height;
+}
+
+/* Updates the renderer's viewing transformation, based on the camera. If it
+comes out different from before, then viewingStamp changes too. */
 void renUpdateViewing(renRenderer *ren) {
-  double C_Inv_M[4][4];
-  double P[4][4];
+  vecReal C_Inv_M[4][4];
+  vecReal P[4][4];
+  vecReal old[4][4];
+  mat44Copy(ren->viewing, old);
 
   //double I[3][3] = {{1.0, 0.0, 0.0 }, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
   //mat33Print((double(*)[3])ren->cameraRotation);
@@ -90,7 +167,170 @@ void renUpdateViewing(renRenderer *ren) {
                     ren->projection[renPROJT],ren->projection[renPROJF],ren->projection[renPROJN],P);
     mat444Multiply(P,C_Inv_M,ren->viewing);
   }
-  mat44Viewport(ren->depth->width,ren->depth->height,ren->viewport);
+  if (memcmp(old, ren->viewing, sizeof(old)) != 0)
+    ren->viewingStamp += 1;
+  mat44Viewport(renGetViewportWidth(ren), renGetViewportHeight(ren),
+                ren->viewport);
+}
+
+/* Sets the shading mode, to either renIMMEDIATE (the default) or renDEFERRED.
+In immediate mode, colorPixel runs for every fragment that passes the depth test
+when its triangle is drawn. In deferred mode, the triangles are first
+rasterized into depth and a visibility buffer, and then colorPixel runs exactly
+once for each pixel that is visible at the end of the frame, no matter how many
+triangles were drawn over it. Deferred shading happens in tileFlush, so it
+needs the renderer to be binning into tiles (see tileInitialize). Without a
+binner, asking for renDEFERRED prints an error and leaves the mode as it was.
+Returns 0 if no error occurred. */
+int renSetShadingMode(renRenderer *ren, int shadingMode) {
+  if (shadingMode == renDEFERRED && ren->binner == NULL) {
+    fprintf(stderr, "error: renSetShadingMode: deferred shading needs a ");
+    fprintf(stderr, "binner; call tileInitialize first.\n");
+    return 1;
+  }
+  ren->shadingMode = shadingMode;
+  return 0;
+}
+
+/* Registers a batched version of colorPixel, or NULL for none. When one is
+registered, the rasterizer prefers it, and calls it once per run of visible
+pixels rather than once per pixel, as
+        colorPixels(ren, unif, tex, n, vary, varyStride, rgb, rgbStride)
+The n pixels come in structure-of-arrays form: varying k of the lth pixel is
+vary[k * varyStride + l], and the shader puts the red, green and blue of the
+lth pixel in rgb[l], rgb[rgbStride + l] and rgb[2 * rgbStride + l]. Every
+pixel of a call comes from the same uniforms and textures, so the shader can
+work out per-draw values once per call. colorPixel must still be set, and
+must give the same results. */
+void renSetColorPixels(renRenderer *ren,
+    void (*colorPixels)(renRenderer *, vecReal[], texTexture *[], int,
+                        const vecReal[], int, vecReal[], int)) {
+  ren->colorPixels = colorPixels;
+}
+
+/* Registers a batched version of transformVertex, or NULL for none. When one
+is registered, meshRender prefers it. It is called as
+        transformVertices(ren, unif, n, attr, attrStride, vary, varyStride)
+to transform n vertices at once, in structure-of-arrays form: attribute k of
+the lth vertex is attr[k * attrStride + l], and varying k of the lth vertex
+goes in vary[k * varyStride + l]. It must give the same results as
+transformVertex. */
+void renSetTransformVertices(renRenderer *ren,
+    void (*transformVertices)(renRenderer *, vecReal[], int, const vecReal[],
+                              int, vecReal[], int)) {
+  ren->transformVertices = transformVertices;
+}
+
+/* Registers a function that copies whatever depends on the camera, such as the
+viewing transformation, into a node's uniforms, or NULL for none. When one is
+registered, updateUniform need only work out the modeling transformation, and
+the scene calls it only when a node or one of its ancestors has moved (see
+sceneSetUniform), and calls updateViewing only when viewingStamp has changed.
+So a scene that stands still costs no transformation work per frame. When none
+is registered, updateUniform does all of it, for every node, every frame. */
+void renSetUpdateViewing(renRenderer *ren,
+    void (*updateViewing)(renRenderer *, vecReal[])) {
+  ren->updateViewing = updateViewing;
+}
+
+/* Declares which varyings colorPixel actually reads: bit k of mask is set if
+vary[k] is read. Triangle setup then builds interpolation planes only for
+those, and the rest are 0.0 when colorPixel is called. X, Y, Z and W are always
+interpolated. A mask of 0, the default, means every varying is read. */
+void renSetVaryingMask(renRenderer *ren, unsigned int mask) {
+  ren->varyMask = mask;
+}
+
+/* Sets which triangles are discarded before clipping: renCULLBACK (the
+default) discards those that appear clockwise on the screen, renCULLFRONT those
+that appear counterclockwise, and renCULLNONE neither. Triangles of zero area
+are always discarded. */
+void renSetCullMode(renRenderer *ren, int cullMode) {
+  ren->cullMode = cullMode;
+}
+
+/* Turns the renderer's statistics on (1) or off (0, the default). While they
+are off, nothing but the culled and degenerate triangles is counted, and no
+clocks are read. */
+void renSetStats(renRenderer *ren, int on) {
+  ren->statsOn = on;
+}
+
+/* Zeroes the statistics. Call it at the start of each frame to get per-frame
+statistics. */
+void renResetStats(renRenderer *ren) {
+  renStats zero = {0};
+  ren->stats = zero;
+}
+
+/* Places a copy of the statistics in stats. */
+void renGetStats(const renRenderer *ren, renStats *stats) {
+  *stats = ren->stats;
+}
+
+/* Adds the statistics add to sum. */
+void renAddStats(renStats *sum, const renStats *add) {
+  sum->vertexNum += add->vertexNum;
+  sum->triangleNum += add->triangleNum;
+  sum->culledNum += add->culledNum;
+  sum->degenerateNum += add->degenerateNum;
+  sum->rejectedNum += add->rejectedNum;
+  sum->clippedNum += add->clippedNum;
+  sum->clipOutNum += add->clipOutNum;
+  sum->coveredNum += add->coveredNum;
+  sum->passedNum += add->passedNum;
+  sum->failedNum += add->failedNum;
+  sum->shadedNum += add->shadedNum;
+  sum->vertexTime += add->vertexTime;
+  sum->primitiveTime += add->primitiveTime;
+  sum->rasterTime += add->rasterTime;
+  sum->shadeTime += add->shadeTime;
+}
+
+/* Prints the statistics to the file on one line, either as renSTATSTEXT, for
+people, or as renSTATSJSON, one JSON object, for scripts. Times are printed in
+milliseconds. */
+void renPrintStats(const renStats *stats, FILE *file, int format) {
+  const char *text =
+      "verts %ld  tris %ld culled %ld degenerate %ld rejected %ld "
+      "clipped %ld->%ld  pixels covered %ld passed %ld failed %ld "
+      "shaded %ld  ms vertex %.2f primitive %.2f raster %.2f shade %.2f\n";
+  const char *json =
+      "{\"vertices\": %ld, \"triangles\": %ld, \"culled\": %ld, "
+      "\"degenerate\": %ld, \"rejected\": %ld, \"clipped\": %ld, "
+      "\"clipOut\": %ld, \"covered\": %ld, \"passed\": %ld, "
+      "\"failed\": %ld, \"shaded\": %ld, \"vertexMs\": %.3f, "
+      "\"primitiveMs\": %.3f, \"rasterMs\": %.3f, \"shadeMs\": %.3f}\n";
+  fprintf(file, (format == renSTATSJSON) ? json : text, stats->vertexNum,
+          stats->triangleNum, stats->culledNum, stats->degenerateNum,
+          stats->rejectedNum, stats->clippedNum, stats->clipOutNum,
+          stats->coveredNum, stats->passedNum, stats->failedNum,
+          stats->shadedNum, 1000.0 * stats->vertexTime,
+          1000.0 * stats->primitiveTime, 1000.0 * stats->rasterTime,
+          1000.0 * stats->shadeTime);
+}
+
+/* Returns the time in seconds, from a clock that only goes forward, for
+timing the stages. */
+double renNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1.0e-9;
+}
+
+/* Returns the CPU time in seconds that the calling thread has used, for timing
+the stages that run on the tile threads. */
+double renThreadNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec + now.tv_nsec * 1.0e-9;
+}
+
+/* Starts counting the depth tests, writes and shading at each pixel in the
+heat map, which must be the size of the depth buffer, or stops if heat is NULL,
+the default. The counts add up until heatClear is called. */
+void renSetHeatMap(renRenderer *ren, heatMap *heat) {
+  ren->heat = heat;
 }
 
 /* Sets the projection type, to either renORTHOGRAPHIC or renPERSPECTIVE. */
@@ -99,12 +339,12 @@ void renSetProjectionType(renRenderer *ren, int projType) {
 }
 
 /* Sets all six projection parameters. */
-void renSetProjection(renRenderer *ren, double proj[6]) {
+void renSetProjection(renRenderer *ren, vecReal proj[6]) {
 	vecCopy(6, proj, ren->projection);
 }
 
 /* Sets one of the six projection parameters. */
-void renSetOneProjection(renRenderer *ren, int i, double value) {
+void renSetOneProjection(renRenderer *ren, int i, vecReal value) {
 	ren->projection[i] = value;
 }
 
@@ -119,8 +359,8 @@ values are fovy = M_PI / 6.0, focal = 10.0, and ratio = 10.0, so that
 far = -100.0 and near = -1.0. For orthographic projection, the projection
 parameters are set to produce the orthographic projection that, at the focal
 plane, is most similar to the perspective projection just described. */
-void renSetFrustum(renRenderer *ren, int projType, double fovy, double focal,
-		double ratio) {
+void renSetFrustum(renRenderer *ren, int projType, vecReal fovy, vecReal focal,
+		vecReal ratio) {
 	ren->projectionType = projType;
 	ren->projection[renPROJF] = -focal * ratio;
 	ren->projection[renPROJN] = -focal / ratio;
@@ -9,7 +9,7 @@ given in any order.
 /*** 2 x 2 Matrices ***/
 
 /* Pretty-prints the given matrix, with one line of text per row of matrix. */
-void mat22Print(double m[2][2]) {
+void mat22Print(vecReal m[2][2]) {
 	for (int i = 0; i < 2; i += 1)
 		printf("%f    %f\n", m[i][0], m[i][1]);
 }
@@ -17,8 +17,8 @@ void mat22Print(double m[2][2]) {
 /* Returns the determinant of the matrix m. If the determinant is 0.0, then the
 matrix is not invertible, and mInv is untouched. If the determinant is not 0.0,
 then the matrix is invertible, and its inverse is placed into mInv. */
-double mat22Invert(double m[2][2], double mInv[2][2]) {
-	double deter = (m[0][0]*m[1][1]) - (m[0][1]*m[1][0]);
+vecReal mat22Invert(vecReal m[2][2], vecReal mInv[2][2]) {
+	vecReal deter = (m[0][0]*m[1][1]) - (m[0][1]*m[1][0]);
 	if (deter == 0.0) return deter;
 	else {
 		mInv[0][0] = (1/deter)*m[1][1];
@@ -31,13 +31,13 @@ double mat22Invert(double m[2][2], double mInv[2][2]) {
 
 /* Multiplies a 2x2 matrix m by a 2-column v, storing the result in mTimesV.
 The output should not */
-void mat221Multiply(double m[2][2], double v[2], double mTimesV[2]) {
+void mat221Multiply(vecReal m[2][2], vecReal v[2], vecReal mTimesV[2]) {
 	mTimesV[0] = (v[0]*m[0][0])+(v[1]*m[0][1]);
 	mTimesV[1] = (v[0]*m[1][0])+(v[1]*m[1][1]);
 }
 
 /* Fills the matrix m from its two columns. */
-void mat22Columns(double col0[2], double col1[2], double m[2][2]) {
+void mat22Columns(vecReal col0[2], vecReal col1[2], vecReal m[2][2]) {
 	m[0][0] = col0[0];
 	m[1][0] = col0[1];
 	m[0][1] = col1[0];
@@ -46,7 +46,7 @@ void mat22Columns(double col0[2], double col1[2], double m[2][2]) {
 
 /*** 3 x 3 Matrices ***/
 
-void mat33Transpose(double m[3][3],double m_T[3][3]) {
+void mat33Transpose(vecReal m[3][3],vecReal m_T[3][3]) {
 	for (int i = 0; i < 3; i++) {
 		for (int j = 0; j < 3; j++) {
 			m_T[i][j] = m[j][i];
@@ -55,7 +55,7 @@ void mat33Transpose(double m[3][3],double m_T[3][3]) {
 }
 
 /* Multiplies the 3x3 matrix m by the 3x3 matrix n. */
-void mat333Multiply(double m[3][3], double n[3][3], double mTimesN[3][3]) {
+void mat333Multiply(vecReal m[3][3], vecReal n[3][3], vecReal mTimesN[3][3]) {
 
 	for(int i = 0; i < 3; i++) {
 		for(int j = 0; j < 3; j++) {
@@ -65,7 +65,7 @@ void mat333Multiply(double m[3][3], double n[3][3], double mTimesN[3][3]) {
 }
 
 /* Multiplies the 3x3 matrix m by the 3x1 matrix v. */
-void mat331Multiply(double m[3][3], double v[3], double mTimesV[3]) {
+void mat331Multiply(vecReal m[3][3], vecReal v[3], vecReal mTimesV[3]) {
 	for (int i = 0; i < 3; i++) {
 		mTimesV[i] = m[i][0]*v[0] + m[i][1]*v[1] + m[i][2]*v[2];
 	}
@@ -75,9 +75,9 @@ void mat331Multiply(double m[3][3], double v[3], double mTimesV[3]) {
 coordinates. More precisely, the transformation first rotates through the angle
 theta (in radians, counterclockwise), and then translates by the vector (x, y).
 */
-void mat33Isometry(double theta, double x, double y, double isom[3][3]) {
-	double s = sin(theta);
-	double c = cos(theta);
+void mat33Isometry(vecReal theta, vecReal x, vecReal y, vecReal isom[3][3]) {
+	vecReal s = sin(theta);
+	vecReal c = cos(theta);
 
 	isom[0][0]=c;
 	isom[0][1]= (-1)*s;
@@ -93,10 +93,10 @@ void mat33Isometry(double theta, double x, double y, double isom[3][3]) {
 /* Given a length-1 3D vector axis and an angle theta (in radians), builds the
 rotation matrix for the rotation about that axis through that angle. Based on
 Rodrigues' rotation formula R = I + (sin theta) U + (1 - cos theta) U^2. */
-void mat33AngleAxisRotation(double theta, double axis[3], double rot[3][3]) {
+void mat33AngleAxisRotation(vecReal theta, vecReal axis[3], vecReal rot[3][3]) {
 
-	double U[3][3];
-	double Usq[3][3];
+	vecReal U[3][3];
+	vecReal Usq[3][3];
 
 	U[0][0] = 0.0;
 	U[0][1] = (-1)*axis[2];
@@ -108,7 +108,7 @@ void mat33AngleAxisRotation(double theta, double axis[3], double rot[3][3]) {
 	U[2][1] = axis[0];
 	U[2][2] = 0.0;
 
-	double I[3][3] = {{1.0,0.0,0.0},
+	vecReal I[3][3] = {{1.0,0.0,0.0},
 										{0.0,1.0,0.0},
 										{0.0,0.0,1.0}};
 
@@ -124,13 +124,13 @@ void mat33AngleAxisRotation(double theta, double axis[3], double rot[3][3]) {
 /* Given two length-1 3D vectors u, v that are perpendicular to each other.
 Given two length-1 3D vectors a, b that are perpendicular to each other. Builds
 the rotation matrix that rotates u to a and v to b. */
-void mat33BasisRotation(double u[3], double v[3], double a[3], double b[3],
-        double rot[3][3]) {
+void mat33BasisRotation(vecReal u[3], vecReal v[3], vecReal a[3], vecReal b[3],
+        vecReal rot[3][3]) {
 
-	double R[3][3];
-	double S[3][3];
+	vecReal R[3][3];
+	vecReal S[3][3];
 
-	double uDotv[3];
+	vecReal uDotv[3];
 	vec3Cross(u, v, uDotv);
 
 	for (int i = 0; i < 3 ; i++){
@@ -145,7 +145,7 @@ void mat33BasisRotation(double u[3], double v[3], double a[3], double b[3],
 		R[i][2] = uDotv[i];
 	}
 
-	double aDotb[3];
+	vecReal aDotb[3];
 	vec3Cross(a, b, aDotb);
 
 	for (int i = 0; i < 3 ; i++){
@@ -160,7 +160,7 @@ void mat33BasisRotation(double u[3], double v[3], double a[3], double b[3],
 		S[i][2] = aDotb[i];
 	}
 
-	double R_T[3][3];
+	vecReal R_T[3][3];
 
 	for (int i = 0; i < 3; i++) {
 		for (int j = 0; j < 3; j++) {
@@ -172,7 +172,7 @@ void mat33BasisRotation(double u[3], double v[3], double a[3], double b[3],
 }
 
 /* Multiplies m by n, placing the answer in mTimesN. */
-void mat444Multiply(double m[4][4], double n[4][4], double mTimesN[4][4]) {
+void mat444Multiply(vecReal m[4][4], vecReal n[4][4], vecReal mTimesN[4][4]) {
 	for (int i = 0; i < 4; i++) {
 		for (int j = 0; j < 4; j++) {
 			mTimesN[i][j] = m[i][0]*n[0][j] + m[i][1]*n[1][j] + m[i][2]*n[2][j]
@@ -182,15 +182,100 @@ void mat444Multiply(double m[4][4], double n[4][4], double mTimesN[4][4]) {
 }
 
 /* Multiplies m by v, placing the answer in mTimesV. */
-void mat441Multiply(double m[4][4], double v[4], double mTimesV[4]) {
+void mat441Multiply(vecReal m[4][4], vecReal v[4], vecReal mTimesV[4]) {
 		for (int i = 0; i < 4; i++) {
 			mTimesV[i] = m[i][0]*v[0] + m[i][1]*v[1] + m[i][2]*v[2] + m[i][3]*v[3];
 		}
 }
 
+/* Multiplies m by the n vectors (x[l], y[l], z[l], w), placing component i of
+the lth answer in mTimesV[i][l]. Any of the four mTimesV[i] may be NULL, if
+that component is not wanted. Each component is computed exactly as in
+mat441Multiply. */
+void mat441MultiplySoAScalar(vecReal m[4][4], int n, const vecReal x[],
+		const vecReal y[], const vecReal z[], vecReal w, vecReal *mTimesV[4]) {
+	for (int i = 0; i < 4; i++) {
+		if (mTimesV[i] == NULL)
+			continue;
+		vecReal mw = m[i][3]*w;
+		for (int l = 0; l < n; l++)
+			mTimesV[i][l] = m[i][0]*x[l] + m[i][1]*y[l] + m[i][2]*z[l] + mw;
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#ifdef vecDOUBLE
+/* Four vectors per step. */
+__attribute__((target("avx2")))
+void mat441MultiplySoAAVX2(vecReal m[4][4], int n, const vecReal x[],
+		const vecReal y[], const vecReal z[], vecReal w, vecReal *mTimesV[4]) {
+	for (int i = 0; i < 4; i++) {
+		if (mTimesV[i] == NULL)
+			continue;
+		__m256d m0 = _mm256_set1_pd(m[i][0]), m1 = _mm256_set1_pd(m[i][1]);
+		__m256d m2 = _mm256_set1_pd(m[i][2]), mw = _mm256_set1_pd(m[i][3]*w);
+		int l;
+		for (l = 0; l + 4 <= n; l += 4) {
+			__m256d sum = _mm256_add_pd(
+				_mm256_add_pd(
+					_mm256_add_pd(_mm256_mul_pd(m0, _mm256_loadu_pd(&x[l])),
+						_mm256_mul_pd(m1, _mm256_loadu_pd(&y[l]))),
+					_mm256_mul_pd(m2, _mm256_loadu_pd(&z[l]))),
+				mw);
+			_mm256_storeu_pd(&mTimesV[i][l], sum);
+		}
+		vecReal mwScalar = m[i][3]*w;
+		for (; l < n; l++)
+			mTimesV[i][l] = m[i][0]*x[l] + m[i][1]*y[l] + m[i][2]*z[l] + mwScalar;
+	}
+}
+#else
+/* Eight vectors per step. */
+__attribute__((target("avx2")))
+void mat441MultiplySoAAVX2(vecReal m[4][4], int n, const vecReal x[],
+		const vecReal y[], const vecReal z[], vecReal w, vecReal *mTimesV[4]) {
+	for (int i = 0; i < 4; i++) {
+		if (mTimesV[i] == NULL)
+			continue;
+		__m256 m0 = _mm256_set1_ps(m[i][0]), m1 = _mm256_set1_ps(m[i][1]);
+		__m256 m2 = _mm256_set1_ps(m[i][2]), mw = _mm256_set1_ps(m[i][3]*w);
+		int l;
+		for (l = 0; l + 8 <= n; l += 8) {
+			__m256 sum = _mm256_add_ps(
+				_mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(m0, _mm256_loadu_ps(&x[l])),
+						_mm256_mul_ps(m1, _mm256_loadu_ps(&y[l]))),
+					_mm256_mul_ps(m2, _mm256_loadu_ps(&z[l]))),
+				mw);
+			_mm256_storeu_ps(&mTimesV[i][l], sum);
+		}
+		vecReal mwScalar = m[i][3]*w;
+		for (; l < n; l++)
+			mTimesV[i][l] = m[i][0]*x[l] + m[i][1]*y[l] + m[i][2]*z[l] + mwScalar;
+	}
+}
+#endif
+#endif
+
+/* Multiplies m by n vectors in structure-of-arrays form, as described at
+mat441MultiplySoAScalar, using AVX2 when the processor has it. This is the
+batched counterpart of mat441Multiply, for renRenderer's transformVertices. */
+void mat441MultiplySoA(vecReal m[4][4], int n, const vecReal x[],
+		const vecReal y[], const vecReal z[], vecReal w, vecReal *mTimesV[4]) {
+#if defined(__x86_64__) || defined(__i386__)
+	if (__builtin_cpu_supports("avx2")) {
+		mat441MultiplySoAAVX2(m, n, x, y, z, w, mTimesV);
+		return;
+	}
+#endif
+	mat441MultiplySoAScalar(m, n, x, y, z, w, mTimesV);
+}
+
 /* Given a rotation and a translation, forms the 4x4 homogeneous matrix
 representing the rotation followed in time by the translation. */
-void mat44Isometry(double rot[3][3], double trans[3], double isom[4][4]) {
+void mat44Isometry(vecReal rot[3][3], vecReal trans[3], vecReal isom[4][4]) {
 
 	for (int i = 0; i < 3; i++) {
 		for (int j = 0; j < 3; j++) {
@@ -208,14 +293,14 @@ void mat44Isometry(double rot[3][3], double trans[3], double isom[4][4]) {
 }
 
 /* Pretty-prints the given matrix, with one line of text per row of matrix. */
-void mat44Print(double m[4][4]) {
+void mat44Print(vecReal m[4][4]) {
 	printf("**************\n");
 	for (int i = 0; i < 4; i += 1)
 		printf("%f    %f		%f		%f\n", m[i][0], m[i][1], m[i][2], m[i][3]);
 	printf("**************\n");
 }
 
-void mat33Print(double m[3][3]) {
+void mat33Print(vecReal m[3][3]) {
 	printf("**************\n");
 	for (int i = 0; i < 3; i += 1)
 		printf("%f    %f		%f\n", m[i][0], m[i][1], m[i][2]);
@@ -225,10 +310,10 @@ void mat33Print(double m[3][3]) {
 representing the inverse translation followed in time by the inverse rotation.
 That is, the isom produced by this function is the inverse to the isom
 produced by mat44Isometry on the same inputs. */
-void mat44InverseIsometry(double rot[3][3], double trans[3],
-        double isom[4][4]) {
+void mat44InverseIsometry(vecReal rot[3][3], vecReal trans[3],
+        vecReal isom[4][4]) {
 
-	double rot_T[3][3];
+	vecReal rot_T[3][3];
 	mat33Transpose(rot, rot_T);
 
 	//printf("[%f , %f , %f \n",trans[0], trans[1], trans[2]);
@@ -249,7 +334,7 @@ void mat44InverseIsometry(double rot[3][3], double trans[3],
 	isom[3][3] = 1.0;
 }
 
-void mat44Copy(double input[4][4], double copy[4][4]) {
+void mat44Copy(vecReal input[4][4], vecReal copy[4][4]) {
 	for (int i = 0; i < 4; i++) {
 		for (int j = 0; j < 4; j++) {
 			copy[i][j] = input[i][j];
@@ -262,8 +347,8 @@ volume [left, right] x [bottom, top] x [far, near]. That is, on the near plane
 the box is the rectangle R = [left, right] x [bottom, top], and on the far
 plane the box is the same rectangle R. Keep in mind that 0 > near > far. Maps
 the viewing volume to [-1, 1] x [-1, 1] x [-1, 1]. */
-void mat44Orthographic(double left, double right, double bottom, double top,
-        double far, double near, double proj[4][4]) {
+void mat44Orthographic(vecReal left, vecReal right, vecReal bottom, vecReal top,
+        vecReal far, vecReal near, vecReal proj[4][4]) {
 	//printf("near: %f, far: %f\n", near, far);
 	proj[0][0] = 2.0/(right-left);
 	proj[0][1] = 0.0;
@@ -286,7 +371,7 @@ void mat44Orthographic(double left, double right, double bottom, double top,
 
 /* Builds a 4x4 matrix that maps a projected viewing volume
 [-1, 1] x [-1, 1] x [-1, 1] to screen [0, w - 1] x [0, h - 1] x [-1, 1]. */
-void mat44Viewport(double width, double height, double view[4][4]) {
+void mat44Viewport(vecReal width, vecReal height, vecReal view[4][4]) {
 	view[0][0] = (width-1.0)/2.0;
 	view[0][1] = 0.0;
 	view[0][2] = 0.0;
@@ -310,8 +395,8 @@ is contained between the near and far planes, with 0 > near > far. On the near
 plane, the frustum is the rectangle R = [left, right] x [bottom, top]. On the
 far plane, the frustum is the rectangle (far / near) * R. Maps the viewing
 volume to [-1, 1] x [-1, 1] x [-1, 1]. */
-void mat44Perspective(double left, double right, double bottom, double top,
-        double far, double near, double proj[4][4]) {
+void mat44Perspective(vecReal left, vecReal right, vecReal bottom, vecReal top,
+        vecReal far, vecReal near, vecReal proj[4][4]) {
 	proj[0][0] = (-2.0*near)/(right-left);
 	proj[0][1] = 0.0;
 	proj[0][2] = (right+left)/(right-left);
@@ -1,197 +1,222 @@
 /*
 @ Author:  Sabastian Mugazambi & Tore Banta
 @ Date: 01/07/2017
-This file has functions for clipping.
+This file has functions for clipping. Triangles are clipped in homogeneous
+clip space, as polygons, against the near and far planes and against a guard
+band around the viewport. Whatever pokes out of the viewport but stays inside
+the guard band is left for the rasterizer, which only visits on-screen pixels.
 */
 
-void doViewPort(renRenderer *ren, double ogvert[], double transVert[]) {
-
-  double scaleVec[renVARYDIMBOUND];
-  vecScale(ren->varyDim, 1.0 / ogvert[renVARYW], ogvert, scaleVec);
+/* The guard band is clipGUARDBAND times as wide and as tall as the viewport. */
+#define clipGUARDBAND 4.0
+/* Clipping a triangle against six planes leaves at most nine vertices. */
+#define clipVERTBOUND 9
+
+#define clipNEAR 1
+#define clipFAR 2
+#define clipLEFT 4
+#define clipRIGHT 8
+#define clipBOTTOM 16
+#define clipTOP 32
+
+/* The functions that take dim, the number of varyings, are inlined into
+clipTriangle, and so into each of its copies, in which dim is a constant. */
+
+static inline __attribute__((always_inline))
+void doViewPort(renRenderer *ren, int dim, vecReal ogvert[],
+                vecReal transVert[]) {
+  int k;
+  vecReal scaleVec[4], invW = 1.0 / ogvert[renVARYW];
+  for (k = 0; k < 4; k += 1)
+    scaleVec[k] = invW * ogvert[k];
   mat441Multiply(ren->viewport, scaleVec, transVert);
 
-  vecCopy(ren->varyDim - 4, &ogvert[renVARYS], &transVert[renVARYS]);
+  for (k = renVARYS; k < dim; k += 1)
+    transVert[k] = ogvert[k];
+  /* Keep 1 / w, so that the rasterizer can interpolate the other varyings
+  with perspective correction. */
+  transVert[renVARYW] = 1.0 / ogvert[renVARYW];
 }
 
-void findNewVert(renRenderer *ren, double clipped[], double notClipped[],
-                 double finalVec[]) {
-
-  double sub_vec[renVARYDIMBOUND], add_vec[renVARYDIMBOUND];
-  double t = (clipped[3] - clipped[2]) /
-             (clipped[3] - clipped[2] + notClipped[2] - notClipped[3]);
-
-  vecSubtract(ren->varyDim, notClipped, clipped, sub_vec);
-  vecScale(ren->varyDim, t, sub_vec, add_vec);
-  vecAdd(ren->varyDim, clipped, add_vec, finalVec);
+/* Returns the signed distance-like value of the vertex from the plane, which
+is nonnegative on the inside. With guard nonzero, the side planes are pushed
+out to the guard band. The near plane is z = w and the far plane z = -w. */
+vecReal clipDistance(vecReal vert[], int plane, vecReal guard) {
+  switch (plane) {
+    case clipNEAR:   return vert[renVARYW] - vert[renVARYZ];
+    case clipFAR:    return vert[renVARYW] + vert[renVARYZ];
+    case clipLEFT:   return guard * vert[renVARYW] + vert[renVARYX];
+    case clipRIGHT:  return guard * vert[renVARYW] - vert[renVARYX];
+    case clipBOTTOM: return guard * vert[renVARYW] + vert[renVARYY];
+    default:         return guard * vert[renVARYW] - vert[renVARYY];
+  }
 }
 
-void clip_one(renRenderer *ren, double unif[], texTexture *tex[], double a[],
-              double b[], double c[], int clip_vert) {
-
-  // call doViewPort for each vertex
-  double sub_vec[renVARYDIMBOUND], add_vec[renVARYDIMBOUND], t;
-  double scaleVec[renVARYDIMBOUND];
-  double view_a[renVARYDIMBOUND], view_b[renVARYDIMBOUND],
-      view_c[renVARYDIMBOUND];
-  double view_L[renVARYDIMBOUND], view_R[renVARYDIMBOUND];
-
-  if (clip_vert == 1) {
-
-    double new_aL[renVARYDIMBOUND], new_aR[renVARYDIMBOUND];
-    // void findNewVert(renRenderer *ren, double clipped[], double notClipped[],
-    // double finalVec[])
-    findNewVert(ren, a, b, new_aL);
-    findNewVert(ren, a, c, new_aR);
-
-    doViewPort(ren, new_aL, view_L);
-    doViewPort(ren, b, view_b);
-    doViewPort(ren, new_aR, view_R);
-    doViewPort(ren, c, view_c);
-
-    triRender(ren, unif, tex, view_L, view_b, view_R);
-    triRender(ren, unif, tex, view_R, view_b, view_c);
-
-  } else if (clip_vert == 2) {
-
-    double new_bL[renVARYDIMBOUND], new_bR[renVARYDIMBOUND];
-    // void findNewVert(renRenderer *ren, double clipped[], double notClipped[],
-    // double finalVec[])
-    findNewVert(ren, b, c, new_bL);
-    findNewVert(ren, b, a, new_bR);
-
-    doViewPort(ren, new_bL, view_L);
-    doViewPort(ren, a, view_a);
-    doViewPort(ren, new_bR, view_R);
-    doViewPort(ren, c, view_c);
-
-    triRender(ren, unif, tex, view_L, view_c, view_R);
-    triRender(ren, unif, tex, view_R, view_c, view_a);
-
-  } else if (clip_vert == 3) {
-
-    double new_cL[renVARYDIMBOUND], new_cR[renVARYDIMBOUND];
-    // void findNewVert(renRenderer *ren, double clipped[], double notClipped[],
-    // double finalVec[])
-    findNewVert(ren, c, a, new_cL);
-    findNewVert(ren, c, b, new_cR);
-
-    doViewPort(ren, new_cL, view_L);
-    doViewPort(ren, b, view_b);
-    doViewPort(ren, new_cR, view_R);
-    doViewPort(ren, a, view_a);
+/* Returns the bits of the planes that the vertex is outside of. */
+int clipOutcode(vecReal vert[], vecReal guard) {
+  int code = 0, plane;
+  for (plane = clipNEAR; plane <= clipTOP; plane <<= 1)
+    if (clipDistance(vert, plane, guard) < 0.0)
+      code |= plane;
+  return code;
+}
 
-    triRender(ren, unif, tex, new_cL, a, new_cR);
-    triRender(ren, unif, tex, new_cR, a, b);
+/*
+@function clipPolygon
+@param (int dim, vecReal in[][renVARYDIMBOUND], int inNum, int plane,
+vecReal out[][renVARYDIMBOUND]), where the vertices have dim varyings.
+@purpose One Sutherland-Hodgman pass: copies the convex polygon in, minus
+whatever is outside of the plane, into out, and returns its number of
+vertices. New vertices are always interpolated from the inside vertex toward
+the outside one, so that two triangles sharing an edge get identical vertices
+on it.
+*/
+static inline __attribute__((always_inline))
+int clipPolygon(int dim, vecReal in[][renVARYDIMBOUND], int inNum, int plane,
+                vecReal out[][renVARYDIMBOUND]) {
+  int outNum = 0, i, k;
+  vecReal guard = (plane == clipNEAR || plane == clipFAR) ? 1.0 : clipGUARDBAND;
+  for (i = 0; i < inNum; i += 1) {
+    vecReal *v = in[i], *next = in[(i + 1) % inNum];
+    vecReal dV = clipDistance(v, plane, guard);
+    vecReal dNext = clipDistance(next, plane, guard);
+    if (dV >= 0.0) {
+      for (k = 0; k < dim; k += 1)
+        out[outNum][k] = v[k];
+      outNum += 1;
+    }
+    if ((dV >= 0.0) != (dNext >= 0.0)) {
+      vecReal *inside = (dV >= 0.0) ? v : next;
+      vecReal *outside = (dV >= 0.0) ? next : v;
+      vecReal dIn = (dV >= 0.0) ? dV : dNext;
+      vecReal dOut = (dV >= 0.0) ? dNext : dV;
+      vecReal t = dIn / (dIn - dOut);
+      for (k = 0; k < dim; k += 1)
+        out[outNum][k] = inside[k] + t * (outside[k] - inside[k]);
+      outNum += 1;
+    }
   }
+  return outNum;
 }
 
-void clip_two(renRenderer *ren, double unif[], texTexture *tex[], double a[],
-              double b[], double c[], int clip_vert1, int clip_vert2) {
-  double view_a[renVARYDIMBOUND], view_b[renVARYDIMBOUND],
-      view_c[renVARYDIMBOUND];
-
-  if (clip_vert1 == 1 && clip_vert2 == 2) {
-
-    double new_a[renVARYDIMBOUND], new_b[renVARYDIMBOUND];
-    // void findNewVert(renRenderer *ren, double clipped[], double notClipped[],
-    // double finalVec[])
-    findNewVert(ren, a, c, new_a);
-    findNewVert(ren, a, b, new_b);
-
-    doViewPort(ren, new_a, view_a);
-    doViewPort(ren, new_b, view_b);
-    doViewPort(ren, c, view_c);
-
-    triRender(ren, unif, tex, view_a, view_b, view_c);
-  } else if (clip_vert1 == 1 && clip_vert2 == 3) {
-
-    double new_a[renVARYDIMBOUND], new_c[renVARYDIMBOUND];
-    // void findNewVert(renRenderer *ren, double clipped[], double notClipped[],
-    // double finalVec[])
-    findNewVert(ren, a, b, new_a);
-    findNewVert(ren, c, b, new_c);
-
-    doViewPort(ren, new_a, view_a);
-    doViewPort(ren, b, view_b);
-    doViewPort(ren, new_c, view_c);
-
-    triRender(ren, unif, tex, view_a, view_b, view_c);
-
-  } else if (clip_vert1 == 2 && clip_vert2 == 3) {
-
-    double new_b[renVARYDIMBOUND], new_c[renVARYDIMBOUND];
-    // void findNewVert(renRenderer *ren, double clipped[], double notClipped[],
-    // double finalVec[])
-    findNewVert(ren, b, a, new_b);
-    findNewVert(ren, c, a, new_c);
-
-    doViewPort(ren, a, view_a);
-    doViewPort(ren, new_b, view_b);
-    doViewPort(ren, new_c, view_c);
-
-    triRender(ren, unif, tex, view_a, view_b, view_c);
+/*
+@function clipCulled
+@param (renRenderer *ren, vecReal a[], vecReal b[], vecReal c[]), where a, b, c
+are the vertices in homogeneous clip coordinates.
+@purpose Returns 1 if the triangle should be discarded by the renderer's cull
+mode, or because it has zero area on the screen, and 0 otherwise. The test is
+the determinant of the vertices' (X, Y, W) rows, which is the screen-space
+signed area times the product of the three W, so it gives the orientation on
+the screen without dividing by W, and stays right when some W are negative.
+*/
+int clipCulled(renRenderer *ren, vecReal a[], vecReal b[], vecReal c[]) {
+  vecReal det =
+      a[renVARYX] * (b[renVARYY] * c[renVARYW] - b[renVARYW] * c[renVARYY]) -
+      a[renVARYY] * (b[renVARYX] * c[renVARYW] - b[renVARYW] * c[renVARYX]) +
+      a[renVARYW] * (b[renVARYX] * c[renVARYY] - b[renVARYY] * c[renVARYX]);
+  if (det == 0.0) {
+    ren->stats.degenerateNum += 1;
+    return 1;
+  }
+  if ((ren->cullMode == renCULLBACK && det < 0.0) ||
+      (ren->cullMode == renCULLFRONT && det > 0.0)) {
+    ren->stats.culledNum += 1;
+    return 1;
   }
+  return 0;
 }
 
-void clipRender(renRenderer *ren, double unif[], texTexture *tex[], double a[],
-                double b[], double c[]) {
-
-  // do shiftIsDown
-  double bminusa[2], cminusa[2], m[2][2], mInv[2][2], pq[2];
-  vecSubtract(2, b, a, bminusa);
-  vecSubtract(2, c, a, cminusa);
-  mat22Columns(bminusa, cminusa, m);
-  mat22Columns(bminusa, cminusa, mInv);
-
-  if (mat22Invert(m, mInv) < 0.0) {
+/* The body of clipRender, for vertices with dim varyings. It is inlined into
+one copy for each dim from clipDIMMIN to clipDIMMAX, in which dim is a
+constant, so that the loops over the varyings are unrolled. */
+static inline __attribute__((always_inline))
+void clipTriangle(renRenderer *ren, vecReal unif[], texTexture *tex[],
+                  vecReal a[], vecReal b[], vecReal c[], int dim) {
+  if (ren->statsOn)
+    ren->stats.triangleNum += 1;
+  if (clipCulled(ren, a, b, c)) {
     return;
   }
-
-  int a_clip = 0;
-  int b_clip = 0;
-  int c_clip = 0;
-
-  if (a[renVARYW] <= 0 || a[renVARYZ] > a[renVARYW]) a_clip = 1;
-  if (b[renVARYW] <= 0 || b[renVARYZ] > b[renVARYW]) b_clip = 1;
-  if (c[renVARYW] <= 0 || c[renVARYZ] > c[renVARYW]) c_clip = 1;
-
-  // printf("[%f, %f, %f, %f]\n",a[0],a[1],a[2],a[3] );
-
-  if (a_clip == 1 && b_clip == 1 && c_clip == 1) {
-    //printf("clipped triangle\n");
+  if ((clipOutcode(a, 1.0) & clipOutcode(b, 1.0) & clipOutcode(c, 1.0)) != 0) {
+    if (ren->statsOn)
+      ren->stats.rejectedNum += 1;
     return;
-  } else if (a_clip == 0 && b_clip == 0 && c_clip == 0) {
+  }
+  int crossed = clipOutcode(a, clipGUARDBAND) | clipOutcode(b, clipGUARDBAND) |
+                clipOutcode(c, clipGUARDBAND);
+  vecReal view[clipVERTBOUND][renVARYDIMBOUND];
+  if (crossed == 0) {
+    doViewPort(ren, dim, a, view[0]);
+    doViewPort(ren, dim, b, view[1]);
+    doViewPort(ren, dim, c, view[2]);
+    triRender(ren, unif, tex, view[0], view[1], view[2]);
+    return;
+  }
 
-    double view_a[renVARYDIMBOUND], view_b[renVARYDIMBOUND],
-        view_c[renVARYDIMBOUND];
+  /* Ping-pong between two fixed-size polygons, one plane at a time. */
+  vecReal polys[2][clipVERTBOUND][renVARYDIMBOUND];
+  int vertNum = 3, from = 0, plane, i, k;
+  for (k = 0; k < dim; k += 1) {
+    polys[0][0][k] = a[k];
+    polys[0][1][k] = b[k];
+    polys[0][2][k] = c[k];
+  }
+  for (plane = clipNEAR; plane <= clipTOP && vertNum >= 3; plane <<= 1)
+    if ((crossed & plane) != 0) {
+      vertNum = clipPolygon(dim, polys[from], vertNum, plane, polys[1 - from]);
+      from = 1 - from;
+    }
+  if (ren->statsOn) {
+    ren->stats.clippedNum += 1;
+    ren->stats.clipOutNum += (vertNum < 3) ? 0 : vertNum - 2;
+  }
+  if (vertNum < 3) {
+    return;
+  }
+  for (i = 0; i < vertNum; i += 1)
+    doViewPort(ren, dim, polys[from][i], view[i]);
+  for (i = 1; i + 1 < vertNum; i += 1)
+    triRender(ren, unif, tex, view[0], view[i], view[i + 1]);
+}
 
-    // doViewPort(renRenderer *ren, double ogvert[] , double transVert[])
-    doViewPort(ren, a, view_a);
-    doViewPort(ren, b, view_b);
-    doViewPort(ren, c, view_c);
+/* Vertices with from clipDIMMIN to clipDIMMAX varyings get a copy of
+clipTriangle of their own. */
+#define clipDIMMIN 4
+#define clipDIMMAX 16
 
-    // printf("No clip, rendering... [%f,%f,%f] [%f,%f,%f] [%f,%f,%f]\n", a[0],
-    //        a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2]);
-    triRender(ren, unif, tex, view_a, view_b, view_c);
-  } else {
-    if (a_clip == 1 && b_clip == 0 && c_clip == 0) {
-      // printf("1\n");
-      clip_one(ren, unif, tex, a, b, c, 1);
-    } else if (a_clip == 1 && b_clip == 1 && c_clip == 0) {
-      // printf("2\n");
-      clip_two(ren, unif, tex, a, b, c, 1, 2);
-    } else if (a_clip == 1 && b_clip == 0 && c_clip == 1) {
-      // printf("3\n");
-      clip_two(ren, unif, tex, a, b, c, 1, 3);
-    } else if (a_clip == 0 && b_clip == 1 && c_clip == 0) {
-      // printf("4\n");
-      clip_one(ren, unif, tex, a, b, c, 2);
-    } else if (a_clip == 0 && b_clip == 1 && c_clip == 1) {
-      // printf("5\n");
-      clip_two(ren, unif, tex, a, b, c, 2, 3);
-    } else if (a_clip == 0 && b_clip == 0 && c_clip == 1) {
-      // printf("6\n");
-      clip_one(ren, unif, tex, a, b, c, 3);
-    }
+#define clipCLIPPER(n) \
+  void clipTriangle##n(renRenderer *ren, vecReal unif[], texTexture *tex[], \
+                       vecReal a[], vecReal b[], vecReal c[]) { \
+    clipTriangle(ren, unif, tex, a, b, c, n); \
   }
+clipCLIPPER(4) clipCLIPPER(5) clipCLIPPER(6) clipCLIPPER(7) clipCLIPPER(8)
+clipCLIPPER(9) clipCLIPPER(10) clipCLIPPER(11) clipCLIPPER(12)
+clipCLIPPER(13) clipCLIPPER(14) clipCLIPPER(15) clipCLIPPER(16)
+
+void (*clipTriangles[clipDIMMAX - clipDIMMIN + 1])(renRenderer *, vecReal[],
+                                                  texTexture *[], vecReal[],
+                                                  vecReal[], vecReal[]) = {
+    clipTriangle4, clipTriangle5, clipTriangle6, clipTriangle7, clipTriangle8,
+    clipTriangle9, clipTriangle10, clipTriangle11, clipTriangle12,
+    clipTriangle13, clipTriangle14, clipTriangle15, clipTriangle16};
+
+/*
+@function clipRender
+@param (renRenderer *ren, vecReal unif[], texTexture *tex[], vecReal a[],
+vecReal b[], vecReal c[]), where a, b, c are the vertices in homogeneous clip
+coordinates.
+@purpose Culls the triangle (see clipCulled), clips it, and sends whatever
+remains through the viewport to triRender. A triangle that is entirely outside
+one of the six frustum planes is discarded. A triangle that is inside the near
+and far planes and the guard band, which is most of them, is not clipped at
+all. Otherwise the triangle is clipped, as a polygon, against only the planes
+that it crosses, and the polygon is drawn as a fan of triangles. The work is
+done by the copy of clipTriangle for the renderer's varyDim.
+*/
+void clipRender(renRenderer *ren, vecReal unif[], texTexture *tex[],
+                vecReal a[], vecReal b[], vecReal c[]) {
+  if (ren->varyDim >= clipDIMMIN && ren->varyDim <= clipDIMMAX)
+    clipTriangles[ren->varyDim - clipDIMMIN](ren, unif, tex, a, b, c);
+  else
+    clipTriangle(ren, unif, tex, a, b, c, ren->varyDim);
 }
@@ -1,14 +1,74 @@
 
 
+#include <string.h>
+
 /*** Creating and destroying ***/
 
+#define meshAOS 0
+#define meshSOA 1
+
+typedef struct meshMesh meshMesh;
+
+/* A store of one mesh's transformed vertices, which is kept between frames and
+reused for as long as the mesh, the renderer's transformation and the uniforms
+stay the same. Every mesh has one, which meshRender uses. A mesh that is drawn
+with several sets of uniforms every frame, such as one mesh shared by several
+scene nodes, needs one store per set, or else each draw throws away the
+vertices of the one before it; see meshRenderCached. Feel free to read the
+struct's members, but don't write them. */
+typedef struct meshCache meshCache;
+struct meshCache {
+  meshMesh *mesh;        /* the mesh that vary was made from, or NULL */
+  unsigned int version;  /* mesh->version when vary was made */
+  int varyDim, unifDim, vertNum;
+  void (*transform)(renRenderer *, vecReal[], vecReal[], vecReal[]);
+  void (*transforms)(renRenderer *, vecReal[], int, const vecReal[], int,
+                     vecReal[], int);
+  vecReal *vary;         /* vertNum * varyDim numbers */
+  vecReal *unif;         /* unifDim numbers, in the same block as vary */
+};
+
+/* Initializes an empty store. Don't forget to call meshCacheDestroy. */
+void meshCacheInitialize(meshCache *cache) {
+  cache->mesh = NULL;
+  cache->version = 0;
+  cache->varyDim = 0;
+  cache->unifDim = 0;
+  cache->vertNum = 0;
+  cache->transform = NULL;
+  cache->transforms = NULL;
+  cache->vary = NULL;
+  cache->unif = NULL;
+}
+
+/* Deallocates the resources backing the store. */
+void meshCacheDestroy(meshCache *cache) {
+  free(cache->vary);
+  meshCacheInitialize(cache);
+}
+
+/* Every change to any mesh gets a new version number, so that a store made
+from a mesh that has since changed, or been destroyed and had its memory
+reused by another mesh, never matches. */
+unsigned int meshVersions = 0;
+
 /* Feel free to read the struct's members, but don't write them, except through
 the accessors below such as meshSetTriangle, meshSetVertex. */
-typedef struct meshMesh meshMesh;
 struct meshMesh {
   int triNum, vertNum, attrDim;
-  int *tri;     /* triNum * 3 ints */
-  double *vert; /* vertNum * attrDim doubles */
+  int *tri;      /* triNum * 3 ints */
+  vecReal *vert; /* vertNum * attrDim numbers */
+  int usedNum;       /* number of vertices used by triangles, or -1 if unknown */
+  int *used;         /* their indices, in increasing order */
+  unsigned int version; /* changes whenever the triangles or vertices do */
+  meshCache cache;   /* meshRender's store of transformed vertices */
+  /* In the meshSOA layout, a copy of vert in structure-of-arrays form, for
+  batched vertex transformation. See meshSetLayout. */
+  int layout, soaValid;
+  vecReal *soa;      /* attribute k of vertex v at soa[k * vertNum + v] */
+  /* The center of the vertices' bounding box, made by meshGetCenter. */
+  int centerValid;
+  vecReal *center;   /* attrDim numbers */
 };
 
 /* Initializes a mesh with enough memory to hold its triangles and vertices.
@@ -17,22 +77,45 @@ you are finished with the mesh, you must call meshDestroy to deallocate its
 backing resources. */
 int meshInitialize(meshMesh *mesh, int triNum, int vertNum, int attrDim) {
   mesh->tri = (int *)malloc(triNum * 3 * sizeof(int) +
-                            vertNum * attrDim * sizeof(double));
+                            vertNum * attrDim * sizeof(vecReal));
   if (mesh->tri != NULL) {
-    mesh->vert = (double *)&(mesh->tri[triNum * 3]);
+    mesh->vert = (vecReal *)&(mesh->tri[triNum * 3]);
     mesh->triNum = triNum;
     mesh->vertNum = vertNum;
     mesh->attrDim = attrDim;
+    mesh->usedNum = -1;
+    mesh->used = NULL;
+    meshVersions += 1;
+    mesh->version = meshVersions;
+    meshCacheInitialize(&mesh->cache);
+    mesh->layout = meshAOS;
+    mesh->soaValid = 0;
+    mesh->soa = NULL;
+    mesh->centerValid = 0;
+    mesh->center = NULL;
   }
   return (mesh->tri == NULL);
 }
 
+/* Tells the mesh that its triangles or vertices have changed, so that
+meshRender does not reuse stale transformed vertices. The setters below call
+this themselves; call it yourself after writing through the pointers that the
+getters return, once the mesh has been rendered. */
+void meshUpdated(meshMesh *mesh) {
+  mesh->usedNum = -1;
+  meshVersions += 1;
+  mesh->version = meshVersions;
+  mesh->soaValid = 0;
+  mesh->centerValid = 0;
+}
+
 /* Sets the trith triangle to have vertex indices i, j, k. */
 void meshSetTriangle(meshMesh *mesh, int tri, int i, int j, int k) {
   if (0 <= tri && tri < mesh->triNum) {
     mesh->tri[3 * tri] = i;
     mesh->tri[3 * tri + 1] = j;
     mesh->tri[3 * tri + 2] = k;
+    meshUpdated(mesh);
   }
 }
 
@@ -47,17 +130,24 @@ int *meshGetTrianglePointer(meshMesh *mesh, int tri) {
 }
 
 /* Sets the vertth vertex to have attributes attr. */
-void meshSetVertex(meshMesh *mesh, int vert, double attr[]) {
+void meshSetVertex(meshMesh *mesh, int vert, vecReal attr[]) {
   int k;
-  if (0 <= vert && vert < mesh->vertNum)
+  if (0 <= vert && vert < mesh->vertNum) {
     for (k = 0; k < mesh->attrDim; k += 1)
       mesh->vert[mesh->attrDim * vert + k] = attr[k];
+    if (mesh->soaValid)
+      for (k = 0; k < mesh->attrDim; k += 1)
+        mesh->soa[mesh->vertNum * k + vert] = attr[k];
+    meshVersions += 1;
+    mesh->version = meshVersions;
+    mesh->centerValid = 0;
+  }
 }
 
 /* Returns a pointer to the vertth vertex. For example:
-        double *vertex13 = meshGetVertexPointer(&mesh, 13);
+        vecReal *vertex13 = meshGetVertexPointer(&mesh, 13);
         printf("x = %f, y = %f\n", vertex13[0], vertex13[1]); */
-double *meshGetVertexPointer(meshMesh *mesh, int vert) {
+vecReal *meshGetVertexPointer(meshMesh *mesh, int vert) {
   if (0 <= vert && vert < mesh->vertNum)
     return &mesh->vert[vert * mesh->attrDim];
   else
@@ -69,56 +159,252 @@ when you are finished using a mesh. */
 void meshDestroy(meshMesh *mesh) {
   // Should test whether pointer NULL. If so, free and set to NULL.!!
   free(mesh->tri);
+  free(mesh->used);
+  meshCacheDestroy(&mesh->cache);
+  free(mesh->soa);
+  free(mesh->center);
+}
+
+/* Returns the center of the box that bounds the mesh's vertices, in every
+attribute, or NULL if it is out of memory or the mesh has no vertices. It is
+worked out once, and again only after the vertices change. */
+vecReal *meshGetCenter(meshMesh *mesh) {
+  int v, k;
+  if (mesh->centerValid)
+    return mesh->center;
+  if (mesh->vertNum == 0)
+    return NULL;
+  if (mesh->center == NULL) {
+    mesh->center = (vecReal *)malloc(mesh->attrDim * sizeof(vecReal));
+    if (mesh->center == NULL)
+      return NULL;
+  }
+  for (k = 0; k < mesh->attrDim; k += 1) {
+    vecReal low = mesh->vert[k], high = mesh->vert[k];
+    for (v = 1; v < mesh->vertNum; v += 1) {
+      low = fmin(low, mesh->vert[v * mesh->attrDim + k]);
+      high = fmax(high, mesh->vert[v * mesh->attrDim + k]);
+    }
+    mesh->center[k] = 0.5 * (low + high);
+  }
+  mesh->centerValid = 1;
+  return mesh->center;
+}
+
+/* Sets the layout in which meshRender reads the vertices, to either meshAOS
+(the default) or meshSOA. In the meshSOA layout, the mesh also keeps its
+vertices in structure-of-arrays form, which a batched transformVertices reads
+directly, without gathering. That costs a second copy of the vertices, so it
+is worthwhile for big meshes whose vertices are mostly in use, such as
+landscapes. The vertices are still read and written as usual, through
+meshSetVertex and meshGetVertexPointer. */
+void meshSetLayout(meshMesh *mesh, int layout) {
+  mesh->layout = layout;
+  if (layout == meshAOS) {
+    free(mesh->soa);
+    mesh->soa = NULL;
+    mesh->soaValid = 0;
+  }
 }
 
 /*** Rendering ***/
 
-double meshTransformedVertices[renVERTNUMBOUND * renVARYDIMBOUND];
+/* Finds the vertices that are used by at least one triangle. Extraneous
+vertices, such as meshInitializeDissectedLandscape leaves, are never
+transformed. Returns 0 if no error occurred. */
+int meshFindUsed(meshMesh *mesh) {
+  /* One extra element keeps the allocations nonempty for an empty mesh. */
+  char *isUsed = (char *)calloc(mesh->vertNum + 1, 1);
+  int *used = (int *)realloc(mesh->used, (mesh->vertNum + 1) * sizeof(int));
+  if (isUsed == NULL || used == NULL) {
+    free(isUsed);
+    if (used != NULL)
+      mesh->used = used;
+    return 1;
+  }
+  mesh->used = used;
+  int i;
+  for (i = 0; i < 3 * mesh->triNum; i += 1)
+    if (0 <= mesh->tri[i] && mesh->tri[i] < mesh->vertNum)
+      isUsed[mesh->tri[i]] = 1;
+  mesh->usedNum = 0;
+  for (i = 0; i < mesh->vertNum; i += 1)
+    if (isUsed[i]) {
+      mesh->used[mesh->usedNum] = i;
+      mesh->usedNum += 1;
+    }
+  free(isUsed);
+  return 0;
+}
 
-double *meshGetTransformedVertexPointer(meshMesh *mesh, renRenderer *ren,
-                                        int vert) {
-  if (0 <= vert && vert < mesh->vertNum)
-    return &meshTransformedVertices[vert * ren->varyDim];
+/* Fills in the structure-of-arrays copy of the vertices. Returns 0 if no error
+occurred. */
+int meshFillSoA(meshMesh *mesh) {
+  if (mesh->soa == NULL) {
+    mesh->soa = (vecReal *)malloc((mesh->attrDim * mesh->vertNum + 1) *
+                                 sizeof(vecReal));
+    if (mesh->soa == NULL)
+      return 1;
+  }
+  int v, k;
+  for (v = 0; v < mesh->vertNum; v += 1)
+    for (k = 0; k < mesh->attrDim; k += 1)
+      mesh->soa[mesh->vertNum * k + v] = mesh->vert[mesh->attrDim * v + k];
+  mesh->soaValid = 1;
+  return 0;
+}
+
+/* Vertices go through a batched transformVertices meshBATCH at a time. */
+#define meshBATCH 64
+
+/* Transforms the used vertices into the store with ren->transformVertices.
+Runs of consecutive vertices in a meshSOA mesh are read in place; otherwise
+each batch is gathered first. The transformed batch is scattered into the
+store, where clipping expects each vertex's varyings to be together. */
+int meshTransformBatched(meshMesh *mesh, meshCache *cache, renRenderer *ren,
+                         vecReal unif[]) {
+  vecReal attrBatch[renVARYDIMBOUND * meshBATCH];
+  vecReal varyBatch[renVARYDIMBOUND * meshBATCH];
+  if (mesh->layout == meshSOA && !mesh->soaValid && meshFillSoA(mesh) != 0)
+    return 1;
+  int i, n, l, k;
+  for (i = 0; i < mesh->usedNum; i += n) {
+    n = (mesh->usedNum - i < meshBATCH) ? mesh->usedNum - i : meshBATCH;
+    int *used = &mesh->used[i];
+    const vecReal *attr = attrBatch;
+    int attrStride = meshBATCH;
+    if (mesh->layout == meshSOA && used[n - 1] - used[0] == n - 1) {
+      attr = &mesh->soa[used[0]];
+      attrStride = mesh->vertNum;
+    } else
+      for (l = 0; l < n; l += 1)
+        for (k = 0; k < mesh->attrDim; k += 1)
+          attrBatch[k * meshBATCH + l] = mesh->vert[used[l] * mesh->attrDim + k];
+    ren->transformVertices(ren, unif, n, attr, attrStride, varyBatch,
+                           meshBATCH);
+    for (l = 0; l < n; l += 1)
+      for (k = 0; k < ren->varyDim; k += 1)
+        cache->vary[used[l] * ren->varyDim + k] = varyBatch[k * meshBATCH + l];
+  }
+  return 0;
+}
+
+/* Makes sure that the store has the mesh's transformed vertices for the
+renderer and uniforms, transforming the used vertices only if the stored ones
+were made from another mesh, or a different version of this one, or with
+different uniforms. transformVertex must depend on nothing but its uniforms
+and attributes; the camera reaches it through the uniforms. Returns 0 if no
+error occurred. */
+int meshTransform(meshMesh *mesh, meshCache *cache, renRenderer *ren,
+                  vecReal unif[]) {
+  if (mesh->usedNum < 0 && meshFindUsed(mesh) != 0)
+    return 1;
+  if (cache->mesh == mesh && cache->version == mesh->version &&
+      cache->varyDim == ren->varyDim && cache->unifDim == ren->unifDim &&
+      cache->transform == ren->transformVertex &&
+      cache->transforms == ren->transformVertices &&
+      memcmp(cache->unif, unif, ren->unifDim * sizeof(vecReal)) == 0)
+    return 0;
+  if (cache->vary == NULL || cache->vertNum != mesh->vertNum ||
+      cache->varyDim != ren->varyDim || cache->unifDim != ren->unifDim) {
+    vecReal *vary = (vecReal *)realloc(cache->vary,
+        (mesh->vertNum * ren->varyDim + ren->unifDim + 1) * sizeof(vecReal));
+    if (vary == NULL)
+      return 1;
+    cache->vary = vary;
+    cache->unif = &vary[mesh->vertNum * ren->varyDim];
+    cache->vertNum = mesh->vertNum;
+    cache->varyDim = ren->varyDim;
+    cache->unifDim = ren->unifDim;
+  }
+  /* Until the transformation is done, the store holds nothing valid. */
+  cache->mesh = NULL;
+  double start = ren->statsOn ? renNow() : 0.0;
+  if (ren->transformVertices != NULL && mesh->attrDim <= renVARYDIMBOUND) {
+    if (meshTransformBatched(mesh, cache, ren, unif) != 0)
+      return 1;
+  } else {
+    int i;
+    for (i = 0; i < mesh->usedNum; i += 1) {
+      int vert = mesh->used[i];
+      ren->transformVertex(ren, unif, &mesh->vert[vert * mesh->attrDim],
+                           &cache->vary[vert * ren->varyDim]);
+    }
+  }
+  if (ren->statsOn) {
+    ren->stats.vertexNum += mesh->usedNum;
+    ren->stats.vertexTime += renNow() - start;
+  }
+  vecCopy(ren->unifDim, unif, cache->unif);
+  cache->mesh = mesh;
+  cache->version = mesh->version;
+  cache->transform = ren->transformVertex;
+  cache->transforms = ren->transformVertices;
+  return 0;
+}
+
+vecReal *meshGetTransformedVertexPointer(meshCache *cache, renRenderer *ren,
+                                         int vert) {
+  if (0 <= vert && vert < cache->vertNum)
+    return &cache->vary[vert * ren->varyDim];
   else
     return NULL;
 }
 
-/* Renders the mesh. If the mesh and the renderer have differing values for
-attrDim, then prints an error message and does not render anything. */
-void meshRender(meshMesh *mesh, renRenderer *ren, double unif[],
-                texTexture *tex[]) {
+/* Renders the mesh, keeping its transformed vertices in the given store
+rather than in the mesh's own. Each scene node has a store of its own, so that
+nodes that share a mesh each keep their vertices from frame to frame. If the
+mesh and the renderer have differing values for attrDim, then prints an error
+message and does not render anything. */
+void meshRenderCached(meshMesh *mesh, meshCache *cache, renRenderer *ren,
+                      vecReal unif[], texTexture *tex[]) {
   if (mesh->attrDim != ren->attrDim) {
     fprintf(stderr, "error: meshRender: ");
     fprintf(stderr, "mesh attrDim = %d but renderer attrDim = %d.\n",
             mesh->attrDim, ren->attrDim);
+  } else if (meshTransform(mesh, cache, ren, unif) != 0) {
+    fprintf(stderr, "error: meshRender: out of memory.\n");
   } else {
     int i, *tri;
-    for (i = 0; i < mesh->vertNum; i += 1)
-      ren->transformVertex(ren, unif, meshGetVertexPointer(mesh, i),
-                           meshGetTransformedVertexPointer(mesh, ren, i));
+    double start = ren->statsOn ? renNow() : 0.0;
+    double rasterTime = ren->stats.rasterTime;
+    if (ren->binner != NULL)
+      tileBeginDraw(ren, unif, tex);
     for (i = 0; i < mesh->triNum; i += 1) {
       tri = meshGetTrianglePointer(mesh, i);
-      //printf("clipping transformed vertices\n");
       clipRender(ren, unif, tex,
-                 meshGetTransformedVertexPointer(mesh, ren, tri[0]),
-                 meshGetTransformedVertexPointer(mesh, ren, tri[1]),
-                 meshGetTransformedVertexPointer(mesh, ren, tri[2]));
+                 meshGetTransformedVertexPointer(cache, ren, tri[0]),
+                 meshGetTransformedVertexPointer(cache, ren, tri[1]),
+                 meshGetTransformedVertexPointer(cache, ren, tri[2]));
     }
+    /* In immediate mode, the triangles were also rasterized, and timed. */
+    if (ren->statsOn)
+      ren->stats.primitiveTime += renNow() - start -
+                                  (ren->stats.rasterTime - rasterTime);
   }
 }
 
+/* Renders the mesh. If the mesh and the renderer have differing values for
+attrDim, then prints an error message and does not render anything. The
+transformed vertices are cached in the mesh, so rendering it again with the
+same uniforms, as a static scene does every frame, transforms nothing. */
+void meshRender(meshMesh *mesh, renRenderer *ren, vecReal unif[],
+                texTexture *tex[]) {
+  meshRenderCached(mesh, &mesh->cache, ren, unif, tex);
+}
+
 /*** Convenience initializers: 2D ***/
 
 /* Initializes a mesh to two triangles forming a rectangle of the given sides.
 The four attributes are X, Y, S, T. Do not call meshInitialize separately; it
 is called inside this function. Don't forget to call meshDestroy when done. */
-int meshInitializeRectangle(meshMesh *mesh, double left, double right,
-                            double bottom, double top) {
+int meshInitializeRectangle(meshMesh *mesh, vecReal left, vecReal right,
+                            vecReal bottom, vecReal top) {
   int error = meshInitialize(mesh, 2, 4, 2 + 2);
   if (error == 0) {
     meshSetTriangle(mesh, 0, 0, 1, 2);
     meshSetTriangle(mesh, 1, 0, 2, 3);
-    double attr[4];
+    vecReal attr[4];
     vecSet(4, attr, left, bottom, 0.0, 0.0);
     meshSetVertex(mesh, 0, attr);
     vecSet(4, attr, right, bottom, 1.0, 0.0);
@@ -135,10 +421,10 @@ int meshInitializeRectangle(meshMesh *mesh, double left, double right,
 center (x, y) and radii rx, ry. The four attributes are X, Y, S, T. Do not call
 meshInitialize separately; it is called inside this function. Don't forget to
 call meshDestroy when done. */
-int meshInitializeEllipse(meshMesh *mesh, double x, double y, double rx,
-                          double ry, int sideNum) {
+int meshInitializeEllipse(meshMesh *mesh, vecReal x, vecReal y, vecReal rx,
+                          vecReal ry, int sideNum) {
   int i, error;
-  double theta, cosTheta, sinTheta, attr[4] = {x, y, 0.5, 0.5};
+  vecReal theta, cosTheta, sinTheta, attr[4] = {x, y, 0.5, 0.5};
   error = meshInitialize(mesh, sideNum, sideNum + 1, 2 + 2);
   if (error == 0) {
     meshSetVertex(mesh, 0, attr);
@@ -160,8 +446,8 @@ int meshInitializeEllipse(meshMesh *mesh, double x, double y, double rx,
 /* Assumes that attributes 0, 1, 2 are XYZ. Assumes that the vertices of the
 triangle are in counter-clockwise order when viewed from 'outside' the
 triangle. Computes the outward-pointing unit normal vector for the triangle. */
-void meshTrueNormal(double a[], double b[], double c[], double normal[3]) {
-  double bMinusA[3], cMinusA[3];
+void meshTrueNormal(vecReal a[], vecReal b[], vecReal c[], vecReal normal[3]) {
+  vecReal bMinusA[3], cMinusA[3];
   vecSubtract(3, b, a, bMinusA);
   vecSubtract(3, c, a, cMinusA);
   vec3Cross(bMinusA, cMinusA, normal);
@@ -173,7 +459,7 @@ flat-shaded normals. If a vertex belongs to more than triangle, then some
 unspecified triangle's normal wins. */
 void meshFlatNormals(meshMesh *mesh, int n) {
   int i, *tri;
-  double *a, *b, *c, normal[3];
+  vecReal *a, *b, *c, normal[3];
   for (i = 0; i < mesh->triNum; i += 1) {
     tri = meshGetTrianglePointer(mesh, i);
     a = meshGetVertexPointer(mesh, tri[0]);
@@ -191,7 +477,7 @@ smooth-shaded normals. Does not do anything special to handle multiple vertices
 with the same coordinates. */
 void meshSmoothNormals(meshMesh *mesh, int n) {
   int i, *tri;
-  double *a, *b, *c, normal[3] = {0.0, 0.0, 0.0};
+  vecReal *a, *b, *c, normal[3] = {0.0, 0.0, 0.0};
   /* Zero the normals. */
   for (i = 0; i < mesh->vertNum; i += 1) {
     a = meshGetVertexPointer(mesh, i);
@@ -220,8 +506,8 @@ are XYZ position, ST texture, and NOP unit normal vector. The normals are
 discontinuous at the edges (flat shading, not smooth). To facilitate this, some
 vertices have equal XYZ but different NOP, for 24 vertices in all. Don't forget
 to meshDestroy when finished. */
-int meshInitializeBox(meshMesh *mesh, double left, double right, double bottom,
-                      double top, double base, double lid) {
+int meshInitializeBox(meshMesh *mesh, vecReal left, vecReal right,
+                      vecReal bottom, vecReal top, vecReal base, vecReal lid) {
   int error = meshInitialize(mesh, 12, 24, 3 + 2 + 3);
   if (error == 0) {
     /* Make the triangles. */
@@ -238,7 +524,7 @@ int meshInitializeBox(meshMesh *mesh, double left, double right, double bottom,
     meshSetTriangle(mesh, 10, 20, 21, 22);
     meshSetTriangle(mesh, 11, 20, 22, 23);
     /* Make the vertices after 0, using vertex 0 as temporary storage. */
-    double *v = mesh->vert;
+    vecReal *v = mesh->vert;
     vecSet(8, v, right, bottom, base, 1.0, 0.0, 0.0, 0.0, -1.0);
     meshSetVertex(mesh, 1, v);
     vecSet(8, v, right, top, base, 1.0, 1.0, 0.0, 0.0, -1.0);
@@ -293,10 +579,10 @@ int meshInitializeBox(meshMesh *mesh, double left, double right, double bottom,
 
 /* Rotates a 2-dimensional vector through an angle. The input can safely alias
 the output. */
-void meshRotateVector(double theta, double v[2], double vRot[2]) {
-  double cosTheta = cos(theta);
-  double sinTheta = sin(theta);
-  double vRot0 = cosTheta * v[0] - sinTheta * v[1];
+void meshRotateVector(vecReal theta, vecReal v[2], vecReal vRot[2]) {
+  vecReal cosTheta = cos(theta);
+  vecReal sinTheta = sin(theta);
+  vecReal vRot0 = cosTheta * v[0] - sinTheta * v[1];
   vRot[1] = sinTheta * v[0] + cosTheta * v[1];
   vRot[0] = vRot0;
 }
@@ -309,8 +595,8 @@ should be in ascending or descending order. The sideNum parameter controls the
 fineness of the mesh. The attributes are XYZ position, ST texture, and NOP unit
 normal vector. The normals are smooth. Don't forget to meshDestroy when
 finished. */
-int meshInitializeRevolution(meshMesh *mesh, int zNum, double z[], double r[],
-                             double t[], int sideNum) {
+int meshInitializeRevolution(meshMesh *mesh, int zNum, vecReal z[],
+                             vecReal r[], vecReal t[], int sideNum) {
   int i, j, error;
   error = meshInitialize(mesh, (zNum - 2) * sideNum * 2,
                          (zNum - 2) * (sideNum + 1) + 2, 3 + 2 + 3);
@@ -333,8 +619,8 @@ int meshInitializeRevolution(meshMesh *mesh, int zNum, double z[], double r[],
             (j - 1) * (sideNum + 1) + 1 + i + 1, j * (sideNum + 1) + 1 + i + 1);
       }
     /* Make the vertices, using vertex 0 as temporary storage. */
-    double *v = mesh->vert;
-    double p[3], q[3], o[3];
+    vecReal *v = mesh->vert;
+    vecReal p[3], q[3], o[3];
     for (j = 1; j <= zNum - 2; j += 1) {
       // Form the sideNum + 1 vertices in the jth layer.
       vecSet(3, p, z[j + 1] - z[j], 0.0, r[j] - r[j + 1]);
@@ -367,16 +653,16 @@ int meshInitializeRevolution(meshMesh *mesh, int zNum, double z[], double r[],
 and layerNum parameters control the fineness of the mesh. The attributes are
 XYZ position, ST texture, and NOP unit normal vector. The normals are smooth.
 Don't forget to meshDestroy when finished. */
-int meshInitializeSphere(meshMesh *mesh, double r, int layerNum, int sideNum) {
+int meshInitializeSphere(meshMesh *mesh, vecReal r, int layerNum, int sideNum) {
   int error, i;
-  double *ts = (double *)malloc((layerNum + 1) * 3 * sizeof(double));
+  vecReal *ts = (vecReal *)malloc((layerNum + 1) * 3 * sizeof(vecReal));
   if (ts == NULL)
     return 1;
   else {
-    double *zs = &ts[layerNum + 1];
-    double *rs = &ts[2 * layerNum + 2];
+    vecReal *zs = &ts[layerNum + 1];
+    vecReal *rs = &ts[2 * layerNum + 2];
     for (i = 0; i <= layerNum; i += 1) {
-      ts[i] = (double)i / layerNum;
+      ts[i] = (vecReal)i / layerNum;
       zs[i] = -r * cos(ts[i] * M_PI);
       rs[i] = r * sin(ts[i] * M_PI);
     }
@@ -391,27 +677,27 @@ origin, of radius r and length l > 2 * r. The sideNum and layerNum parameters
 control the fineness of the mesh. The attributes are XYZ position, ST texture,
 and NOP unit normal vector. The normals are smooth. Don't forget to meshDestroy
 when finished. */
-int meshInitializeCapsule(meshMesh *mesh, double r, double l, int layerNum,
+int meshInitializeCapsule(meshMesh *mesh, vecReal r, vecReal l, int layerNum,
                           int sideNum) {
   int error, i;
-  double theta;
-  double *ts = (double *)malloc((2 * layerNum + 2) * 3 * sizeof(double));
+  vecReal theta;
+  vecReal *ts = (vecReal *)malloc((2 * layerNum + 2) * 3 * sizeof(vecReal));
   if (ts == NULL)
     return 1;
   else {
-    double *zs = &ts[2 * layerNum + 2];
-    double *rs = &ts[4 * layerNum + 4];
+    vecReal *zs = &ts[2 * layerNum + 2];
+    vecReal *rs = &ts[4 * layerNum + 4];
     zs[0] = -l / 2.0;
     rs[0] = 0.0;
     ts[0] = 0.0;
     for (i = 1; i <= layerNum; i += 1) {
-      theta = M_PI / 2.0 * (3 + i / (double)layerNum);
+      theta = M_PI / 2.0 * (3 + i / (vecReal)layerNum);
       zs[i] = -l / 2.0 + r + r * sin(theta);
       rs[i] = r * cos(theta);
       ts[i] = (zs[i] + l / 2.0) / l;
     }
     for (i = 0; i < layerNum; i += 1) {
-      theta = M_PI / 2.0 * i / (double)layerNum;
+      theta = M_PI / 2.0 * i / (vecReal)layerNum;
       zs[layerNum + 1 + i] = l / 2.0 - r + r * sin(theta);
       rs[layerNum + 1 + i] = r * cos(theta);
       ts[layerNum + 1 + i] = (zs[layerNum + 1 + i] + l / 2.0) / l;
@@ -426,6 +712,32 @@ int meshInitializeCapsule(meshMesh *mesh, double r, double l, int layerNum,
   }
 }
 
+/* The following functions return the geometric error of the meshes above,
+meaning how far, at most, the flat triangles stray from the smooth surface that
+they stand for, in the mesh's own units. A chain of levels of detail orders its
+meshes by this error (see sceneSetLODs). */
+
+/* Returns the error of meshInitializeRevolution around the Z-axis, where rMax
+is the largest r. The error along the curve itself depends on the curve, so
+that is up to the caller. */
+vecReal meshRevolutionError(vecReal rMax, int sideNum) {
+  return rMax * (1.0 - cos(M_PI / sideNum));
+}
+
+/* Returns the error of meshInitializeSphere. Each layer spans M_PI / layerNum
+of the profile, and each side 2 * M_PI / sideNum around the axis. */
+vecReal meshSphereError(vecReal r, int layerNum, int sideNum) {
+  return fmax(r * (1.0 - cos(M_PI / (2.0 * layerNum))),
+              meshRevolutionError(r, sideNum));
+}
+
+/* Returns the error of meshInitializeCapsule, whose caps span M_PI / 2.0 of
+the profile in layerNum layers each. The cylinder itself is exact along Z. */
+vecReal meshCapsuleError(vecReal r, int layerNum, int sideNum) {
+  return fmax(r * (1.0 - cos(M_PI / (4.0 * layerNum))),
+              meshRevolutionError(r, sideNum));
+}
+
 /* Builds a non-closed 'landscape' mesh based on a grid of Z-values. There are
 width * height Z-values, which arrive in the data parameter. The mesh is made
 of (width - 1) * (height - 1) squares, each made of two triangles. The spacing
@@ -433,16 +745,16 @@ parameter controls the spacing of the X- and Y-coordinates of the vertices. The
 attributes are XYZ position, ST texture, and NOP unit normal vector. Don't
 forget to call meshDestroy when finished with the mesh. To understand the exact
 layout of the data, try this example code:
-double zs[3][4] = {
+vecReal zs[3][4] = {
         {10.0, 9.0, 7.0, 6.0},
         {6.0, 5.0, 3.0, 1.0},
         {4.0, 3.0, -1.0, -2.0}};
-int error = meshInitializeLandscape(&mesh, 3, 4, 20.0, (double *)zs); */
+int error = meshInitializeLandscape(&mesh, 3, 4, 20.0, (vecReal *)zs); */
 int meshInitializeLandscape(meshMesh *mesh, int width, int height,
-                            double spacing, double *data) {
+                            vecReal spacing, vecReal *data) {
   int i, j, error;
   int a, b, c, d;
-  double *vert, diffSWNE, diffSENW;
+  vecReal *vert, diffSWNE, diffSENW;
   error = meshInitialize(mesh, 2 * (width - 1) * (height - 1), width * height,
                          3 + 2 + 3);
   if (error == 0) {
@@ -486,10 +798,10 @@ more than angle. If noMoreThan is false, then triangles are kept that deviate
 from horizontal by more than angle. Don't forget to call meshDestroy when
 finished. Warning: May contain extraneous vertices not used by any triangle. */
 int meshInitializeDissectedLandscape(meshMesh *mesh, meshMesh *land,
-                                     double angle, int noMoreThan) {
+                                     vecReal angle, int noMoreThan) {
   int error, i, j = 0, triNum = 0;
   int *tri, *newTri;
-  double normal[3];
+  vecReal normal[3];
   /* Count the triangles that are nearly horizontal. */
   for (i = 0; i < land->triNum; i += 1) {
     tri = meshGetTrianglePointer(land, i);
@@ -0,0 +1,568 @@
+/*
+@ Author:  Sabastian Mugazambi & Tore Banta
+@ Date: 01/07/2017
+This file has a mesh simplifier based on quadric error metrics (Garland and
+Heckbert). It collapses edges of a meshMesh, cheapest first, until the mesh
+has no more than a target number of triangles. Each collapse moves one vertex
+onto a neighbor, so no attributes are ever interpolated. Vertices with equal
+XYZ but different other attributes, such as the corners of meshInitializeBox,
+are welded into one point for the purposes of collapsing, and the seams between
+them are kept intact, as are the borders of open meshes such as
+meshInitializeLandscape. simpInitializeChain builds a chain of levels of
+detail for sceneSetLODs. Nothing here depends on a renderer, so the chains can
+be built at load time or ahead of time.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Seams and borders get planes at right angles to the surface, with this much
+weight relative to the surface's own planes, so that collapses do not pull
+them out of shape. */
+#define simpBORDERWEIGHT 10.0
+/* Each pass tries at most this fraction of the points. The rest wait for the
+next pass, whose costs take the collapses into account. */
+#define simpPASSFRACTION 0.25
+
+/* Where a point can go: anywhere, along its two seam or border edges, or
+nowhere. */
+#define simpFREE 0
+#define simpEDGE 1
+#define simpLOCKED 2
+
+/* Feel free to read the struct's members, but don't write them. Attributes 0,
+1, 2 of the source mesh must be XYZ. */
+typedef struct simpSimplifier simpSimplifier;
+struct simpSimplifier {
+  meshMesh *src;
+  int triNum;          /* triangles left */
+  int *tri;            /* src->triNum * 3 vertex indices; -1 for dead ones */
+  int pointNum;
+  int *point;          /* the point of each vertex, or -1 if unused */
+  vecReal *pos;        /* pointNum * 3 coordinates */
+  double *quadric;     /* pointNum * 11 coefficients; see simpAddPlane */
+  double error;        /* greatest cost of any collapse so far */
+  /* Rebuilt on each pass. The triangles around vertex v are
+  vertTris[vertStart[v]] to vertTris[vertStart[v + 1] - 1], and similarly for
+  points. */
+  int *vertStart, *vertTris, *pointStart, *pointTris;
+  int *kind, *edgeNbr, *locked;
+  int *wedge, *wedgeStamp, *pointStamp, stamp;
+};
+
+/* Adds the plane a x + b y + c z + d = 0, where (a, b, c) is a unit vector,
+with the given weight, to the quadric. The quadric's first ten coefficients are
+those of the symmetric matrix [[aa, ab, ac, ad], [., bb, bc, bd],
+[., ., cc, cd], [., ., ., dd]], in that order, and the last is the sum of the
+weights. */
+void simpAddPlane(double q[11], double a, double b, double c, double d,
+                  double weight) {
+  q[0] += weight * a * a;
+  q[1] += weight * a * b;
+  q[2] += weight * a * c;
+  q[3] += weight * a * d;
+  q[4] += weight * b * b;
+  q[5] += weight * b * c;
+  q[6] += weight * b * d;
+  q[7] += weight * c * c;
+  q[8] += weight * c * d;
+  q[9] += weight * d * d;
+  q[10] += weight;
+}
+
+/* Returns the sum of the quadrics q and r at p, divided by the sum of their
+weights. That is the weighted mean of the squared distances from p to their
+planes. */
+double simpEvaluate(const double q[11], const double r[11],
+                    const vecReal p[3]) {
+  double s[11];
+  int k;
+  for (k = 0; k < 11; k += 1)
+    s[k] = q[k] + r[k];
+  if (s[10] == 0.0)
+    return 0.0;
+  return (s[0] * p[0] * p[0] + s[4] * p[1] * p[1] + s[7] * p[2] * p[2] +
+         2.0 * (s[1] * p[0] * p[1] + s[2] * p[0] * p[2] + s[5] * p[1] * p[2] +
+                s[3] * p[0] + s[6] * p[1] + s[8] * p[2]) + s[9]) / s[10];
+}
+
+/* Computes the unit normal of the triangle with corners a, b, c, and returns
+twice its area. If that is 0.0, then the normal is not computed. */
+vecReal simpNormal(vecReal a[3], vecReal b[3], vecReal c[3],
+                   vecReal normal[3]) {
+  vecReal bMinusA[3], cMinusA[3];
+  vecSubtract(3, b, a, bMinusA);
+  vecSubtract(3, c, a, cMinusA);
+  vec3Cross(bMinusA, cMinusA, normal);
+  return vecUnit(3, normal, normal);
+}
+
+/* One used vertex, as simpInitialize sorts them to weld them into points. */
+typedef struct simpVertex simpVertex;
+struct simpVertex {
+  vecReal xyz[3];
+  int vert;
+};
+
+int simpCompareVertices(const void *a, const void *b) {
+  const simpVertex *x = (const simpVertex *)a, *y = (const simpVertex *)b;
+  int k;
+  for (k = 0; k < 3; k += 1)
+    if (x->xyz[k] != y->xyz[k])
+      return (x->xyz[k] < y->xyz[k]) ? -1 : 1;
+  return x->vert - y->vert;
+}
+
+/* Builds the lists of triangles around each vertex and each point, by
+counting sort, from the triangles that are alive. */
+void simpBuildAdjacency(simpSimplifier *simp) {
+  int vertNum = simp->src->vertNum, triNum = simp->src->triNum, t, k;
+  memset(simp->vertStart, 0, (vertNum + 1) * sizeof(int));
+  memset(simp->pointStart, 0, (simp->pointNum + 1) * sizeof(int));
+  for (t = 0; t < triNum; t += 1)
+    if (simp->tri[3 * t] >= 0)
+      for (k = 0; k < 3; k += 1) {
+        simp->vertStart[simp->tri[3 * t + k] + 1] += 1;
+        simp->pointStart[simp->point[simp->tri[3 * t + k]] + 1] += 1;
+      }
+  for (k = 0; k < vertNum; k += 1)
+    simp->vertStart[k + 1] += simp->vertStart[k];
+  for (k = 0; k < simp->pointNum; k += 1)
+    simp->pointStart[k + 1] += simp->pointStart[k];
+  /* Fill the lists, using the starts as cursors, and then shift them back. */
+  for (t = 0; t < triNum; t += 1)
+    if (simp->tri[3 * t] >= 0)
+      for (k = 0; k < 3; k += 1) {
+        int v = simp->tri[3 * t + k];
+        simp->vertTris[simp->vertStart[v]++] = t;
+        simp->pointTris[simp->pointStart[simp->point[v]]++] = t;
+      }
+  for (k = vertNum; k > 0; k -= 1)
+    simp->vertStart[k] = simp->vertStart[k - 1];
+  simp->vertStart[0] = 0;
+  for (k = simp->pointNum; k > 0; k -= 1)
+    simp->pointStart[k] = simp->pointStart[k - 1];
+  simp->pointStart[0] = 0;
+}
+
+/* Returns 1 if some live triangle has the edge from vertex a to vertex b, in
+that order, and 0 if not. */
+int simpHasEdge(const simpSimplifier *simp, int a, int b) {
+  int i, k;
+  for (i = simp->vertStart[a]; i < simp->vertStart[a + 1]; i += 1) {
+    const int *tri = &simp->tri[3 * simp->vertTris[i]];
+    for (k = 0; k < 3; k += 1)
+      if (tri[k] == a && tri[(k + 1) % 3] == b)
+        return 1;
+  }
+  return 0;
+}
+
+/* Records that the edge from point p to point q is a seam or a border. */
+void simpAddEdgeNeighbor(simpSimplifier *simp, int p, int q) {
+  int *nbr = &simp->edgeNbr[2 * p];
+  if (nbr[0] == q || nbr[1] == q)
+    return;
+  if (nbr[0] < 0)
+    nbr[0] = q;
+  else if (nbr[1] < 0)
+    nbr[1] = q;
+  else
+    simp->kind[p] = simpLOCKED;
+}
+
+/* Sorts the points into simpFREE, simpEDGE and simpLOCKED. An edge of a
+triangle, from vertex a to vertex b, is a seam or a border if no triangle goes
+from b back to a: a seam if some triangle goes back between other vertices at
+the same points, and a border if none does. A point on exactly two such edges
+may slide along them; a point on any other number of them, such as the corner
+of a box, stays put. */
+void simpClassify(simpSimplifier *simp) {
+  int t, k, p;
+  for (p = 0; p < simp->pointNum; p += 1) {
+    simp->kind[p] = simpFREE;
+    simp->edgeNbr[2 * p] = -1;
+    simp->edgeNbr[2 * p + 1] = -1;
+  }
+  for (t = 0; t < simp->src->triNum; t += 1)
+    if (simp->tri[3 * t] >= 0)
+      for (k = 0; k < 3; k += 1) {
+        int a = simp->tri[3 * t + k], b = simp->tri[3 * t + (k + 1) % 3];
+        if (!simpHasEdge(simp, b, a)) {
+          simpAddEdgeNeighbor(simp, simp->point[a], simp->point[b]);
+          simpAddEdgeNeighbor(simp, simp->point[b], simp->point[a]);
+        }
+      }
+  for (p = 0; p < simp->pointNum; p += 1)
+    if (simp->kind[p] == simpFREE && simp->edgeNbr[2 * p] >= 0)
+      simp->kind[p] = (simp->edgeNbr[2 * p + 1] >= 0) ? simpEDGE : simpLOCKED;
+}
+
+/* Works out which vertex of point v each vertex of point u would become, if u
+were collapsed onto v: the one that it shares a triangle with. Returns 1 if
+every vertex of u has one, and 0 if not, in which case the collapse would
+tear a seam. The answers are in wedge, where wedgeStamp is stamp. */
+int simpMapWedges(simpSimplifier *simp, int u, int v) {
+  int i, k;
+  simp->stamp += 1;
+  for (i = simp->pointStart[u]; i < simp->pointStart[u + 1]; i += 1) {
+    const int *tri = &simp->tri[3 * simp->pointTris[i]];
+    int a = -1, b = -1;
+    for (k = 0; k < 3; k += 1) {
+      if (simp->point[tri[k]] == u)
+        a = tri[k];
+      else if (simp->point[tri[k]] == v)
+        b = tri[k];
+    }
+    if (b >= 0 && simp->wedgeStamp[a] != simp->stamp) {
+      simp->wedge[a] = b;
+      simp->wedgeStamp[a] = simp->stamp;
+    }
+  }
+  for (i = simp->pointStart[u]; i < simp->pointStart[u + 1]; i += 1) {
+    const int *tri = &simp->tri[3 * simp->pointTris[i]];
+    for (k = 0; k < 3; k += 1)
+      if (simp->point[tri[k]] == u && simp->wedgeStamp[tri[k]] != simp->stamp)
+        return 0;
+  }
+  return 1;
+}
+
+/* Returns 1 if moving point u onto point v would flip or flatten any of the
+triangles around u that survive the collapse, and 0 if not. */
+int simpFlips(const simpSimplifier *simp, int u, int v) {
+  int i, k;
+  for (i = simp->pointStart[u]; i < simp->pointStart[u + 1]; i += 1) {
+    const int *tri = &simp->tri[3 * simp->pointTris[i]];
+    vecReal *before[3], *after[3];
+    int dies = 0;
+    for (k = 0; k < 3; k += 1) {
+      int p = simp->point[tri[k]];
+      dies = dies || (p == v);
+      before[k] = &simp->pos[3 * p];
+      after[k] = (p == u) ? &simp->pos[3 * v] : before[k];
+    }
+    if (dies)
+      continue;
+    vecReal oldNormal[3], newNormal[3];
+    simpNormal(before[0], before[1], before[2], oldNormal);
+    if (simpNormal(after[0], after[1], after[2], newNormal) == 0.0 ||
+        vecDot(3, oldNormal, newNormal) <= 0.0)
+      return 1;
+  }
+  return 0;
+}
+
+/* Returns 1 if collapsing point u onto point v keeps the surface a surface,
+and 0 if it would glue it to itself. That is so if the only points next to
+both u and v are the third corners of the triangles that have both. */
+int simpLinked(simpSimplifier *simp, int u, int v) {
+  int i, k, shared = 0, common = 0;
+  simp->stamp += 2;
+  for (i = simp->pointStart[v]; i < simp->pointStart[v + 1]; i += 1)
+    for (k = 0; k < 3; k += 1)
+      simp->pointStamp[simp->point[simp->tri[3 * simp->pointTris[i] + k]]] =
+          simp->stamp;
+  for (i = simp->pointStart[u]; i < simp->pointStart[u + 1]; i += 1) {
+    const int *tri = &simp->tri[3 * simp->pointTris[i]];
+    for (k = 0; k < 3; k += 1) {
+      int p = simp->point[tri[k]];
+      if (p == v)
+        shared += 1;
+      else if (p != u && simp->pointStamp[p] == simp->stamp) {
+        simp->pointStamp[p] = simp->stamp + 1;
+        common += 1;
+      }
+    }
+  }
+  simp->stamp += 1;
+  return (common == shared);
+}
+
+/* Collapses point u onto point v. The triangles that had both die, and the
+others around u take on v's vertices. Everything that the collapse touched is
+locked for the rest of the pass, so that the lists of triangles stay good. */
+void simpCollapse(simpSimplifier *simp, int u, int v, double cost) {
+  int i, k;
+  simpMapWedges(simp, u, v);
+  for (i = simp->pointStart[u]; i < simp->pointStart[u + 1]; i += 1) {
+    int *tri = &simp->tri[3 * simp->pointTris[i]];
+    int dies = 0;
+    for (k = 0; k < 3; k += 1) {
+      simp->locked[simp->point[tri[k]]] = 1;
+      dies = dies || (simp->point[tri[k]] == v);
+    }
+    if (dies) {
+      tri[0] = tri[1] = tri[2] = -1;
+      simp->triNum -= 1;
+    } else
+      for (k = 0; k < 3; k += 1)
+        if (simp->point[tri[k]] == u)
+          tri[k] = simp->wedge[tri[k]];
+  }
+  for (k = 0; k < 11; k += 1)
+    simp->quadric[11 * v + k] += simp->quadric[11 * u + k];
+  simp->error = fmax(simp->error, cost);
+}
+
+/* Deallocates the resources backing the simplifier. */
+void simpDestroy(simpSimplifier *simp) {
+  free(simp->tri);
+  free(simp->quadric);
+}
+
+/* Initializes the simplifier with the triangles of src, which it does not
+alter, but which must outlive it. Attributes 0, 1, 2 must be XYZ. When you are
+finished, you must call simpDestroy. Returns 0 if no error occurred. */
+int simpInitialize(simpSimplifier *simp, meshMesh *src) {
+  int vertNum = src->vertNum, triNum = src->triNum, t, k, v;
+  if (src->attrDim < 3)
+    return 1;
+  simp->src = src;
+  simp->triNum = triNum;
+  simp->error = 0.0;
+  simp->stamp = 0;
+  /* The integer arrays come in one block, the quadrics and positions in
+  another, and the points are at most as many as the vertices. */
+  simp->tri = (int *)malloc((9 * triNum + 10 * vertNum + 2) * sizeof(int));
+  simp->quadric = (double *)malloc((vertNum + 1) *
+                                   (11 * sizeof(double) + 3 * sizeof(vecReal)));
+  if (simp->tri == NULL || simp->quadric == NULL) {
+    free(simp->tri);
+    free(simp->quadric);
+    return 1;
+  }
+  simp->point = &simp->tri[3 * triNum];
+  simp->wedge = &simp->point[vertNum];
+  simp->wedgeStamp = &simp->wedge[vertNum];
+  simp->pointStamp = &simp->wedgeStamp[vertNum];
+  simp->vertStart = &simp->pointStamp[vertNum];
+  simp->pointStart = &simp->vertStart[vertNum + 1];
+  simp->vertTris = &simp->pointStart[vertNum + 1];
+  simp->pointTris = &simp->vertTris[3 * triNum];
+  simp->kind = &simp->pointTris[3 * triNum];
+  simp->locked = &simp->kind[vertNum];
+  simp->edgeNbr = &simp->locked[vertNum];
+  simp->pos = (vecReal *)&simp->quadric[11 * (vertNum + 1)];
+  memcpy(simp->tri, src->tri, 3 * triNum * sizeof(int));
+  for (v = 0; v < vertNum; v += 1) {
+    simp->wedgeStamp[v] = 0;
+    simp->pointStamp[v] = 0;
+  }
+  /* Weld the used vertices with equal XYZ into points. Sorting the vertices
+  by XYZ puts the ones to weld next to each other. */
+  simpVertex *sorted = (simpVertex *)malloc((vertNum + 1) *
+                                            sizeof(simpVertex));
+  if (sorted == NULL) {
+    simpDestroy(simp);
+    return 1;
+  }
+  int usedNum = 0;
+  for (v = 0; v < vertNum; v += 1)
+    simp->point[v] = -1;
+  for (t = 0; t < 3 * triNum; t += 1)
+    simp->point[src->tri[t]] = 0;
+  for (v = 0; v < vertNum; v += 1)
+    if (simp->point[v] == 0) {
+      vecCopy(3, meshGetVertexPointer(src, v), sorted[usedNum].xyz);
+      sorted[usedNum].vert = v;
+      usedNum += 1;
+    }
+  qsort(sorted, usedNum, sizeof(simpVertex), simpCompareVertices);
+  simp->pointNum = 0;
+  for (k = 0; k < usedNum; k += 1) {
+    if (k == 0 || sorted[k - 1].xyz[0] != sorted[k].xyz[0] ||
+        sorted[k - 1].xyz[1] != sorted[k].xyz[1] ||
+        sorted[k - 1].xyz[2] != sorted[k].xyz[2]) {
+      vecCopy(3, sorted[k].xyz, &simp->pos[3 * simp->pointNum]);
+      simp->pointNum += 1;
+    }
+    simp->point[sorted[k].vert] = simp->pointNum - 1;
+  }
+  free(sorted);
+  /* Each point's quadric starts with the planes of its triangles, and of its
+  seams and borders. */
+  memset(simp->quadric, 0, 11 * simp->pointNum * sizeof(double));
+  simpBuildAdjacency(simp);
+  for (t = 0; t < triNum; t += 1) {
+    int *tri = &simp->tri[3 * t];
+    vecReal normal[3];
+    if (simpNormal(&simp->pos[3 * simp->point[tri[0]]],
+                   &simp->pos[3 * simp->point[tri[1]]],
+                   &simp->pos[3 * simp->point[tri[2]]], normal) == 0.0)
+      continue;
+    double d = -vecDot(3, normal, &simp->pos[3 * simp->point[tri[0]]]);
+    for (k = 0; k < 3; k += 1)
+      simpAddPlane(&simp->quadric[11 * simp->point[tri[k]]], normal[0],
+                   normal[1], normal[2], d, 1.0);
+    for (k = 0; k < 3; k += 1) {
+      int a = tri[k], b = tri[(k + 1) % 3];
+      if (simpHasEdge(simp, b, a))
+        continue;
+      vecReal *p = &simp->pos[3 * simp->point[a]];
+      vecReal *q = &simp->pos[3 * simp->point[b]];
+      vecReal edge[3], side[3];
+      vecSubtract(3, q, p, edge);
+      vec3Cross(edge, normal, side);
+      vecReal length = vecLength(3, side);
+      if (length == 0.0)
+        continue;
+      vecScale(3, 1.0 / length, side, side);
+      d = -vecDot(3, side, p);
+      simpAddPlane(&simp->quadric[11 * simp->point[a]], side[0], side[1],
+                   side[2], d, simpBORDERWEIGHT);
+      simpAddPlane(&simp->quadric[11 * simp->point[b]], side[0], side[1],
+                   side[2], d, simpBORDERWEIGHT);
+    }
+  }
+  return 0;
+}
+
+/* One possible collapse, as simpReduce sorts them. */
+typedef struct simpCandidate simpCandidate;
+struct simpCandidate {
+  double cost;
+  int u, v;
+};
+
+int simpCompareCandidates(const void *a, const void *b) {
+  const simpCandidate *x = (const simpCandidate *)a;
+  const simpCandidate *y = (const simpCandidate *)b;
+  if (x->cost != y->cost)
+    return (x->cost < y->cost) ? -1 : 1;
+  return x->u - y->u;
+}
+
+/* Finds the cheapest point that point u can collapse onto, without tearing a
+seam or leaving its border. Returns 1 and fills in the candidate if there is
+one, and returns 0 if not. */
+int simpBestCandidate(simpSimplifier *simp, int u, simpCandidate *best) {
+  int i, k, found = 0;
+  if (simp->kind[u] == simpLOCKED)
+    return 0;
+  for (i = simp->pointStart[u]; i < simp->pointStart[u + 1]; i += 1) {
+    const int *tri = &simp->tri[3 * simp->pointTris[i]];
+    for (k = 0; k < 3; k += 1) {
+      int v = simp->point[tri[k]];
+      int *nbr = &simp->edgeNbr[2 * u];
+      if (v == u || (simp->kind[u] == simpEDGE && v != nbr[0] && v != nbr[1]))
+        continue;
+      double cost = simpEvaluate(&simp->quadric[11 * u],
+                                 &simp->quadric[11 * v], &simp->pos[3 * v]);
+      if ((!found || cost < best->cost) && simpMapWedges(simp, u, v)) {
+        best->cost = fmax(cost, 0.0);
+        best->u = u;
+        best->v = v;
+        found = 1;
+      }
+    }
+  }
+  return found;
+}
+
+/* Collapses edges, cheapest first, until at most triNum triangles are left, or
+until no more collapses are allowed. Returns the number of triangles left.
+Calling it again with a smaller triNum carries on from there. */
+int simpReduce(simpSimplifier *simp, int triNum) {
+  simpCandidate *cands = (simpCandidate *)malloc(
+      (simp->pointNum + 1) * sizeof(simpCandidate));
+  if (cands == NULL)
+    return simp->triNum;
+  while (simp->triNum > triNum) {
+    int candNum = 0, collapseNum = 0, i, p;
+    simpBuildAdjacency(simp);
+    simpClassify(simp);
+    for (p = 0; p < simp->pointNum; p += 1) {
+      simp->locked[p] = 0;
+      if (simpBestCandidate(simp, p, &cands[candNum]))
+        candNum += 1;
+    }
+    qsort(cands, candNum, sizeof(simpCandidate), simpCompareCandidates);
+    /* Each collapse removes about two triangles. Going further down the list
+    than that many would take dear collapses while cheap ones are locked, so
+    that only happens when none of those could be made. */
+    int candMax = (int)(simpPASSFRACTION * simp->pointNum) + 1;
+    if (candMax > (simp->triNum - triNum) / 2 + 1)
+      candMax = (simp->triNum - triNum) / 2 + 1;
+    for (i = 0; i < candNum && (i < candMax || collapseNum == 0) &&
+         simp->triNum > triNum; i += 1) {
+      int u = cands[i].u, v = cands[i].v;
+      if (simp->locked[u] || simp->locked[v] || simpFlips(simp, u, v) ||
+          !simpLinked(simp, u, v))
+        continue;
+      simpCollapse(simp, u, v, cands[i].cost);
+      collapseNum += 1;
+    }
+    if (collapseNum == 0)
+      break;
+  }
+  free(cands);
+  return simp->triNum;
+}
+
+/* Returns the error of the simplified mesh: the square root of the greatest
+cost of any collapse, which is roughly how far, in the mesh's units, the
+simplified surface strays from the original, on average over the region that
+the collapse swallowed. It only grows as simpReduce
+carries on, as sceneSetLODs requires. */
+double simpGetError(const simpSimplifier *simp) {
+  return sqrt(simp->error);
+}
+
+/* Initializes mesh to the simplified mesh, with only the vertices that its
+triangles use, in their original order. Don't forget to meshDestroy when
+finished. Returns 0 if no error occurred. */
+int simpInitializeMesh(simpSimplifier *simp, meshMesh *mesh) {
+  int vertNum = simp->src->vertNum, usedNum = 0, t, v, k;
+  int *index = simp->wedge;
+  for (v = 0; v < vertNum; v += 1)
+    index[v] = -1;
+  for (t = 0; t < 3 * simp->src->triNum; t += 1)
+    if (simp->tri[t] >= 0)
+      index[simp->tri[t]] = 0;
+  for (v = 0; v < vertNum; v += 1)
+    if (index[v] == 0)
+      index[v] = usedNum++;
+  if (meshInitialize(mesh, simp->triNum, usedNum, simp->src->attrDim) != 0)
+    return 1;
+  for (v = 0; v < vertNum; v += 1)
+    if (index[v] >= 0)
+      meshSetVertex(mesh, index[v], meshGetVertexPointer(simp->src, v));
+  for (t = 0, k = 0; t < simp->src->triNum; t += 1)
+    if (simp->tri[3 * t] >= 0) {
+      meshSetTriangle(mesh, k, index[simp->tri[3 * t]],
+                      index[simp->tri[3 * t + 1]], index[simp->tri[3 * t + 2]]);
+      k += 1;
+    }
+  return 0;
+}
+
+/* Builds a chain of lodNum levels of detail from src, which it does not alter.
+Level l has at most triNums[l] triangles, which must shrink with l, and error
+errors[l] (see simpGetError). Where the simplifier cannot get down to a target,
+the level has more triangles than asked for. The meshes and errors can go
+straight to sceneSetLODs, after src itself with error 0.0 if it is to be the
+finest level. Don't forget to meshDestroy the meshes when finished. Returns 0
+if no error occurred. */
+int simpInitializeChain(meshMesh meshes[], vecReal errors[], meshMesh *src,
+                        int lodNum, const int triNums[]) {
+  simpSimplifier simp;
+  int l;
+  if (simpInitialize(&simp, src) != 0)
+    return 1;
+  for (l = 0; l < lodNum; l += 1) {
+    simpReduce(&simp, triNums[l]);
+    if (simpInitializeMesh(&simp, &meshes[l]) != 0) {
+      while (l > 0) {
+        l -= 1;
+        meshDestroy(&meshes[l]);
+      }
+      simpDestroy(&simp);
+      return 1;
+    }
+    errors[l] = simpGetError(&simp);
+  }
+  simpDestroy(&simp);
+  return 0;
+}
@@ -5,17 +5,23 @@ This files includes the main function that test the 020triangle.c rasterizing
 script.
 Run the script like so:
 clang 161mainDiffuse.c 000pixel.o -lglfw -framework OpenGL
+Or, to render without a window (see 210headless.c):
+clang -O2 -DfbHEADLESS 160mainDiffuse.c -lm -lpthread
 */
 
 #include <stdio.h>
 #include <math.h>
 #include <stdarg.h>
+#ifndef fbHEADLESS
 #include "000pixel.h"
+#endif
 
 #include "100vector.c"
 #include "131matrix.c"
 #include "040texture.c"
 #include "110depth.c"
+#include "120framebuffer.c"
+#include "125heatmap.c"
 
 #define GLFW_KEY_ENTER 257
 #define GLFW_KEY_RIGHT 262
@@ -28,7 +34,6 @@ clang 161mainDiffuse.c 000pixel.o -lglfw -framework OpenGL
 #define GLFW_KEY_S 83
 
 #define renVARYDIMBOUND 16
-#define renVERTNUMBOUND 1000
 
 #include "130renderer.c"
 
@@ -71,7 +76,7 @@ clang 161mainDiffuse.c 000pixel.o -lglfw -framework OpenGL
 #define renUNIFCAMWORLDY 45
 #define renUNIFCAMWORLDZ 46
 
-double x_val = 0.0;
+vecReal x_val = 0.0;
 #define renATTRX 0
 #define renATTRY 1
 #define renATTRZ 2
@@ -83,11 +88,11 @@ double x_val = 0.0;
 
 // double cam[2] = {M_PI/2,-1*M_PI/2};
 // double cam[2] = {M_PI/2,0.0};
-double cam[3] = {0.5, 0.0, 150.0};
+vecReal cam[3] = {0.5, 0.0, 150.0};
 
-double target[3] = {0.0, 0.0, 0.0};
+vecReal target[3] = {0.0, 0.0, 0.0};
 ///////////////////////1.0,1.6
-double unif[47] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+vecReal unif[47] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
 
                     1.0, 0.0, 0.0, 0.0,
                     0.0, 1.0, 0.0, 0.0,
@@ -102,7 +107,7 @@ double unif[47] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
                                   0.0, 0.0, 200.0, 1.0, 1.0, 1.0,
                                   0.0, 0.0, 0.0};
 
-double unif2[47] = {0.0, 0.0, 0.0, 10.0, 10.0, -10.0,
+vecReal unif2[47] = {0.0, 0.0, 0.0, 10.0, 10.0, -10.0,
 
                       1.0, 0.0, 0.0, 0.0,
                       0.0, 1.0, 0.0, 0.0,
@@ -117,7 +122,7 @@ double unif2[47] = {0.0, 0.0, 0.0, 10.0, 10.0, -10.0,
                                   0.0, 0.0, 200.0, 1.0, 1.0, 1.0,
                                   0.0, 0.0, 0.0};
 
-double unif3[47] = {0.0, 0.0, 0.0, 10.0, -10.0, 10.0,
+vecReal unif3[47] = {0.0, 0.0, 0.0, 10.0, -10.0, 10.0,
 
                       1.0, 0.0, 0.0, 0.0,
                       0.0, 1.0, 0.0, 0.0,
@@ -133,21 +138,21 @@ double unif3[47] = {0.0, 0.0, 0.0, 10.0, -10.0, 10.0,
                                   0.0, 0.0, 0.0};
 
 /* Writes the vary vector, based on the other parameters. */
-void transformVertex(renRenderer *ren, double unif[], double attr[],
-                     double vary[]) {
+void transformVertex(renRenderer *ren, vecReal unif[], vecReal attr[],
+                     vecReal vary[]) {
   /* For now, just copy attr to varying. Baby steps. */
-  double attrXYZvec[4] = {attr[renATTRX], attr[renATTRY], attr[renATTRZ], 1.0};
+  vecReal attrXYZvec[4] = {attr[renATTRX], attr[renATTRY], attr[renATTRZ], 1.0};
 
-  double attrNOPvec[4] = {attr[5], attr[6], attr[7], 0.0};
-  double RtimesXYZvec[4];
-  double RtimesNOPvec[4];
-  double MtimesRvec[4];
+  vecReal attrNOPvec[4] = {attr[5], attr[6], attr[7], 0.0};
+  vecReal RtimesXYZvec[4];
+  vecReal RtimesNOPvec[4];
+  vecReal MtimesRvec[4];
 
-  mat441Multiply((double(*)[4])(&unif[renUNIFISOMETRY]), attrXYZvec,
+  mat441Multiply((vecReal(*)[4])(&unif[renUNIFISOMETRY]), attrXYZvec,
                  RtimesXYZvec);
-  mat441Multiply((double(*)[4])(&unif[renUNIFISOMETRY]), attrNOPvec,
+  mat441Multiply((vecReal(*)[4])(&unif[renUNIFISOMETRY]), attrNOPvec,
                  RtimesNOPvec);
-  mat441Multiply((double(*)[4])(&unif[renUNIFVIEWING]), RtimesXYZvec,
+  mat441Multiply((vecReal(*)[4])(&unif[renUNIFVIEWING]), RtimesXYZvec,
                  MtimesRvec);
 
   vary[renVARYX] = MtimesRvec[0];
@@ -166,19 +171,22 @@ void transformVertex(renRenderer *ren, double unif[], double attr[],
   vary[renVARYWORLDP] = RtimesNOPvec[2];
 }
 
+/* Copies the camera's position and the viewing transformation into the
+uniforms. The scene calls this only when the camera has changed. */
+void updateViewing(renRenderer *ren, vecReal unif[]) {
+  vec3Copy(ren->cameraTranslation,&unif[renUNIFCAMWORLDX]);
+
+  mat44Copy(ren->viewing, (vecReal(*)[4])(&unif[renUNIFVIEWING]));
+}
+
 /* If unifParent is NULL, then sets the uniform matrix to the
 rotation-translation M described by the other uniforms. If unifParent is not
 NULL, but instead contains a rotation-translation P, then sets the uniform
-matrix to the matrix product P * M. */
-void updateUniform(renRenderer *ren, double unif[], double unifParent[]) {
-  double u[3];
-  double rot[3][3];
-
-
-
-  vecCopy(3,ren->cameraTranslation,&unif[renUNIFCAMWORLDX]);
-
-  mat44Copy(ren->viewing, (double(*)[4])(&unif[renUNIFVIEWING]));
+matrix to the matrix product P * M. The scene calls this only when the node or
+one of its ancestors has moved. */
+void updateUniform(renRenderer *ren, vecReal unif[], vecReal unifParent[]) {
+  vecReal u[3];
+  vecReal rot[3][3];
 
   vec3Spherical(1.0, unif[renUNIFPHI], unif[renUNIFTHETA], u);
   mat33AngleAxisRotation(unif[renUNIFRHO], u, rot);
@@ -187,63 +195,63 @@ void updateUniform(renRenderer *ren, double unif[], double unifParent[]) {
 
     /* The nine uniforms for storing the matrix start at index
     renUNIFISOMETRY. So &unif[renUNIFISOMETRY] is an array containing those
-    nine numbers. We use '(double(*)[3])' to cast it to a 3x3 matrix. */
-    double trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
-                       unif[renUNIFTRANSZ]};
-    mat44Isometry(rot, trans, (double(*)[4])(&unif[renUNIFISOMETRY]));
+    nine numbers. We use '(vecReal(*)[3])' to cast it to a 3x3 matrix. */
+    vecReal trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
+                        unif[renUNIFTRANSZ]};
+    mat44Isometry(rot, trans, (vecReal(*)[4])(&unif[renUNIFISOMETRY]));
 
   } else {
 
-    double m[4][4];
-    double trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
-                       unif[renUNIFTRANSZ]};
+    vecReal m[4][4];
+    vecReal trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
+                        unif[renUNIFTRANSZ]};
     mat44Isometry(rot, trans, m);
-    mat444Multiply((double(*)[4])(&unifParent[renUNIFISOMETRY]), m,
-                   (double(*)[4])(&unif[renUNIFISOMETRY]));
+    mat444Multiply((vecReal(*)[4])(&unifParent[renUNIFISOMETRY]), m,
+                   (vecReal(*)[4])(&unif[renUNIFISOMETRY]));
   }
 }
 
 /* Sets rgb, based on the other parameters, which are unaltered. attr is an
 interpolated attribute vector. */
-void colorPixel(renRenderer *ren, double unif[], texTexture *tex[],
-                double vary[], double rgbz[]) {
+void colorPixel(renRenderer *ren, vecReal unif[], texTexture *tex[],
+                vecReal vary[], vecReal rgbz[]) {
   texSample(tex[0], vary[renVARYS], vary[renVARYT]);
-  double DIFF_INT;
-  double SPEC_INT;
+  vecReal DIFF_INT;
+  vecReal SPEC_INT;
 
-  double light_vec[3] = {unif[renUNIFLIGHTX], unif[renUNIFLIGHTY],
-                         unif[renUNIFLIGHTZ]};
-  vecUnit(3, light_vec, light_vec);
+  vecReal light_vec[3] = {unif[renUNIFLIGHTX], unif[renUNIFLIGHTY],
+                          unif[renUNIFLIGHTZ]};
+  vec3Unit(light_vec, light_vec);
 
-  double world_vec[3] = {vary[renVARYWORLDX], vary[renVARYWORLDY],
-                         vary[renVARYWORLDZ]};
-  vecUnit(3, world_vec, world_vec);
+  vecReal world_vec[3] = {vary[renVARYWORLDX], vary[renVARYWORLDY],
+                          vary[renVARYWORLDZ]};
+  vec3Unit(world_vec, world_vec);
 
 
-  double cam_vec[3] = {unif[renUNIFCAMWORLDX], unif[renUNIFCAMWORLDY],
-                       unif[renUNIFCAMWORLDZ]};
-  vecUnit(3, cam_vec, cam_vec);
+  vecReal cam_vec[3] = {unif[renUNIFCAMWORLDX], unif[renUNIFCAMWORLDY],
+                        unif[renUNIFCAMWORLDZ]};
+  vec3Unit(cam_vec, cam_vec);
 
-  double normal[3] = {vary[renVARYWORLDN], vary[renVARYWORLDO],
-                      vary[renVARYWORLDP]};
-  vecUnit(3, normal, normal);
+  vecReal normal[3] = {vary[renVARYWORLDN], vary[renVARYWORLDO],
+                       vary[renVARYWORLDP]};
+  vec3Unit(normal, normal);
 
-  double sub_vec[3];
-  double light[3];
-  double ndotl;
+  vecReal sub_vec[3];
+  vecReal light[3];
+  vecReal ndotl;
 
-  vecSubtract(3, light_vec, world_vec, sub_vec);
-  vecUnit(3, sub_vec, light);
-  ndotl = vecDot(3, normal, light);
+  vec3Subtract(light_vec, world_vec, sub_vec);
+  vec3Unit(sub_vec, light);
+  ndotl = vec3Dot(normal, light);
   DIFF_INT = fmax(0.0, ndotl);
 
-  // double reflect[3];
-  // double rdotc;
+  // vecReal reflect[3];
+  // vecReal rdotc;
   //
-  // vecScale(3, 2 * ndotl, normal, sub_vec);
-  // vecSubtract(3, sub_vec, light, reflect);
-  // vecUnit(3, reflect, reflect);
-  // rdotc = vecDot(3, reflect, cam_vec);
+  // vec3Scale(2 * ndotl, normal, sub_vec);
+  // vec3Subtract(sub_vec, light, reflect);
+  // vec3Unit(reflect, reflect);
+  // rdotc = vec3Dot(reflect, cam_vec);
   // SPEC_INT = fmax(0.0, rdotc);
   // SPEC_INT = pow(SPEC_INT, 30);
 
@@ -256,9 +264,13 @@ void colorPixel(renRenderer *ren, double unif[], texTexture *tex[],
 }
 
 #include "110triangle.c"
+#include "190tiling.c"
 #include "140clipping.c"
 #include "140mesh.c"
 #include "090scene.c"
+#ifdef fbHEADLESS
+#include "210headless.c"
+#endif
 
 int filter = 0;
 texTexture *tex[3];
@@ -270,6 +282,7 @@ meshMesh mesh0;
 meshMesh mesh1;
 meshMesh mesh2;
 depthBuffer dep;
+fbFramebuffer fb;
 
 void handleKeyUp(int button, int shiftIsDown, int controlIsDown,
                  int altOptionIsDown, int superCommandIsDown) {
@@ -319,9 +332,12 @@ void draw() {
   renUpdateViewing(&ren);
   //printf("viewing updated\n");
   depthClearZs(&dep, -1000);
-  pixClearRGB(0.0, 0.0, 0.0);
-  sceneRender(&scen0, &ren, NULL);
-
+  fbClearRGB(&fb, 0.0, 0.0, 0.0);
+  /* Nearest nodes first, so that fewer hidden pixels get shaded. */
+  sceneRenderFrontToBack(&scen0, &ren, NULL);
+#ifndef fbHEADLESS
+  fbPresent(&fb);
+#endif
 }
 
 void handleRotation() {
@@ -346,16 +362,22 @@ hieght and then calls the
 triRender function in 020triangle.c . This is being used to test if triRender
 works fine.
 */
-int main(void) {
+int main(int argc, char *argv[]) {
+#ifndef fbHEADLESS
   if (pixInitialize(512, 512, "Pixel Graphics") != 0)
     return 1;
   else {
+#else
+  {
+#endif
 
     texTexture texture0, texture1, texture2, texture3;
     texInitializeFile(&texture0, "box.jpg");
     texInitializeFile(&texture1, "beachball.jpg");
 
-    depthInitialize(&dep, 512, 512);
+    depthInitialize(&dep, 512, 512, depthFLOAT, depthLINEAR, 1);
+    if (fbInitialize(&fb, 512, 512, fbRGBA8, 1) != 0)
+      return 1;
     tex[0] = &texture0;
     tex[1] = &texture1;
 
@@ -366,13 +388,17 @@ int main(void) {
     ren.colorPixel = colorPixel;
     ren.transformVertex = transformVertex;
     ren.updateUniform = updateUniform;
+    renSetUpdateViewing(&ren, updateViewing);
     ren.depth = &dep;
+    ren.framebuffer = &fb;
 
     texSetLeftRight(&texture0, texREPEAT);
     texSetTopBottom(&texture0, texREPEAT);
 
+#ifndef fbHEADLESS
     pixSetTimeStepHandler(handleTimeStep);
     pixSetKeyUpHandler(handleKeyUp);
+#endif
 
     /////////////////////////left , right, bottom, top,base, lid
     meshInitializeBox(&mesh0, -10.0, 10.0, -10.0, 10.0, -10.0, 10.0);
@@ -393,22 +419,30 @@ int main(void) {
 
     renLookAt(&ren, target, cam[2], cam[0], cam[1]);
     // renSetFrustum(&ren, renORTHOGRAPHIC, M_PI/6.0, 10.0, 10.0);
-    renSetFrustum(&ren, renPERSPECTIVE, M_PI / 6.0, 10.0, 10.0);
+    /* The far plane is 200 units out, so that the scene is inside the
+    frustum, and not clipped away, from the starting distance of 150. */
+    renSetFrustum(&ren, renPERSPECTIVE, M_PI / 6.0, 10.0, 20.0);
     //printf("pi is: %f\n",M_PI);
 
+    int status = 0;
+#ifdef fbHEADLESS
+    status = headlessRun(argc, argv, &ren, &fb, target, cam, draw);
+#else
     draw();
      //printf("Scene Drawn.\n");
     pixRun();
+#endif
     // printf("PixRun\n");
 
     texDestroy(tex[0]);
     meshDestroy(&mesh0);
     depthDestroy(&dep);
+    fbDestroy(&fb);
     texDestroy(tex[1]);
     meshDestroy(&mesh1);
     meshDestroy(&mesh2);
     sceneDestroyRecursively(&scen0);
 
-    return 0;
+    return status;
   }
 }
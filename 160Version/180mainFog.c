@@ -5,17 +5,25 @@ This files includes the main function that test the 020triangle.c rasterizing
 script.
 Run the script like so:
 clang 180mainFog.c 000pixel.o -lglfw -framework OpenGL
+Or, to render without a window (see 210headless.c):
+clang -O2 -DfbHEADLESS 180mainFog.c -lm -lpthread
+In the window, press T to print the renderer's statistics once a second.
 */
 
 #include <stdio.h>
 #include <math.h>
 #include <stdarg.h>
+#ifndef fbHEADLESS
 #include "000pixel.h"
+#endif
 
 #include "100vector.c"
 #include "131matrix.c"
 #include "040texture.c"
 #include "110depth.c"
+#include "120framebuffer.c"
+#include "125heatmap.c"
+#include "220resolution.c"
 
 #define GLFW_KEY_ENTER 257
 #define GLFW_KEY_RIGHT 262
@@ -26,9 +34,15 @@ clang 180mainFog.c 000pixel.o -lglfw -framework OpenGL
 #define GLFW_KEY_KP_SUBTRACT 333
 #define GLFW_KEY_W 87
 #define GLFW_KEY_S 83
+#define GLFW_KEY_T 84
 
 #define renVARYDIMBOUND 16
-#define renVERTNUMBOUND 1000
+
+/* Samples per pixel: 4 for 4x multisample anti-aliasing, or 8, or 1 for none.
+Define it on the command line to override. */
+#ifndef SAMPLENUM
+#define SAMPLENUM 4
+#endif
 
 #include "130renderer.c"
 
@@ -71,7 +85,7 @@ clang 180mainFog.c 000pixel.o -lglfw -framework OpenGL
 #define renUNIFCAMWORLDY 45
 #define renUNIFCAMWORLDZ 46
 
-double x_val = 0.0;
+vecReal x_val = 0.0;
 #define renATTRX 0
 #define renATTRY 1
 #define renATTRZ 2
@@ -83,11 +97,11 @@ double x_val = 0.0;
 
 // double cam[2] = {M_PI/2,-1*M_PI/2};
 // double cam[2] = {M_PI/2,0.0};
-double cam[3] = {0.5, 0.0, 150.0};
+vecReal cam[3] = {0.5, 0.0, 150.0};
 
-double target[3] = {0.0, 0.0, 0.0};
+vecReal target[3] = {0.0, 0.0, 0.0};
 ///////////////////////1.0,1.6
-double unif[47] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+vecReal unif[47] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
 
                     1.0, 0.0, 0.0, 0.0,
                     0.0, 1.0, 0.0, 0.0,
@@ -102,7 +116,7 @@ double unif[47] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
                                   0.0, 0.0, 200.0, 1.0, 1.0, 1.0,
                                   0.0, 0.0, 0.0};
 
-double unif2[47] = {0.0, 0.0, 0.0, 10.0, 10.0, -10.0,
+vecReal unif2[47] = {0.0, 0.0, 0.0, 10.0, 10.0, -10.0,
 
                       1.0, 0.0, 0.0, 0.0,
                       0.0, 1.0, 0.0, 0.0,
@@ -117,7 +131,7 @@ double unif2[47] = {0.0, 0.0, 0.0, 10.0, 10.0, -10.0,
                                   0.0, 0.0, 200.0, 1.0, 1.0, 1.0,
                                   0.0, 0.0, 0.0};
 
-double unif3[47] = {0.0, 0.0, 0.0, 10.0, -10.0, 10.0,
+vecReal unif3[47] = {0.0, 0.0, 0.0, 10.0, -10.0, 10.0,
 
                       1.0, 0.0, 0.0, 0.0,
                       0.0, 1.0, 0.0, 0.0,
@@ -133,21 +147,21 @@ double unif3[47] = {0.0, 0.0, 0.0, 10.0, -10.0, 10.0,
                                   0.0, 0.0, 0.0};
 
 /* Writes the vary vector, based on the other parameters. */
-void transformVertex(renRenderer *ren, double unif[], double attr[],
-                     double vary[]) {
+void transformVertex(renRenderer *ren, vecReal unif[], vecReal attr[],
+                     vecReal vary[]) {
   /* For now, just copy attr to varying. Baby steps. */
-  double attrXYZvec[4] = {attr[renATTRX], attr[renATTRY], attr[renATTRZ], 1.0};
+  vecReal attrXYZvec[4] = {attr[renATTRX], attr[renATTRY], attr[renATTRZ], 1.0};
 
-  double attrNOPvec[4] = {attr[5], attr[6], attr[7], 0.0};
-  double RtimesXYZvec[4];
-  double RtimesNOPvec[4];
-  double MtimesRvec[4];
+  vecReal attrNOPvec[4] = {attr[5], attr[6], attr[7], 0.0};
+  vecReal RtimesXYZvec[4];
+  vecReal RtimesNOPvec[4];
+  vecReal MtimesRvec[4];
 
-  mat441Multiply((double(*)[4])(&unif[renUNIFISOMETRY]), attrXYZvec,
+  mat441Multiply((vecReal(*)[4])(&unif[renUNIFISOMETRY]), attrXYZvec,
                  RtimesXYZvec);
-  mat441Multiply((double(*)[4])(&unif[renUNIFISOMETRY]), attrNOPvec,
+  mat441Multiply((vecReal(*)[4])(&unif[renUNIFISOMETRY]), attrNOPvec,
                  RtimesNOPvec);
-  mat441Multiply((double(*)[4])(&unif[renUNIFVIEWING]), RtimesXYZvec,
+  mat441Multiply((vecReal(*)[4])(&unif[renUNIFVIEWING]), RtimesXYZvec,
                  MtimesRvec);
 
   vary[renVARYX] = MtimesRvec[0];
@@ -166,19 +180,54 @@ void transformVertex(renRenderer *ren, double unif[], double attr[],
   vary[renVARYWORLDP] = RtimesNOPvec[2];
 }
 
-/* If unifParent is NULL, then sets the uniform matrix to the
-rotation-translation M described by the other uniforms. If unifParent is not
-NULL, but instead contains a rotation-translation P, then sets the uniform
-matrix to the matrix product P * M. */
-void updateUniform(renRenderer *ren, double unif[], double unifParent[]) {
-  double u[3];
-  double rot[3][3];
-
+/* Does what transformVertex does, to n vertices at once, in the
+structure-of-arrays form described at renSetTransformVertices. */
+void transformVertices(renRenderer *ren, vecReal unif[], int n,
+                       const vecReal attr[], int attrStride, vecReal vary[],
+                       int varyStride) {
+  vecReal(*isometry)[4] = (vecReal(*)[4])(&unif[renUNIFISOMETRY]);
+  vecReal(*viewing)[4] = (vecReal(*)[4])(&unif[renUNIFVIEWING]);
+  vecReal *world[4] = {&vary[renVARYWORLDX * varyStride],
+                       &vary[renVARYWORLDY * varyStride],
+                       &vary[renVARYWORLDZ * varyStride], NULL};
+  vecReal *normal[4] = {&vary[renVARYWORLDN * varyStride],
+                        &vary[renVARYWORLDO * varyStride],
+                        &vary[renVARYWORLDP * varyStride], NULL};
+  vecReal *clip[4] = {&vary[renVARYX * varyStride],
+                      &vary[renVARYY * varyStride],
+                      &vary[renVARYZ * varyStride],
+                      &vary[renVARYW * varyStride]};
+  int l;
+
+  /* An isometry leaves W = 1 alone, so the world coordinates need no W. */
+  mat441MultiplySoA(isometry, n, &attr[renATTRX * attrStride],
+                    &attr[renATTRY * attrStride], &attr[renATTRZ * attrStride],
+                    1.0, world);
+  mat441MultiplySoA(isometry, n, &attr[5 * attrStride], &attr[6 * attrStride],
+                    &attr[7 * attrStride], 0.0, normal);
+  mat441MultiplySoA(viewing, n, world[0], world[1], world[2], 1.0, clip);
+  for (l = 0; l < n; l += 1) {
+    vary[renVARYS * varyStride + l] = attr[renATTRS * attrStride + l];
+    vary[renVARYT * varyStride + l] = attr[renATTRT * attrStride + l];
+  }
+}
 
+/* Copies the camera's position and the viewing transformation into the
+uniforms. The scene calls this only when the camera has changed. */
+void updateViewing(renRenderer *ren, vecReal unif[]) {
+  vec3Copy(ren->cameraTranslation,&unif[renUNIFCAMWORLDX]);
 
-  vecCopy(3,ren->cameraTranslation,&unif[renUNIFCAMWORLDX]);
+  mat44Copy(ren->viewing, (vecReal(*)[4])(&unif[renUNIFVIEWING]));
+}
 
-  mat44Copy(ren->viewing, (double(*)[4])(&unif[renUNIFVIEWING]));
+/* If unifParent is NULL, then sets the uniform matrix to the
+rotation-translation M described by the other uniforms. If unifParent is not
+NULL, but instead contains a rotation-translation P, then sets the uniform
+matrix to the matrix product P * M. The scene calls this only when the node or
+one of its ancestors has moved. */
+void updateUniform(renRenderer *ren, vecReal unif[], vecReal unifParent[]) {
+  vecReal u[3];
+  vecReal rot[3][3];
 
   vec3Spherical(1.0, unif[renUNIFPHI], unif[renUNIFTHETA], u);
   mat33AngleAxisRotation(unif[renUNIFRHO], u, rot);
@@ -187,84 +236,84 @@ void updateUniform(renRenderer *ren, double unif[], double unifParent[]) {
 
     /* The nine uniforms for storing the matrix start at index
     renUNIFISOMETRY. So &unif[renUNIFISOMETRY] is an array containing those
-    nine numbers. We use '(double(*)[3])' to cast it to a 3x3 matrix. */
-    double trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
-                       unif[renUNIFTRANSZ]};
-    mat44Isometry(rot, trans, (double(*)[4])(&unif[renUNIFISOMETRY]));
+    nine numbers. We use '(vecReal(*)[3])' to cast it to a 3x3 matrix. */
+    vecReal trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
+                        unif[renUNIFTRANSZ]};
+    mat44Isometry(rot, trans, (vecReal(*)[4])(&unif[renUNIFISOMETRY]));
 
   } else {
 
-    double m[4][4];
-    double trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
-                       unif[renUNIFTRANSZ]};
+    vecReal m[4][4];
+    vecReal trans[3] = {unif[renUNIFTRANSX], unif[renUNIFTRANSY],
+                        unif[renUNIFTRANSZ]};
     mat44Isometry(rot, trans, m);
-    mat444Multiply((double(*)[4])(&unifParent[renUNIFISOMETRY]), m,
-                   (double(*)[4])(&unif[renUNIFISOMETRY]));
+    mat444Multiply((vecReal(*)[4])(&unifParent[renUNIFISOMETRY]), m,
+                   (vecReal(*)[4])(&unif[renUNIFISOMETRY]));
   }
 }
 
 /* Sets rgb, based on the other parameters, which are unaltered. attr is an
 interpolated attribute vector. */
-void colorPixel(renRenderer *ren, double unif[], texTexture *tex[],
-                double vary[], double rgbz[]) {
+void colorPixel(renRenderer *ren, vecReal unif[], texTexture *tex[],
+                vecReal vary[], vecReal rgbz[]) {
   texSample(tex[0], vary[renVARYS], vary[renVARYT]);
-  double DIFF_INT;
-  double SPEC_INT;
+  vecReal DIFF_INT;
+  vecReal SPEC_INT;
 
-  double light_vec[3] = {unif[renUNIFLIGHTX], unif[renUNIFLIGHTY],
-                         unif[renUNIFLIGHTZ]};
-  vecUnit(3, light_vec, light_vec);
+  vecReal light_vec[3] = {unif[renUNIFLIGHTX], unif[renUNIFLIGHTY],
+                          unif[renUNIFLIGHTZ]};
+  vec3Unit(light_vec, light_vec);
 
-  double world_vec[3] = {vary[renVARYWORLDX], vary[renVARYWORLDY],
-                         vary[renVARYWORLDZ]};
-  vecUnit(3, world_vec, world_vec);
+  vecReal world_vec[3] = {vary[renVARYWORLDX], vary[renVARYWORLDY],
+                          vary[renVARYWORLDZ]};
+  vec3Unit(world_vec, world_vec);
 
 
-  double cam_vec[3] = {unif[renUNIFCAMWORLDX], unif[renUNIFCAMWORLDY],
-                       unif[renUNIFCAMWORLDZ]};
-  vecUnit(3, cam_vec, cam_vec);
+  vecReal cam_vec[3] = {unif[renUNIFCAMWORLDX], unif[renUNIFCAMWORLDY],
+                        unif[renUNIFCAMWORLDZ]};
+  vec3Unit(cam_vec, cam_vec);
 
-  double normal[3] = {vary[renVARYWORLDN], vary[renVARYWORLDO],
-                      vary[renVARYWORLDP]};
-  vecUnit(3, normal, normal);
+  vecReal normal[3] = {vary[renVARYWORLDN], vary[renVARYWORLDO],
+                       vary[renVARYWORLDP]};
+  vec3Unit(normal, normal);
 
-  double sub_vec[3];
-  double light[3];
-  double ndotl;
+  vecReal sub_vec[3];
+  vecReal light[3];
+  vecReal ndotl;
 
-  vecSubtract(3, light_vec, world_vec, sub_vec);
-  vecUnit(3, sub_vec, light);
-  ndotl = vecDot(3, normal, light);
+  vec3Subtract(light_vec, world_vec, sub_vec);
+  vec3Unit(sub_vec, light);
+  ndotl = vec3Dot(normal, light);
   DIFF_INT = fmax(0.0, ndotl);
 
-  double reflect[3];
-  double rdotc;
+  vecReal reflect[3];
+  vecReal rdotc;
 
-  vecScale(3, 2 * ndotl, normal, sub_vec);
-  vecSubtract(3, sub_vec, light, reflect);
-  vecUnit(3, reflect, reflect);
-  rdotc = vecDot(3, reflect, cam_vec);
+  vec3Scale(2 * ndotl, normal, sub_vec);
+  vec3Subtract(sub_vec, light, reflect);
+  vec3Unit(reflect, reflect);
+  rdotc = vec3Dot(reflect, cam_vec);
   SPEC_INT = fmax(0.0, rdotc);
   SPEC_INT = pow(SPEC_INT, 30);
 
   //ambient calculation
-  double amb_int = 0.1;
-  double amb[3] = {amb_int*unif[renUNIFLIGHTR], amb_int*unif[renUNIFLIGHTG], amb_int*unif[renUNIFLIGHTB]};
+  vecReal amb_int = 0.1;
+  vecReal amb[3] = {amb_int*unif[renUNIFLIGHTR], amb_int*unif[renUNIFLIGHTG], amb_int*unif[renUNIFLIGHTB]};
 
   //fog calculation
-  double z = vary[renVARYZ];
-  double g[3] = {0.5, 0.5, 0.5};
-  double c[3];
+  vecReal z = vary[renVARYZ];
+  vecReal g[3] = {0.5, 0.5, 0.5};
+  vecReal c[3];
   c[0] = (SPEC_INT + DIFF_INT + (amb[0])) * unif[renUNIFLIGHTR] * tex[0]->sample[renTEXR];
   c[1] = (SPEC_INT + DIFF_INT + (amb[1])) * unif[renUNIFLIGHTG] * tex[0]->sample[renTEXG];
   c[2] = (SPEC_INT + DIFF_INT + (amb[2])) * unif[renUNIFLIGHTB] * tex[0]->sample[renTEXB];
 
-  double scale_z = (z+1)/2;
-  double new_c[3];
+  vecReal scale_z = (z+1)/2;
+  vecReal new_c[3];
 
-  vecScale(3, scale_z, c, c);
-  vecScale(3, 1-scale_z, g, g);
-  vecAdd(3, c, g, new_c);
+  vec3Scale(scale_z, c, c);
+  vec3Scale(1-scale_z, g, g);
+  vec3Add(c, g, new_c);
 
   rgbz[0] = new_c[0];
   rgbz[1] = new_c[1];
@@ -272,10 +321,63 @@ void colorPixel(renRenderer *ren, double unif[], texTexture *tex[],
   rgbz[3] = depthGetZ(ren->depth, vary[renVARYX], vary[renVARYY]);
 }
 
+/* Does what colorPixel does, to n pixels at once, in the structure-of-arrays
+form described at renSetColorPixels. The light and camera directions and the
+ambient light are worked out once per call, rather than once per pixel. */
+void colorPixels(renRenderer *ren, vecReal unif[], texTexture *tex[], int n,
+                 const vecReal vary[], int varyStride, vecReal rgb[],
+                 int rgbStride) {
+  vecReal light_vec[3] = {unif[renUNIFLIGHTX], unif[renUNIFLIGHTY],
+                          unif[renUNIFLIGHTZ]};
+  vec3Unit(light_vec, light_vec);
+  vecReal cam_vec[3] = {unif[renUNIFCAMWORLDX], unif[renUNIFCAMWORLDY],
+                        unif[renUNIFCAMWORLDZ]};
+  vec3Unit(cam_vec, cam_vec);
+  vecReal amb_int = 0.1;
+  vecReal amb[3] = {amb_int*unif[renUNIFLIGHTR], amb_int*unif[renUNIFLIGHTG], amb_int*unif[renUNIFLIGHTB]};
+  int l, k;
+
+  for (l = 0; l < n; l += 1) {
+    texSample(tex[0], vary[renVARYS * varyStride + l],
+              vary[renVARYT * varyStride + l]);
+    vecReal world_vec[3] = {vary[renVARYWORLDX * varyStride + l],
+                            vary[renVARYWORLDY * varyStride + l],
+                            vary[renVARYWORLDZ * varyStride + l]};
+    vec3Unit(world_vec, world_vec);
+    vecReal normal[3] = {vary[renVARYWORLDN * varyStride + l],
+                         vary[renVARYWORLDO * varyStride + l],
+                         vary[renVARYWORLDP * varyStride + l]};
+    vec3Unit(normal, normal);
+
+    vecReal sub_vec[3], light[3], reflect[3];
+    vec3Subtract(light_vec, world_vec, sub_vec);
+    vec3Unit(sub_vec, light);
+    vecReal ndotl = vec3Dot(normal, light);
+    vecReal diff_int = fmax(0.0, ndotl);
+    vec3Scale(2 * ndotl, normal, sub_vec);
+    vec3Subtract(sub_vec, light, reflect);
+    vec3Unit(reflect, reflect);
+    vecReal spec_int = pow(fmax(0.0, vec3Dot(reflect, cam_vec)), 30);
+
+    //fog calculation
+    vecReal scale_z = (vary[renVARYZ * varyStride + l] + 1) / 2;
+    for (k = 0; k < 3; k += 1)
+      rgb[k * rgbStride + l] = scale_z * ((spec_int + diff_int + amb[k]) *
+                               unif[renUNIFLIGHTR + k] *
+                               tex[0]->sample[renTEXR + k]) +
+                               (1 - scale_z) * 0.5;
+  }
+}
+
 #include "110triangle.c"
+#include "190tiling.c"
 #include "140clipping.c"
 #include "140mesh.c"
+#include "150simplify.c"
 #include "090scene.c"
+#ifdef fbHEADLESS
+#include "210headless.c"
+#endif
 
 int filter = 0;
 texTexture *tex[3];
@@ -284,9 +386,18 @@ sceneNode scen0;
 sceneNode scen1;
 sceneNode scen2;
 meshMesh mesh0;
-meshMesh mesh1;
-meshMesh mesh2;
+/* The spheres' levels of detail, finest first, which both spheres share: a
+sphere with 20 layers and 20 sides, and then that sphere simplified down to
+these many triangles. */
+#define LODNUM 5
+int lodTriNums[LODNUM] = {0, 400, 200, 100, 50};
+meshMesh sphereLODs[LODNUM];
 depthBuffer dep;
+fbFramebuffer fb;
+/* The window's pixels, into which fb is stretched (see 220resolution.c). */
+fbFramebuffer screen;
+resController res;
+tileBinner binner;
 
 void handleKeyUp(int button, int shiftIsDown, int controlIsDown,
                  int altOptionIsDown, int superCommandIsDown) {
@@ -329,16 +440,34 @@ void handleKeyUp(int button, int shiftIsDown, int controlIsDown,
   } else if (button == GLFW_KEY_KP_SUBTRACT || button == GLFW_KEY_S) {
       cam[2] = cam[2] - 1.0;
 
+  } else if (button == GLFW_KEY_T) {
+    /* Statistics cost a few clock readings per triangle, so they are off
+    until asked for. */
+    renSetStats(&ren, !ren.statsOn);
   }
 }
 
 void draw() {
+  /* Draw at the size that the dynamic resolution controller chose. */
+  renSetViewportSize(&ren, res.renderWidth, res.renderHeight);
   renUpdateViewing(&ren);
   //printf("viewing updated\n");
   depthClearZs(&dep, -1000);
-  pixClearRGB(0.0, 0.0, 0.0);
-  sceneRender(&scen0, &ren, NULL);
-
+  fbClearRGB(&fb, 0.0, 0.0, 0.0);
+  renResetStats(&ren);
+  /* Nearest nodes first, so that fewer hidden pixels get shaded. */
+  sceneRenderFrontToBack(&scen0, &ren, NULL);
+  if (ren.binner != NULL)
+    tileFlush(&ren);
+  fbResolve(&fb);
+#ifndef fbHEADLESS
+  if (res.renderWidth == fb.width && res.renderHeight == fb.height)
+    fbPresent(&fb);
+  else {
+    resUpscale(&res, &fb, &screen);
+    fbPresent(&screen);
+  }
+#endif
 }
 
 void handleRotation() {
@@ -347,8 +476,14 @@ void handleRotation() {
 }
 
 void handleTimeStep(double oldTime, double newTime) {
-  if (floor(newTime) - floor(oldTime) >= 1.0)
+  if (floor(newTime) - floor(oldTime) >= 1.0) {
     printf("handleTimeStep: %f frames/sec\n", 1.0 / (newTime - oldTime));
+    if (ren.statsOn)
+      renPrintStats(&ren.stats, stdout, renSTATSTEXT);
+    printf("handleTimeStep: drawing %d x %d\n", res.renderWidth,
+           res.renderHeight);
+  }
+  resUpdate(&res, newTime - oldTime);
   // printf("[%f, %f]\n", cam[0], cam[1]);
   handleRotation();
   // printf("cam: %f\n", cam[2]);
@@ -363,16 +498,27 @@ hieght and then calls the
 triRender function in 020triangle.c . This is being used to test if triRender
 works fine.
 */
-int main(void) {
+int main(int argc, char *argv[]) {
+#ifndef fbHEADLESS
   if (pixInitialize(512, 512, "Pixel Graphics") != 0)
     return 1;
   else {
+#else
+  {
+#endif
 
     texTexture texture0, texture1, texture2, texture3;
     texInitializeFile(&texture0, "box.jpg");
     texInitializeFile(&texture1, "beachball.jpg");
 
-    depthInitialize(&dep, 512, 512);
+    if (depthInitialize(&dep, 512, 512, depthFLOAT, depthLINEAR,
+                        SAMPLENUM) != 0 ||
+        fbInitialize(&fb, 512, 512, fbRGBA8, SAMPLENUM) != 0 ||
+        fbInitialize(&screen, 512, 512, fbRGBA8, 1) != 0)
+      return 1;
+    /* Hold 30 frames/sec, drawing anywhere from half to full size. Without a
+    window, the frames are always full size. */
+    resInitialize(&res, 512, 512, 1.0 / 30.0, 0.5, 1.0);
     tex[0] = &texture0;
     tex[1] = &texture1;
 
@@ -381,24 +527,48 @@ int main(void) {
     ren.texNum = 1;
     ren.unifDim = 47;
     ren.colorPixel = colorPixel;
+    renSetColorPixels(&ren, colorPixels);
     ren.transformVertex = transformVertex;
+    renSetTransformVertices(&ren, transformVertices);
     ren.updateUniform = updateUniform;
+    renSetUpdateViewing(&ren, updateViewing);
     ren.depth = &dep;
+    ren.framebuffer = &fb;
+    ren.binner = NULL;
+    /* colorPixel never reads the interpolated R, G and B. */
+    renSetVaryingMask(&ren, (1 << renVARYS) | (1 << renVARYT) |
+                      (1 << renVARYWORLDX) | (1 << renVARYWORLDY) |
+                      (1 << renVARYWORLDZ) | (1 << renVARYWORLDN) |
+                      (1 << renVARYWORLDO) | (1 << renVARYWORLDP));
 
     texSetLeftRight(&texture0, texREPEAT);
     texSetTopBottom(&texture0, texREPEAT);
 
+#ifndef fbHEADLESS
     pixSetTimeStepHandler(handleTimeStep);
     pixSetKeyUpHandler(handleKeyUp);
+#endif
 
     /////////////////////////left , right, bottom, top,base, lid
     meshInitializeBox(&mesh0, -10.0, 10.0, -10.0, 10.0, -10.0, 10.0);
-    meshInitializeSphere(&mesh1, 5, 20, 20);
-    meshInitializeSphere(&mesh2, 5, 20, 20);
+    meshMesh *lodMeshes[LODNUM];
+    vecReal lodErrors[LODNUM];
+    int l;
+    if (meshInitializeSphere(&sphereLODs[0], 5, 20, 20) != 0 ||
+        simpInitializeChain(&sphereLODs[1], &lodErrors[1], &sphereLODs[0],
+                            LODNUM - 1, &lodTriNums[1]) != 0)
+      return 1;
+    lodErrors[0] = 0.0;
+    for (l = 0; l < LODNUM; l += 1)
+      lodMeshes[l] = &sphereLODs[l];
 
     sceneInitialize(&scen0, &ren, unif, tex, &mesh0, NULL, NULL);
-    sceneInitialize(&scen1, &ren, unif, tex, &mesh1, NULL, NULL);
-    sceneInitialize(&scen2, &ren, unif, tex, &mesh2, NULL, NULL);
+    sceneInitialize(&scen1, &ren, unif, tex, lodMeshes[0], NULL, NULL);
+    sceneInitialize(&scen2, &ren, unif, tex, lodMeshes[0], NULL, NULL);
+    /* Farther spheres are drawn with fewer triangles. */
+    if (sceneSetLODs(&scen1, LODNUM, lodMeshes, lodErrors) != 0 ||
+        sceneSetLODs(&scen2, LODNUM, lodMeshes, lodErrors) != 0)
+      return 1;
 
     sceneSetTexture(&scen1, &ren, 0, &texture1);
     sceneSetTexture(&scen2, &ren, 0, &texture1);
@@ -408,24 +578,40 @@ int main(void) {
     sceneAddChild(&scen0, &scen1);
     sceneAddSibling(&scen0, &scen2);
 
+    /* Rasterize and shade in screen tiles, on 8 threads, shading each
+    visible pixel once. */
+    if (tileInitialize(&binner, &ren, 8) != 0 ||
+        renSetShadingMode(&ren, renDEFERRED) != 0)
+      return 1;
+
     renLookAt(&ren, target, cam[2], cam[0], cam[1]);
     // renSetFrustum(&ren, renORTHOGRAPHIC, M_PI/6.0, 10.0, 10.0);
-    renSetFrustum(&ren, renPERSPECTIVE, M_PI / 6.0, 10.0, 10.0);
+    /* The far plane is 200 units out, so that the scene is inside the
+    frustum, and not clipped away, from the starting distance of 150. */
+    renSetFrustum(&ren, renPERSPECTIVE, M_PI / 6.0, 10.0, 20.0);
     //printf("pi is: %f\n",M_PI);
 
+    int status = 0;
+#ifdef fbHEADLESS
+    status = headlessRun(argc, argv, &ren, &fb, target, cam, draw);
+#else
     draw();
      //printf("Scene Drawn.\n");
     pixRun();
+#endif
     // printf("PixRun\n");
 
     texDestroy(tex[0]);
     meshDestroy(&mesh0);
+    tileDestroy(&binner);
     depthDestroy(&dep);
+    fbDestroy(&fb);
+    fbDestroy(&screen);
     texDestroy(tex[1]);
-    meshDestroy(&mesh1);
-    meshDestroy(&mesh2);
+    for (l = 0; l < LODNUM; l += 1)
+      meshDestroy(&sphereLODs[l]);
     sceneDestroyRecursively(&scen0);
 
-    return 0;
+    return status;
   }
 }
@@ -0,0 +1,482 @@
+/*
+@ Author:  Sabastian Mugazambi & Tore Banta
+@ Date: 01/07/2017
+This file has a sort-middle mode for the renderer. Triangles that come out of
+clipping are binned into square screen tiles, instead of being rasterized right
+away. At the end of the frame, tileFlush hands the tiles to a pool of threads.
+Each thread owns the depth buffer and framebuffer of whatever tile it is
+working on, so no locking is needed while drawing. Within a tile the triangles
+are drawn in the order in which they were submitted, so the picture is
+identical to the one drawn without tiles. In deferred shading mode (see
+renSetShadingMode), each tile is first rasterized into depth and a visibility
+buffer, and then each of its visible pixels is shaded once.
+*/
+
+#include <pthread.h>
+
+/* Tiles are tileSIZE x tileSIZE pixels. */
+#define tileSIZE 64
+
+typedef struct tileBinner tileBinner;
+typedef struct tileWorker tileWorker;
+
+/* One thread of the pool. Shading may sample textures, and texSample writes
+into the texture's scratch space, so each worker shades with private copies of
+the textures, which share the texels but have their own scratch space. */
+struct tileWorker {
+  tileBinner *binner;
+  pthread_t thread;
+  texTexture *tex;       /* texNum private copies */
+  texTexture **texPtrs;  /* texNum pointers, to the copies or NULL */
+  vecReal *scratch;      /* aux and sample space for the copies */
+  int scratchDim;
+  renStats stats;        /* this thread's share of the flush's statistics */
+};
+
+/* Feel free to read the struct's members, but don't write them. */
+struct tileBinner {
+  renRenderer *ren;
+  int width, height, tileCols, tileRows;
+  /* A draw is a copy of one meshRender's uniforms and texture pointers. */
+  int drawNum, drawCap, drawTexCap, drawOpen;
+  vecReal *drawUnif;        /* drawCap * unifDim numbers */
+  texTexture **drawTex;     /* drawCap * texNum pointers */
+  vecReal *drawSource;      /* unif that the open draw was copied from */
+  /* Set-up triangles, with the draw that each belongs to. */
+  int triNum, triCap, triSetupCap;
+  triSetup *triSetups;      /* triCap set-ups */
+  int *triDraw;             /* triCap ints */
+  /* For each tile, the indices of the triangles that may touch it. */
+  int *binNum, *binCap;
+  int **bins;
+  /* For deferred shading: the triangle visible at each sample, or -1, with
+  sample s of pixel (i, j) at i + width * (j + height * s). */
+  int *visTri;
+  /* The pool. */
+  int threadNum;
+  tileWorker *workers;
+  pthread_mutex_t lock;
+  pthread_cond_t start, done;
+  int generation, nextTile, working, quit;
+};
+
+/*** Private ***/
+
+/* Makes sure that the array *array, of elements of the given size, has room
+for at least need elements. Returns 0 if no error occurred. */
+int tileReserve(void **array, int *cap, int need, size_t size) {
+  if (need <= *cap)
+    return 0;
+  int newCap = (*cap > 0) ? *cap : 16;
+  while (newCap < need)
+    newCap *= 2;
+  void *newArray = realloc(*array, newCap * size);
+  if (newArray == NULL)
+    return 1;
+  *array = newArray;
+  *cap = newCap;
+  return 0;
+}
+
+/* Points the worker's texture pointers at private copies of the draw's
+textures. Returns 0 if no error occurred. On error, the texture pointers are
+all NULL, and the draw should not be shaded. */
+int tileWorkerTextures(tileWorker *worker, int draw) {
+  tileBinner *binner = worker->binner;
+  int texNum = binner->ren->texNum, k, dim = 0;
+  texTexture **tex = &binner->drawTex[draw * texNum];
+  for (k = 0; k < texNum; k += 1)
+    if (tex[k] != NULL && tex[k]->texelDim > dim)
+      dim = tex[k]->texelDim;
+  if (texNum * 2 * dim > worker->scratchDim) {
+    vecReal *scratch = (vecReal *)realloc(worker->scratch,
+                                          texNum * 2 * dim * sizeof(vecReal));
+    if (scratch == NULL) {
+      fprintf(stderr, "error: tileWorkerTextures: out of memory.\n");
+      for (k = 0; k < texNum; k += 1)
+        worker->texPtrs[k] = NULL;
+      return 1;
+    }
+    worker->scratch = scratch;
+    worker->scratchDim = texNum * 2 * dim;
+  }
+  for (k = 0; k < texNum; k += 1)
+    if (tex[k] == NULL)
+      worker->texPtrs[k] = NULL;
+    else {
+      worker->tex[k] = *tex[k];
+      worker->tex[k].aux = &worker->scratch[k * 2 * dim];
+      worker->tex[k].sample = &worker->scratch[k * 2 * dim + dim];
+      worker->texPtrs[k] = &worker->tex[k];
+    }
+  return 0;
+}
+
+/* Shades the n pixels of row j gathered by tileShadeVisible, which all belong
+to the given draw, with one call to colorPixels. Each color goes to the samples
+in its mask. */
+void tileShadeBatch(tileWorker *worker, int draw, int n, vecReal vary[],
+                    const unsigned int mask[], vecReal rgb[], int j) {
+  tileBinner *binner = worker->binner;
+  renRenderer *ren = binner->ren;
+  int l;
+  ren->colorPixels(ren, &binner->drawUnif[draw * ren->unifDim],
+                   worker->texPtrs, n, vary, triCHUNK, rgb, triCHUNK);
+  for (l = 0; l < n; l += 1)
+    fbSetSamplesRGB(ren->framebuffer, (int)vary[renVARYX * triCHUNK + l], j,
+                    mask[l], rgb[l], rgb[triCHUNK + l], rgb[2 * triCHUNK + l]);
+}
+
+/* Shades each visible pixel of the tile once, from the visibility buffer. The
+varyings are rebuilt from the visible triangle's planes, exactly as
+hiddenRender would have computed them. If the renderer has colorPixels, then
+the visible pixels of each row are shaded in runs that share a draw. If the
+buffers are multisampled, then a pixel whose samples see several triangles is
+shaded once for each of them, at its center, and each color goes to the samples
+that see that triangle. */
+void tileShadeVisible(tileWorker *worker, triTarget *target) {
+  tileBinner *binner = worker->binner;
+  renRenderer *ren = binner->ren;
+  int sampleNum = ren->depth->sampleNum;
+  int plane = binner->width * binner->height;
+  vecReal vary[renVARYDIMBOUND], rgbz[4];
+  vecReal batchVary[renVARYDIMBOUND * triCHUNK], batchRGB[3 * triCHUNK];
+  unsigned int batchMask[triCHUNK];
+  int batchNum = 0;
+  int i, j, k, s, draw = -1, skip = 0;
+  for (k = 0; k < ren->varyDim; k += 1)
+    vary[k] = 0.0;
+  for (j = target->yMin; j <= target->yMax; j += 1) {
+    for (i = target->xMin; i <= target->xMax; i += 1) {
+      int index = i + binner->width * j;
+      /* The samples not yet shaded. */
+      unsigned int left = (1u << sampleNum) - 1;
+      while (left != 0) {
+        int first = __builtin_ctz(left);
+        int tri = binner->visTri[index + plane * first];
+        unsigned int mask = 0;
+        for (s = first; s < sampleNum; s += 1)
+          if (binner->visTri[index + plane * s] == tri)
+            mask |= 1u << s;
+        left &= ~mask;
+        if (tri < 0)
+          continue;
+        if (binner->triDraw[tri] != draw || batchNum == triCHUNK) {
+          if (batchNum > 0)
+            tileShadeBatch(worker, draw, batchNum, batchVary, batchMask,
+                           batchRGB, j);
+          batchNum = 0;
+          if (binner->triDraw[tri] != draw) {
+            draw = binner->triDraw[tri];
+            skip = tileWorkerTextures(worker, draw);
+          }
+        }
+        if (skip)
+          continue;
+        triInterpolate(&binner->triSetups[tri], i, j, vary);
+        if (target->stats != NULL)
+          target->stats->shadedNum += 1;
+        if (ren->heat != NULL)
+          ren->heat->shaded[index] += 1;
+        if (ren->colorPixels != NULL) {
+          for (k = 0; k < ren->varyDim; k += 1)
+            batchVary[k * triCHUNK + batchNum] = vary[k];
+          batchMask[batchNum] = mask;
+          batchNum += 1;
+        } else {
+          ren->colorPixel(ren, &binner->drawUnif[draw * ren->unifDim],
+                          worker->texPtrs, vary, rgbz);
+          fbSetSamplesRGB(ren->framebuffer, i, j, mask, rgbz[0], rgbz[1],
+                          rgbz[2]);
+        }
+      }
+    }
+    if (batchNum > 0)
+      tileShadeBatch(worker, draw, batchNum, batchVary, batchMask, batchRGB,
+                     j);
+    batchNum = 0;
+  }
+}
+
+/* Draws every triangle binned into the given tile, in submission order. */
+void tileRasterize(tileWorker *worker, int tile) {
+  tileBinner *binner = worker->binner;
+  renRenderer *ren = binner->ren;
+  int x = (tile % binner->tileCols) * tileSIZE;
+  int y = (tile / binner->tileCols) * tileSIZE;
+  triTarget target = {x, x + tileSIZE - 1, y, y + tileSIZE - 1,
+                      NULL, 0, ren->statsOn ? &worker->stats : NULL};
+  double start = ren->statsOn ? renThreadNow() : 0.0;
+  if (target.xMax >= renGetViewportWidth(ren))
+    target.xMax = renGetViewportWidth(ren) - 1;
+  if (target.yMax >= renGetViewportHeight(ren))
+    target.yMax = renGetViewportHeight(ren) - 1;
+  int i, j, draw = -1, skip = 0;
+  int deferred = (ren->shadingMode == renDEFERRED);
+  if (deferred) {
+    int s;
+    target.visTri = binner->visTri;
+    for (s = 0; s < ren->depth->sampleNum; s += 1)
+      for (j = target.yMin; j <= target.yMax; j += 1)
+        for (i = target.xMin; i <= target.xMax; i += 1)
+          binner->visTri[i + binner->width * (j + binner->height * s)] = -1;
+  }
+  for (i = 0; i < binner->binNum[tile]; i += 1) {
+    int tri = binner->bins[tile][i];
+    if (binner->triDraw[tri] != draw) {
+      draw = binner->triDraw[tri];
+      if (!deferred)
+        skip = tileWorkerTextures(worker, draw);
+    }
+    if (skip)
+      continue;
+    target.tri = tri;
+    hiddenRender(ren, &binner->drawUnif[draw * ren->unifDim], worker->texPtrs,
+                 &binner->triSetups[tri], &target);
+  }
+  if (ren->statsOn) {
+    double end = renThreadNow();
+    worker->stats.rasterTime += end - start;
+    start = end;
+  }
+  if (deferred)
+    tileShadeVisible(worker, &target);
+  if (ren->statsOn && deferred)
+    worker->stats.shadeTime += renThreadNow() - start;
+}
+
+/* The body of each worker thread. Waits for a flush, then takes tiles until
+there are none left, then waits again. */
+void *tileWork(void *arg) {
+  tileWorker *worker = (tileWorker *)arg;
+  tileBinner *binner = worker->binner;
+  int tileNum = binner->tileCols * binner->tileRows, seen = 0;
+  pthread_mutex_lock(&binner->lock);
+  while (1) {
+    while (binner->generation == seen && binner->quit == 0)
+      pthread_cond_wait(&binner->start, &binner->lock);
+    if (binner->quit != 0)
+      break;
+    seen = binner->generation;
+    while (binner->nextTile < tileNum) {
+      int tile = binner->nextTile;
+      binner->nextTile += 1;
+      pthread_mutex_unlock(&binner->lock);
+      if (binner->binNum[tile] > 0)
+        tileRasterize(worker, tile);
+      pthread_mutex_lock(&binner->lock);
+    }
+    binner->working -= 1;
+    if (binner->working == 0)
+      pthread_cond_signal(&binner->done);
+  }
+  pthread_mutex_unlock(&binner->lock);
+  return NULL;
+}
+
+/*** Public ***/
+
+/* Initializes the binner for the renderer's depth buffer, which must already
+be set, and starts threadNum >= 1 worker threads. From now on the renderer bins
+triangles instead of drawing them, until tileDestroy is called. Call tileFlush
+at the end of every frame. Returns 0 if no error occurred. */
+int tileInitialize(tileBinner *binner, renRenderer *ren, int threadNum) {
+  int tileNum, i;
+  binner->ren = ren;
+  binner->width = ren->depth->width;
+  binner->height = ren->depth->height;
+  binner->tileCols = (binner->width + tileSIZE - 1) / tileSIZE;
+  binner->tileRows = (binner->height + tileSIZE - 1) / tileSIZE;
+  tileNum = binner->tileCols * binner->tileRows;
+  binner->drawNum = 0;
+  binner->drawCap = 0;
+  binner->drawTexCap = 0;
+  binner->drawOpen = 0;
+  binner->drawUnif = NULL;
+  binner->drawTex = NULL;
+  binner->drawSource = NULL;
+  binner->triNum = 0;
+  binner->triCap = 0;
+  binner->triSetupCap = 0;
+  binner->triSetups = NULL;
+  binner->triDraw = NULL;
+  binner->binNum = (int *)calloc(2 * tileNum, sizeof(int));
+  binner->bins = (int **)calloc(tileNum, sizeof(int *));
+  binner->visTri = (int *)malloc(binner->width * binner->height *
+                                 ren->depth->sampleNum * sizeof(int));
+  binner->workers = (tileWorker *)calloc(threadNum, sizeof(tileWorker));
+  if (binner->binNum == NULL || binner->bins == NULL ||
+      binner->visTri == NULL || binner->workers == NULL) {
+    free(binner->binNum);
+    free(binner->bins);
+    free(binner->visTri);
+    free(binner->workers);
+    return 1;
+  }
+  binner->binCap = &binner->binNum[tileNum];
+  pthread_mutex_init(&binner->lock, NULL);
+  pthread_cond_init(&binner->start, NULL);
+  pthread_cond_init(&binner->done, NULL);
+  binner->generation = 0;
+  binner->nextTile = 0;
+  binner->working = 0;
+  binner->quit = 0;
+  binner->threadNum = 0;
+  for (i = 0; i < threadNum; i += 1) {
+    tileWorker *worker = &binner->workers[i];
+    worker->binner = binner;
+    worker->tex = (texTexture *)malloc(ren->texNum * sizeof(texTexture) +
+                                       ren->texNum * sizeof(texTexture *));
+    if (worker->tex == NULL)
+      break;
+    worker->texPtrs = (texTexture **)&worker->tex[ren->texNum];
+    worker->scratch = NULL;
+    worker->scratchDim = 0;
+    if (pthread_create(&worker->thread, NULL, tileWork, worker) != 0) {
+      free(worker->tex);
+      break;
+    }
+    binner->threadNum += 1;
+  }
+  if (binner->threadNum == 0) {
+    fprintf(stderr, "error: tileInitialize: could not start any threads.\n");
+    pthread_mutex_destroy(&binner->lock);
+    pthread_cond_destroy(&binner->start);
+    pthread_cond_destroy(&binner->done);
+    free(binner->binNum);
+    free(binner->bins);
+    free(binner->visTri);
+    free(binner->workers);
+    return 1;
+  }
+  ren->binner = binner;
+  return 0;
+}
+
+/* Starts a new draw, copying the uniforms and texture pointers, so that the
+caller may change them before the tiles are flushed. meshRender calls this
+once per mesh. */
+void tileBeginDraw(renRenderer *ren, vecReal unif[], texTexture *tex[]) {
+  tileBinner *binner = ren->binner;
+  if (tileReserve((void **)&binner->drawUnif, &binner->drawCap,
+                  binner->drawNum + 1, ren->unifDim * sizeof(vecReal)) != 0) {
+    fprintf(stderr, "error: tileBeginDraw: out of memory.\n");
+    binner->drawOpen = 0;
+    return;
+  }
+  if (tileReserve((void **)&binner->drawTex, &binner->drawTexCap,
+                  binner->drawNum + 1,
+                  (ren->texNum + 1) * sizeof(texTexture *)) != 0) {
+    fprintf(stderr, "error: tileBeginDraw: out of memory.\n");
+    binner->drawOpen = 0;
+    return;
+  }
+  vecCopy(ren->unifDim, unif, &binner->drawUnif[binner->drawNum * ren->unifDim]);
+  for (int k = 0; k < ren->texNum; k += 1)
+    binner->drawTex[binner->drawNum * ren->texNum + k] = tex[k];
+  binner->drawSource = unif;
+  binner->drawNum += 1;
+  binner->drawOpen = 1;
+}
+
+/* Records the set-up triangle in every tile that its bounding box touches. If
+the triangle does not come from the open draw (because triRender was called
+without meshRender), then a new draw is started for it. */
+void tileBinTriangle(renRenderer *ren, vecReal unif[], texTexture *tex[],
+                     const triSetup *setup) {
+  tileBinner *binner = ren->binner;
+  int xLow = setup->xLow, xHigh = setup->xHigh;
+  int yLow = setup->yLow, yHigh = setup->yHigh;
+  if (xLow < 0) xLow = 0;
+  if (yLow < 0) yLow = 0;
+  if (xHigh >= renGetViewportWidth(ren)) xHigh = renGetViewportWidth(ren) - 1;
+  if (yHigh >= renGetViewportHeight(ren)) yHigh = renGetViewportHeight(ren) - 1;
+  if (xLow > xHigh || yLow > yHigh)
+    return;
+  if (binner->drawOpen == 0 || binner->drawSource != unif)
+    tileBeginDraw(ren, unif, tex);
+  if (binner->drawOpen == 0)
+    return;
+  if (tileReserve((void **)&binner->triSetups, &binner->triSetupCap,
+                  binner->triNum + 1, sizeof(triSetup)) != 0 ||
+      tileReserve((void **)&binner->triDraw, &binner->triCap,
+                  binner->triNum + 1, sizeof(int)) != 0) {
+    fprintf(stderr, "error: tileBinTriangle: out of memory.\n");
+    return;
+  }
+  int tri = binner->triNum;
+  binner->triSetups[tri] = *setup;
+  binner->triDraw[tri] = binner->drawNum - 1;
+  binner->triNum += 1;
+  int col, row;
+  for (row = yLow / tileSIZE; row <= yHigh / tileSIZE; row += 1)
+    for (col = xLow / tileSIZE; col <= xHigh / tileSIZE; col += 1) {
+      int tile = col + binner->tileCols * row;
+      if (tileReserve((void **)&binner->bins[tile], &binner->binCap[tile],
+                      binner->binNum[tile] + 1, sizeof(int)) != 0) {
+        fprintf(stderr, "error: tileBinTriangle: out of memory.\n");
+        return;
+      }
+      binner->bins[tile][binner->binNum[tile]] = tri;
+      binner->binNum[tile] += 1;
+    }
+}
+
+/* Rasterizes and shades every binned triangle into the renderer's
+framebuffer, using all of the worker threads. Empties the bins for the next
+frame. */
+void tileFlush(renRenderer *ren) {
+  tileBinner *binner = ren->binner;
+  int tileNum = binner->tileCols * binner->tileRows, tile, i;
+  renStats zero = {0};
+  for (i = 0; i < binner->threadNum; i += 1)
+    binner->workers[i].stats = zero;
+  pthread_mutex_lock(&binner->lock);
+  binner->nextTile = 0;
+  binner->working = binner->threadNum;
+  binner->generation += 1;
+  pthread_cond_broadcast(&binner->start);
+  while (binner->working > 0)
+    pthread_cond_wait(&binner->done, &binner->lock);
+  pthread_mutex_unlock(&binner->lock);
+  for (i = 0; i < binner->threadNum; i += 1)
+    renAddStats(&ren->stats, &binner->workers[i].stats);
+  for (tile = 0; tile < tileNum; tile += 1)
+    binner->binNum[tile] = 0;
+  binner->triNum = 0;
+  binner->drawNum = 0;
+  binner->drawOpen = 0;
+}
+
+/* Stops the worker threads and deallocates the binner's resources. The
+renderer goes back to drawing triangles as soon as they are submitted, and so
+to immediate shading (see renSetShadingMode). */
+void tileDestroy(tileBinner *binner) {
+  int tileNum = binner->tileCols * binner->tileRows, i;
+  pthread_mutex_lock(&binner->lock);
+  binner->quit = 1;
+  pthread_cond_broadcast(&binner->start);
+  pthread_mutex_unlock(&binner->lock);
+  for (i = 0; i < binner->threadNum; i += 1) {
+    pthread_join(binner->workers[i].thread, NULL);
+    free(binner->workers[i].tex);
+    free(binner->workers[i].scratch);
+  }
+  for (i = 0; i < tileNum; i += 1)
+    free(binner->bins[i]);
+  free(binner->bins);
+  free(binner->binNum);
+  free(binner->visTri);
+  free(binner->workers);
+  free(binner->drawUnif);
+  free(binner->drawTex);
+  free(binner->triSetups);
+  free(binner->triDraw);
+  pthread_mutex_destroy(&binner->lock);
+  pthread_cond_destroy(&binner->start);
+  pthread_cond_destroy(&binner->done);
+  if (binner->ren->binner == binner) {
+    binner->ren->binner = NULL;
+    binner->ren->shadingMode = renIMMEDIATE;
+  }
+}
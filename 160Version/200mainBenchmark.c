@@ -0,0 +1,242 @@
+/*
+@ Author:  Sabastian Mugazambi & Tore Banta
+@ Date: 01/07/2017
+This file is a microbenchmark for the span kernels in 110triangle.c. It draws
+a stack of large triangles, once back to front (every pixel passes the depth
+test and is shaded) and once front to back (almost every pixel fails the depth
+test), with each kernel that this machine supports and each depth buffer format
+and layout, and prints pixels/sec. Those rates include everything that the
+rasterizer does per pixel. So, in the linear layout, each kernel is also timed
+alone, testing coverage and depth without drawing anything. It also checks that,
+for each format, every kernel and layout leaves exactly the same depth buffer
+behind, and that every kernel gives the same masks.
+No window is opened, and the pixel library is not needed.
+Run the script like so:
+clang -O2 200mainBenchmark.c -lm -lpthread
+./a.out
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "100vector.c"
+#include "131matrix.c"
+#include "040texture.c"
+#include "110depth.c"
+#ifndef fbHEADLESS
+#define fbHEADLESS
+#endif
+#include "120framebuffer.c"
+#include "125heatmap.c"
+
+#define renVARYDIMBOUND 16
+
+#include "130renderer.c"
+
+#define renVARYX 0
+#define renVARYY 1
+#define renVARYZ 2
+#define renVARYW 3
+#define renVARYS 4
+#define renVARYT 5
+
+#define WIDTH 512
+#define HEIGHT 512
+#define LAYERNUM 16
+#define REPNUM 10
+/* The span kernels alone are timed over this many screens. */
+#define KERNELREPNUM 100
+
+int shadedNum = 0;
+
+/* A shader that costs next to nothing, so that the rasterizer is what gets
+timed. */
+void colorPixel(renRenderer *ren, vecReal unif[], texTexture *tex[],
+                vecReal vary[], vecReal rgbz[]) {
+  shadedNum += 1;
+  rgbz[0] = vary[renVARYS];
+  rgbz[1] = vary[renVARYT];
+  rgbz[2] = 0.5;
+  rgbz[3] = vary[renVARYZ];
+}
+
+#include "110triangle.c"
+#include "190tiling.c"
+
+renRenderer ren;
+depthBuffer dep;
+fbFramebuffer fb;
+
+/* Sets the vertex to screen position (x, y) with depth z. The remaining
+varyings are filler, as many as 180mainFog.c uses. */
+void setVertex(vecReal vary[], double x, double y, double z) {
+  int k;
+  for (k = 0; k < ren.varyDim; k += 1)
+    vary[k] = 0.1 * k;
+  vary[renVARYX] = x;
+  vary[renVARYY] = y;
+  vary[renVARYZ] = z;
+  vary[renVARYW] = 1.0;
+  vary[renVARYS] = x / WIDTH;
+  vary[renVARYT] = y / HEIGHT;
+}
+
+/* Draws LAYERNUM layers, each two triangles that overhang the screen a
+little. If backToFront, then each layer is in front of the previous one. */
+void drawLayers(int backToFront) {
+  vecReal a[renVARYDIMBOUND], b[renVARYDIMBOUND], c[renVARYDIMBOUND],
+      d[renVARYDIMBOUND];
+  triTarget screen = {0, WIDTH - 1, 0, HEIGHT - 1, NULL, 0, NULL};
+  triSetup setup;
+  int layer;
+  for (layer = 0; layer < LAYERNUM; layer += 1) {
+    /* Keep Z inside [-1, 1], where every depth format has its precision. */
+    double step = 1.0 / (LAYERNUM + 1);
+    double z = (backToFront ? layer : LAYERNUM - layer) * step - 0.5;
+    double shift = 0.37 * layer;
+    setVertex(a, -3.0 + shift, -2.0, z);
+    setVertex(b, WIDTH + 2.0, -3.0 + shift, z + 0.5 * step);
+    setVertex(c, WIDTH + 3.0 - shift, HEIGHT + 2.0, z);
+    setVertex(d, -2.0, HEIGHT + 3.0 - shift, z - 0.5 * step);
+    if (triSetUp(&ren, a, b, c, &setup) == 0)
+      hiddenRender(&ren, NULL, NULL, &setup, &screen);
+    if (triSetUp(&ren, a, c, d, &setup) == 0)
+      hiddenRender(&ren, NULL, NULL, &setup, &screen);
+  }
+}
+
+/* Times the span kernel alone, with nothing else of the rasterizer: no depth
+tiles, no depth writes and no shading. Every row of the screen is tested
+against one triangle that covers about half of it, triCHUNK pixels at a time.
+If pass, then the depth buffer is clear, and every covered pixel passes;
+otherwise it is full of nearer Z-values, and they all fail. Only the linear
+layout is used, since in it a whole chunk is contiguous. Returns the rate in
+pixels tested per second, and places a checksum of the masks in checksum. */
+double timeKernel(int pass, double *checksum) {
+  vecReal a[renVARYDIMBOUND], b[renVARYDIMBOUND], c[renVARYDIMBOUND];
+  triSetup setup;
+  triRow row;
+  int i0, j, rep;
+  long testedNum = 0;
+  double sum = 0.0;
+  setVertex(a, -3.0, -2.0, 0.0);
+  setVertex(b, WIDTH + 2.0, -3.0, 0.25);
+  setVertex(c, WIDTH + 3.0, HEIGHT + 2.0, -0.25);
+  if (triSetUp(&ren, a, b, c, &setup) != 0)
+    return 0.0;
+  depthClearZs(&dep, pass ? -1000.0 : 0.9);
+  /* Make the lazy clear happen before the timing starts. */
+  for (j = 0; j < HEIGHT; j += 1)
+    depthTouchRow(&dep, 0, WIDTH - 1, j);
+  row.alphaDx = setup.alpha.dx;
+  row.pDx = setup.p.dx;
+  row.qDx = setup.q.dx;
+  row.zDx = setup.z.dx;
+  clock_t start = clock();
+  for (rep = 0; rep < KERNELREPNUM; rep += 1)
+    for (j = 0; j < HEIGHT; j += 1) {
+      double rows = j - setup.yLow;
+      row.alpha = setup.alpha.corner + rows * setup.alpha.dy;
+      row.p = setup.p.corner + rows * setup.p.dy;
+      row.q = setup.q.corner + rows * setup.q.dy;
+      row.z = setup.z.corner + rows * setup.z.dy;
+      for (i0 = 0; i0 < WIDTH; i0 += triCHUNK) {
+        int n = (WIDTH - i0 < triCHUNK) ? WIDTH - i0 : triCHUNK;
+        triMask covered, passed;
+        passed = triSpan[dep.format](&row, &dep, depthIndex(&dep, i0, j),
+                                     i0 - setup.xLow, n, &covered);
+        if (rep == 0)
+          sum += (double)(covered % 1000003) + (double)(passed % 999983);
+        testedNum += n;
+      }
+    }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  *checksum = sum;
+  return testedNum / seconds;
+}
+
+/* Returns a checksum of the depth buffer. */
+double depthChecksum(void) {
+  double sum = 0.0;
+  int i, j;
+  for (j = 0; j < HEIGHT; j += 1)
+    for (i = 0; i < WIDTH; i += 1)
+      sum += depthGetZ(&dep, i, j) * (1.0 + ((i + WIDTH * j) % 7));
+  return sum;
+}
+
+int main(void) {
+  char *names[3] = {"scalar", "SSE2", "AVX2"};
+  char *formatNames[3] = {"double", "float", "fixed24"};
+  char *layoutNames[2] = {"linear", "tiled"};
+  int format, layout, kernel, backToFront, pass, rep;
+  double reference[3][2], kernelReference[2];
+  long coveredNum;
+
+  if (fbInitialize(&fb, WIDTH, HEIGHT, fbRGBA8, 1) != 0)
+    return 1;
+  ren.varyDim = 15;
+  ren.colorPixel = colorPixel;
+  ren.depth = &dep;
+  ren.framebuffer = &fb;
+  ren.binner = NULL;
+  ren.varyMask = 0;
+
+  /* Back to front, every covered pixel is shaded, so that counts them. */
+  if (depthInitialize(&dep, WIDTH, HEIGHT, depthDOUBLE, depthLINEAR,
+                      1) != 0)
+    return 1;
+  triSetKernel(triSCALAR);
+  depthClearZs(&dep, -1000.0);
+  shadedNum = 0;
+  drawLayers(1);
+  coveredNum = shadedNum;
+  depthDestroy(&dep);
+  printf("%d layers, %ld covered pixels per pass\n", LAYERNUM, coveredNum);
+
+  for (format = depthDOUBLE; format <= depthFIXED24; format += 1)
+    for (layout = depthLINEAR; layout <= depthTILED; layout += 1) {
+      if (depthInitialize(&dep, WIDTH, HEIGHT, format, layout, 1) != 0)
+        return 1;
+      for (kernel = triSCALAR; kernel <= triAVX2; kernel += 1) {
+        if (triSetKernel(kernel) != 0) {
+          printf("%-6s  not supported on this machine\n", names[kernel]);
+          continue;
+        }
+        for (pass = 1; pass >= 0 && layout == depthLINEAR; pass -= 1) {
+          double checksum, rate = timeKernel(pass, &checksum);
+          if (kernel == triSCALAR)
+            kernelReference[pass] = checksum;
+          printf("%-7s  %-6s  %-6s  %-13s  %8.1f Mpixels/sec  %s\n",
+                 formatNames[format], layoutNames[layout], names[kernel],
+                 pass ? "kernel, pass" : "kernel, fail", rate / 1.0e6,
+                 (checksum == kernelReference[pass]) ? "" : "MASK MISMATCH");
+        }
+        for (backToFront = 1; backToFront >= 0; backToFront -= 1) {
+          /* Only the drawing is timed, not the clearing, which is free. */
+          clock_t ticks = 0;
+          for (rep = 0; rep < REPNUM; rep += 1) {
+            depthClearZs(&dep, -1000.0);
+            clock_t start = clock();
+            drawLayers(backToFront);
+            ticks += clock() - start;
+          }
+          double seconds = (double)ticks / CLOCKS_PER_SEC;
+          double checksum = depthChecksum();
+          if (kernel == triSCALAR && layout == depthLINEAR)
+            reference[format][backToFront] = checksum;
+          printf("%-7s  %-6s  %-6s  %-13s  %8.1f Mpixels/sec  %s\n",
+                 formatNames[format], layoutNames[layout], names[kernel],
+                 backToFront ? "back-to-front" : "front-to-back",
+                 REPNUM * coveredNum / seconds / 1.0e6,
+                 (checksum == reference[format][backToFront]) ?
+                 "" : "DEPTH MISMATCH");
+        }
+      }
+      depthDestroy(&dep);
+    }
+  fbDestroy(&fb);
+  return 0;
+}
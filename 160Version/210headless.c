@@ -0,0 +1,336 @@
+/*
+@ Author:  Sabastian Mugazambi & Tore Banta
+@ Date: 01/07/2017
+This file is a headless driver for the sample programs. Instead of opening a
+window, it flies the camera along a scripted path, renders a fixed number of
+frames, times each one, and optionally writes the frames to files and compares
+them against golden images. Since nothing depends on the clock or the keyboard,
+two runs draw exactly the same frames, so the driver can check rendering and
+its performance on a machine without a GPU or a display. A sample program
+becomes headless when it is compiled with fbHEADLESS defined, like so:
+clang -O2 -DfbHEADLESS 180mainFog.c -lm -lpthread
+./a.out --frames 120 --path orbit --out frames --golden golden
+Run it with --help to see all of the options.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Camera paths. Each starts at the program's initial camera and is a function
+of the frame number only. */
+#define headlessSTILL 0   /* the initial camera on every frame */
+#define headlessORBIT 1   /* once around the target */
+#define headlessDOLLY 2   /* halfway in toward the target */
+
+/* In heat map mode, counts above this are painted white. */
+#define headlessHEATMAX 8
+
+typedef struct headlessOptions headlessOptions;
+struct headlessOptions {
+  int frameNum, warmupNum, path;
+  const char *outDir;       /* where to write frames, or NULL */
+  const char *format;       /* "ppm" or "png" */
+  const char *goldenDir;    /* where the golden images are, or NULL */
+  int update;               /* write goldens instead of comparing with them */
+  int tolerance;            /* largest channel difference that still matches */
+  int stats;                /* renSTATSTEXT, renSTATSJSON or -1 for none */
+  int heat;                 /* heatTESTED etc., or -1 for the picture */
+};
+
+/*** Private ***/
+
+void headlessUsage(const char *program) {
+  fprintf(stderr,
+      "usage: %s [options]\n"
+      "  --frames N        frames to render and time (default 60)\n"
+      "  --warmup N        untimed frames before the first (default 2)\n"
+      "  --path P          camera path: still, orbit or dolly (default orbit)\n"
+      "  --out DIR         write each frame to DIR/frameNNNN.EXT\n"
+      "  --format EXT      ppm or png (default ppm)\n"
+      "  --golden DIR      compare each frame with DIR/frameNNNN.EXT\n"
+      "  --update          write the golden images instead of comparing\n"
+      "  --tolerance T     allowed difference per channel, 0-255 (default 2)\n"
+      "  --stats F         print the timed frames' statistics as text or json\n"
+      "  --heatmap K       in place of the picture, paint how many times each\n"
+      "                    pixel was tested, shaded or overwritten\n",
+      program);
+}
+
+/* Parses the command line into options. Returns 0 if no error occurred. */
+int headlessParse(int argc, char *argv[], headlessOptions *opts) {
+  int i;
+  opts->frameNum = 60;
+  opts->warmupNum = 2;
+  opts->path = headlessORBIT;
+  opts->outDir = NULL;
+  opts->format = "ppm";
+  opts->goldenDir = NULL;
+  opts->update = 0;
+  opts->tolerance = 2;
+  opts->stats = -1;
+  opts->heat = -1;
+  for (i = 1; i < argc; i += 1) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--update") == 0) {
+      opts->update = 1;
+      continue;
+    }
+    if (value == NULL) {
+      headlessUsage(argv[0]);
+      return 1;
+    }
+    if (strcmp(arg, "--frames") == 0)
+      opts->frameNum = atoi(value);
+    else if (strcmp(arg, "--warmup") == 0)
+      opts->warmupNum = atoi(value);
+    else if (strcmp(arg, "--path") == 0) {
+      if (strcmp(value, "still") == 0)
+        opts->path = headlessSTILL;
+      else if (strcmp(value, "orbit") == 0)
+        opts->path = headlessORBIT;
+      else if (strcmp(value, "dolly") == 0)
+        opts->path = headlessDOLLY;
+      else {
+        fprintf(stderr, "error: headlessParse: unknown path %s.\n", value);
+        return 1;
+      }
+    } else if (strcmp(arg, "--out") == 0)
+      opts->outDir = value;
+    else if (strcmp(arg, "--format") == 0) {
+      if (strcmp(value, "ppm") != 0 && strcmp(value, "png") != 0) {
+        fprintf(stderr, "error: headlessParse: unknown format %s.\n", value);
+        return 1;
+      }
+      opts->format = value;
+    } else if (strcmp(arg, "--golden") == 0)
+      opts->goldenDir = value;
+    else if (strcmp(arg, "--tolerance") == 0)
+      opts->tolerance = atoi(value);
+    else if (strcmp(arg, "--stats") == 0) {
+      if (strcmp(value, "text") == 0)
+        opts->stats = renSTATSTEXT;
+      else if (strcmp(value, "json") == 0)
+        opts->stats = renSTATSJSON;
+      else {
+        fprintf(stderr, "error: headlessParse: unknown stats format %s.\n",
+                value);
+        return 1;
+      }
+    } else if (strcmp(arg, "--heatmap") == 0) {
+      if (strcmp(value, "tested") == 0)
+        opts->heat = heatTESTED;
+      else if (strcmp(value, "shaded") == 0)
+        opts->heat = heatSHADED;
+      else if (strcmp(value, "overwritten") == 0)
+        opts->heat = heatOVERWRITTEN;
+      else {
+        fprintf(stderr, "error: headlessParse: unknown heat map %s.\n", value);
+        return 1;
+      }
+    } else {
+      headlessUsage(argv[0]);
+      return 1;
+    }
+    i += 1;
+  }
+  if (opts->frameNum < 1 || opts->warmupNum < 0) {
+    fprintf(stderr, "error: headlessParse: bad frame counts.\n");
+    return 1;
+  }
+  if (opts->update && opts->goldenDir == NULL) {
+    fprintf(stderr, "error: headlessParse: --update needs --golden.\n");
+    return 1;
+  }
+  return 0;
+}
+
+/* Places in cam the camera (phi, theta, rho) of the given frame of the path,
+which starts at start. */
+void headlessCamera(int path, const vecReal start[3], int frame, int frameNum,
+                    vecReal cam[3]) {
+  double t = (double)frame / frameNum;
+  cam[0] = start[0];
+  cam[1] = start[1];
+  cam[2] = start[2];
+  if (path == headlessORBIT)
+    cam[1] = start[1] + 2.0 * M_PI * t;
+  else if (path == headlessDOLLY)
+    cam[2] = start[2] * (1.0 - 0.5 * t);
+}
+
+/* Writes the framebuffer to dir/frameNNNN.format. Returns 0 if no error
+occurred. */
+int headlessWrite(fbFramebuffer *fb, const char *dir, const char *format,
+                  int frame) {
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/frame%04d.%s", dir, frame, format);
+  if (strcmp(format, "png") == 0)
+    return fbWritePNG(fb, path);
+  return fbWritePPM(fb, path);
+}
+
+/* Compares the framebuffer with the golden image dir/frameNNNN.format, which
+stb_image reads whether it is a PPM or a PNG. Returns the number of pixels that
+differ by more than tolerance in some channel, or -1 if the golden image is
+missing or has the wrong size. Places the largest difference in maxDiff. */
+int headlessCompare(fbFramebuffer *fb, const char *dir, const char *format,
+                    int frame, int tolerance, int *maxDiff) {
+  char path[1024];
+  int width, height, texelDim, i, j, k, diffNum = 0;
+  double rgb[3];
+  snprintf(path, sizeof(path), "%s/frame%04d.%s", dir, frame, format);
+  unsigned char *golden = stbi_load(path, &width, &height, &texelDim, 3);
+  *maxDiff = 0;
+  if (golden == NULL) {
+    fprintf(stderr, "error: headlessCompare: could not read %s.\n", path);
+    return -1;
+  }
+  if (width != fb->width || height != fb->height) {
+    fprintf(stderr, "error: headlessCompare: %s is %d x %d.\n", path, width,
+            height);
+    stbi_image_free(golden);
+    return -1;
+  }
+  /* The golden image's first row is the framebuffer's last. */
+  for (j = 0; j < height; j += 1)
+    for (i = 0; i < width; i += 1) {
+      int worst = 0;
+      fbGetRGB(fb, i, height - 1 - j, rgb);
+      for (k = 0; k < 3; k += 1) {
+        int diff = abs(fbByte(rgb[k]) - golden[3 * (i + width * j) + k]);
+        worst = (diff > worst) ? diff : worst;
+      }
+      if (worst > tolerance)
+        diffNum += 1;
+      if (worst > *maxDiff)
+        *maxDiff = worst;
+    }
+  stbi_image_free(golden);
+  return diffNum;
+}
+
+int headlessCompareDoubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* Returns the pth percentile of the n sorted values, by the nearest rank. */
+double headlessPercentile(const double sorted[], int n, double p) {
+  int rank = (int)ceil(p / 100.0 * n);
+  return sorted[(rank < 1) ? 0 : rank - 1];
+}
+
+/*** Public ***/
+
+/*
+@function headlessRun
+@param (int argc, char *argv[], renRenderer *ren, fbFramebuffer *fb,
+vecReal target[3], vecReal cam[3], void (*draw)(void)), where cam is the
+program's camera (phi, theta, rho) about target, and draw renders one frame
+into fb from the renderer's current camera.
+@purpose Runs the program headless, as directed by the command line (see
+headlessUsage). Each frame, cam is set from the path and handed to renLookAt,
+and then draw is called and timed. Writing and comparing the frames are not
+timed. With --stats, the renderer's statistics are kept and added up over the
+timed frames. With --heatmap, each frame is replaced by a false-color heat map
+(see 125heatmap.c) before it is written or compared, and the last frame's heat
+map is summarized. Prints the timing percentiles and the comparisons, and
+returns the exit status: 0 if everything matched, 1 on an error, or 2 if some
+frame did not match its golden image.
+*/
+int headlessRun(int argc, char *argv[], renRenderer *ren, fbFramebuffer *fb,
+                vecReal target[3], vecReal cam[3], void (*draw)(void)) {
+  headlessOptions opts;
+  heatMap heat;
+  renStats stats = {0};
+  vecReal start[3] = {cam[0], cam[1], cam[2]};
+  int frame, status = 0, mismatchNum = 0;
+  if (headlessParse(argc, argv, &opts) != 0)
+    return 1;
+  double *times = (double *)malloc(opts.frameNum * sizeof(double));
+  if (times == NULL)
+    return 1;
+  if (opts.stats >= 0)
+    renSetStats(ren, 1);
+  if (opts.heat >= 0) {
+    if (heatInitialize(&heat, fb->width, fb->height) != 0) {
+      free(times);
+      return 1;
+    }
+    renSetHeatMap(ren, &heat);
+  }
+
+  /* The first frames fault in the buffers and warm the caches. */
+  headlessCamera(opts.path, start, 0, opts.frameNum, cam);
+  renLookAt(ren, target, cam[2], cam[0], cam[1]);
+  for (frame = 0; frame < opts.warmupNum; frame += 1)
+    draw();
+
+  for (frame = 0; frame < opts.frameNum && status != 1; frame += 1) {
+    headlessCamera(opts.path, start, frame, opts.frameNum, cam);
+    renLookAt(ren, target, cam[2], cam[0], cam[1]);
+    renResetStats(ren);
+    if (opts.heat >= 0)
+      heatClear(&heat);
+    double before = renNow();
+    draw();
+    times[frame] = renNow() - before;
+    renAddStats(&stats, &ren->stats);
+    if (opts.heat >= 0)
+      heatRender(&heat, fb, opts.heat, headlessHEATMAX);
+    if (opts.outDir != NULL &&
+        headlessWrite(fb, opts.outDir, opts.format, frame) != 0)
+      status = 1;
+    if (opts.goldenDir != NULL && opts.update) {
+      if (headlessWrite(fb, opts.goldenDir, opts.format, frame) != 0)
+        status = 1;
+    } else if (opts.goldenDir != NULL) {
+      int maxDiff;
+      int diffNum = headlessCompare(fb, opts.goldenDir, opts.format, frame,
+                                    opts.tolerance, &maxDiff);
+      if (diffNum < 0)
+        status = 1;
+      else if (diffNum > 0) {
+        printf("frame %d: %d pixels differ by more than %d (at most %d)\n",
+               frame, diffNum, opts.tolerance, maxDiff);
+        mismatchNum += 1;
+      }
+    }
+  }
+  if (opts.heat >= 0) {
+    if (status != 1)
+      heatPrintSummary(&heat, opts.heat, stdout);
+    renSetHeatMap(ren, NULL);
+    heatDestroy(&heat);
+  }
+  if (status == 1) {
+    free(times);
+    return 1;
+  }
+
+  double sum = 0.0;
+  for (frame = 0; frame < opts.frameNum; frame += 1)
+    sum += times[frame];
+  qsort(times, opts.frameNum, sizeof(double), headlessCompareDoubles);
+  printf("%d frames  mean %.2f ms  p50 %.2f ms  p95 %.2f ms  p99 %.2f ms  "
+         "max %.2f ms\n", opts.frameNum, 1000.0 * sum / opts.frameNum,
+         1000.0 * headlessPercentile(times, opts.frameNum, 50.0),
+         1000.0 * headlessPercentile(times, opts.frameNum, 95.0),
+         1000.0 * headlessPercentile(times, opts.frameNum, 99.0),
+         1000.0 * times[opts.frameNum - 1]);
+  free(times);
+  if (opts.stats >= 0)
+    renPrintStats(&stats, stdout, opts.stats);
+  if (opts.goldenDir != NULL && opts.update)
+    printf("wrote %d golden images to %s\n", opts.frameNum, opts.goldenDir);
+  else if (opts.goldenDir != NULL) {
+    printf("%d of %d frames match the golden images\n",
+           opts.frameNum - mismatchNum, opts.frameNum);
+    if (mismatchNum > 0)
+      return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*
+@ Author:  Sabastian Mugazambi & Tore Banta
+@ Date: 01/07/2017
+This file has a dynamic resolution controller. The scene is drawn into the
+lower left part of the framebuffer (see renSetViewportSize), at a scale of the
+window's size that the controller adjusts from frame to frame, to hold the
+frame time near a target. resUpscale then stretches that part over the whole
+window with bilinear filtering. Heavy frames thus cost fewer pixels, instead of
+dropping the frame rate. 580Version/595resolution.c has the same controller
+for the OpenGL path.
+*/
+
+#include <math.h>
+
+/* The frame time is averaged with this weight on each new frame. */
+#define resSMOOTHING 0.2
+/* Averages within this fraction of the target are on target, so that the
+scale does not hunt back and forth. */
+#define resDEADBAND 0.1
+/* The scale changes by at most this fraction per change, and then waits
+resSETTLE frames for the average to catch up before changing again. */
+#define resSTEP 0.1
+#define resSETTLE 4
+/* Render sizes are multiples of this many pixels, one depth tile. */
+#define resALIGN 8
+
+/* Feel free to read the struct's members, but don't write them. */
+typedef struct resController resController;
+struct resController {
+  int width, height;              /* the window's */
+  int renderWidth, renderHeight;  /* what to draw this frame */
+  double scale, minScale, maxScale;
+  double target;                  /* seconds per frame */
+  double average;                 /* smoothed seconds per frame, or 0.0 */
+  int settle;                     /* frames to wait before the next change */
+};
+
+/* Rounds width * scale to a multiple of resALIGN, but at least resALIGN and at
+most width. */
+int resAlign(int width, double scale) {
+  int aligned = (int)(width * scale / resALIGN + 0.5) * resALIGN;
+  if (aligned < resALIGN)
+    aligned = resALIGN;
+  return (aligned > width) ? width : aligned;
+}
+
+/* Initializes the controller for a window of the given size, to hold frames
+near target seconds, by scaling each side of the window between minScale and
+maxScale (at most 1.0). It starts at maxScale. */
+void resInitialize(resController *res, int width, int height, double target,
+                   double minScale, double maxScale) {
+  res->width = width;
+  res->height = height;
+  res->target = target;
+  res->minScale = minScale;
+  res->maxScale = (maxScale > 1.0) ? 1.0 : maxScale;
+  res->scale = res->maxScale;
+  res->average = 0.0;
+  res->settle = 0;
+  res->renderWidth = resAlign(width, res->scale);
+  res->renderHeight = resAlign(height, res->scale);
+}
+
+/* Feeds the controller the time, in seconds, that the latest frame took, and
+works out the size at which to draw the next one. A frame's cost is roughly
+proportional to its pixels, which go as the square of the scale, so the scale
+moves by the square root of the ratio of the target to the average. Returns 1
+if the size changed and 0 if not. */
+int resUpdate(resController *res, double frameTime) {
+  int width = res->renderWidth, height = res->renderHeight;
+  if (res->average == 0.0)
+    res->average = frameTime;
+  else
+    res->average += resSMOOTHING * (frameTime - res->average);
+  if (res->settle > 0) {
+    res->settle -= 1;
+    return 0;
+  }
+  double ratio = res->target / res->average;
+  if (ratio > 1.0 - resDEADBAND && ratio < 1.0 + resDEADBAND)
+    return 0;
+  double scale = res->scale * sqrt(ratio);
+  scale = fmax(res->scale * (1.0 - resSTEP),
+               fmin(res->scale * (1.0 + resSTEP), scale));
+  res->scale = fmax(res->minScale, fmin(res->maxScale, scale));
+  res->renderWidth = resAlign(res->width, res->scale);
+  res->renderHeight = resAlign(res->height, res->scale);
+  if (res->renderWidth == width && res->renderHeight == height)
+    return 0;
+  res->settle = resSETTLE;
+  return 1;
+}
+
+/* Sets the window's size, for instance after the window is resized, and
+resizes the rendering to match at the current scale. */
+void resSetWindowSize(resController *res, int width, int height) {
+  res->width = width;
+  res->height = height;
+  res->renderWidth = resAlign(width, res->scale);
+  res->renderHeight = resAlign(height, res->scale);
+}
+
+/* Stretches the lower left renderWidth x renderHeight pixels of src, which
+must be resolved (see fbResolve), over the whole of dst, which is the window's
+size, with bilinear filtering. Each pixel of dst samples src at the point that
+its center maps to, clamped to the edge. */
+void resUpscale(const resController *res, fbFramebuffer *src,
+                fbFramebuffer *dst) {
+  double scaleX = (double)res->renderWidth / dst->width;
+  double scaleY = (double)res->renderHeight / dst->height;
+  double rgbs[4][3], rgb[3];
+  int i, j, k;
+  for (j = 0; j < dst->height; j += 1) {
+    double y = fmax(0.0, fmin(res->renderHeight - 1.0,
+                              (j + 0.5) * scaleY - 0.5));
+    int y0 = (int)y, y1 = (y0 + 1 < res->renderHeight) ? y0 + 1 : y0;
+    double fy = y - y0;
+    for (i = 0; i < dst->width; i += 1) {
+      double x = fmax(0.0, fmin(res->renderWidth - 1.0,
+                                (i + 0.5) * scaleX - 0.5));
+      int x0 = (int)x, x1 = (x0 + 1 < res->renderWidth) ? x0 + 1 : x0;
+      double fx = x - x0;
+      fbGetRGB(src, x0, y0, rgbs[0]);
+      fbGetRGB(src, x1, y0, rgbs[1]);
+      fbGetRGB(src, x0, y1, rgbs[2]);
+      fbGetRGB(src, x1, y1, rgbs[3]);
+      for (k = 0; k < 3; k += 1)
+        rgb[k] = (1.0 - fy) * ((1.0 - fx) * rgbs[0][k] + fx * rgbs[1][k]) +
+                 fy * ((1.0 - fx) * rgbs[2][k] + fx * rgbs[3][k]);
+      fbSetRGB(dst, i, j, rgb[0], rgb[1], rgb[2]);
+    }
+  }
+}
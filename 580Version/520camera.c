@@ -13,15 +13,15 @@ except through accessor functions. */
 typedef struct camCamera camCamera;
 struct camCamera {
 	/* Low-level interface. */
-	GLdouble rotation[3][3];
-	GLdouble translation[3];
-	GLdouble projection[6];
+	vecReal rotation[3][3];
+	vecReal translation[3];
+	vecReal projection[6];
 	GLuint projectionType;
 	/* High-level interface. */
-	GLdouble fovy, ratio, width, height;
-	GLdouble distance;
-	GLdouble phi, theta;
-	GLdouble target[3];
+	vecReal fovy, ratio, width, height;
+	vecReal distance;
+	vecReal phi, theta;
+	vecReal target[3];
 };
 
 
@@ -38,12 +38,12 @@ struct camCamera {
 #define camPROJN 5
 
 /* Sets the camera's rotation. */
-void camSetRotation(camCamera *cam, GLdouble rot[3][3]) {
-	vecCopy(9, (GLdouble *)rot, (GLdouble *)(cam->rotation));
+void camSetRotation(camCamera *cam, vecReal rot[3][3]) {
+	vecCopy(9, (vecReal *)rot, (vecReal *)(cam->rotation));
 }
 
 /* Sets the camera's translation. */
-void camSetTranslation(camCamera *cam, GLdouble transl[3]) {
+void camSetTranslation(camCamera *cam, vecReal transl[3]) {
 	vecCopy(3, transl, cam->translation);
 }
 
@@ -53,12 +53,12 @@ void camSetProjectionType(camCamera *cam, GLuint projType) {
 }
 
 /* Sets all six projection parameters. */
-void camSetProjection(camCamera *cam, GLdouble proj[6]) {
+void camSetProjection(camCamera *cam, vecReal proj[6]) {
 	vecCopy(6, proj, cam->projection);
 }
 
 /* Sets one of the six projection parameters. */
-void camSetOneProjection(camCamera *cam, GLuint i, GLdouble value) {
+void camSetOneProjection(camCamera *cam, GLuint i, vecReal value) {
 	cam->projection[i] = value;
 }
 
@@ -68,9 +68,9 @@ itself is displaced from that target by a distance rho, in the direction
 specified by the spherical coordinates phi and theta (as in vec3Spherical).
 Under normal use, where 0 < phi < pi, the camera's up-direction is world-up,
 or as close to it as possible. */
-void camLookAt(camCamera *cam, GLdouble target[3], GLdouble rho, GLdouble phi,
-		GLdouble theta) {
-	GLdouble z[3], y[3], yStd[3] = {0.0, 1.0, 0.0}, zStd[3] = {0.0, 0.0, 1.0};
+void camLookAt(camCamera *cam, vecReal target[3], vecReal rho, vecReal phi,
+		vecReal theta) {
+	vecReal z[3], y[3], yStd[3] = {0.0, 1.0, 0.0}, zStd[3] = {0.0, 0.0, 1.0};
 	vec3Spherical(1.0, phi, theta, z);
 	vec3Spherical(1.0, M_PI / 2.0 - phi, theta + M_PI, y);
 	mat33BasisRotation(yStd, zStd, y, z, cam->rotation);
@@ -84,10 +84,10 @@ From that position, the camera's sight direction is described by the spherical
 coordinates phi and theta (as in vec3Spherical). Under normal use, where
 0 < phi < pi, the camera's up-direction is world-up, or as close to it as
 possible. */
-void camLookFrom(camCamera *cam, GLdouble position[3], GLdouble phi,
-		GLdouble theta) {
-	GLdouble negZ[3], y[3];
-	GLdouble yStd[3] = {0.0, 1.0, 0.0}, negZStd[3] = {0.0, 0.0, -1.0};
+void camLookFrom(camCamera *cam, vecReal position[3], vecReal phi,
+		vecReal theta) {
+	vecReal negZ[3], y[3];
+	vecReal yStd[3] = {0.0, 1.0, 0.0}, negZStd[3] = {0.0, 0.0, -1.0};
 	vec3Spherical(1.0, phi, theta, negZ);
 	vec3Spherical(1.0, M_PI / 2.0 - phi, theta + M_PI, y);
 	mat33BasisRotation(yStd, negZStd, y, negZ, cam->rotation);
@@ -104,8 +104,8 @@ Reasonable values are fovy = M_PI / 6.0, focal = 10.0, and ratio = 10.0, so
 that far = -100.0 and near = -1.0. For orthographic projection, the projection
 parameters are set to produce the orthographic projection that, at the focal
 plane, is most similar to the perspective projection just described. */
-void camSetFrustum(camCamera *cam, GLuint projType, GLdouble fovy,
-		GLdouble focal, GLdouble ratio, GLdouble width, GLdouble height) {
+void camSetFrustum(camCamera *cam, GLuint projType, vecReal fovy,
+		vecReal focal, vecReal ratio, vecReal width, vecReal height) {
 	cam->projectionType = projType;
 	cam->projection[camPROJF] = -focal * ratio;
 	cam->projection[camPROJN] = -focal / ratio;
@@ -123,10 +123,9 @@ void camSetFrustum(camCamera *cam, GLuint projType, GLdouble fovy,
 loads that location with the camera's inverse isometry and projection --- that
 is, P C^-1, in the notation of our software graphics engine. */
 void camRender(camCamera *cam, GLint viewingLoc) {
-	GLdouble C_Inv_M[4][4];
-	GLdouble P[4][4];
-	GLdouble viewing[4][4];
-	GLfloat GLview[4][4];
+	vecReal C_Inv_M[4][4];
+	vecReal P[4][4];
+	vecReal viewing[4][4];
 
 	///our mat33AngleAxisRotation is broken
 
@@ -143,17 +142,16 @@ void camRender(camCamera *cam, GLint viewingLoc) {
                     cam->projection[camPROJT],cam->projection[camPROJF],cam->projection[camPROJN],P);
     mat444Multiply(P,C_Inv_M,viewing);
   }
-	mat44OpenGL(viewing, GLview);
-	glUniformMatrix4fv(viewingLoc, 1, GL_FALSE, (GLfloat *)GLview);
+	mat44Uniform(viewingLoc, viewing);
 }
 
 
 
 /*** High-level interface ***/
 
-void camSetControls(camCamera *cam, GLuint projType, GLdouble fovy,
-		GLdouble ratio, GLdouble width, GLdouble height, GLdouble distance,
-		GLdouble phi, GLdouble theta, GLdouble target[3]) {
+void camSetControls(camCamera *cam, GLuint projType, vecReal fovy,
+		vecReal ratio, vecReal width, vecReal height, vecReal distance,
+		vecReal phi, vecReal theta, vecReal target[3]) {
 	cam->fovy = fovy;
 	cam->ratio = ratio;
 	cam->width = width;
@@ -177,43 +175,43 @@ void camSwitchProjectionType(camCamera *cam) {
 		cam->ratio, cam->width, cam->height);
 }
 
-void camAddFovy(camCamera *cam, GLdouble delta) {
+void camAddFovy(camCamera *cam, vecReal delta) {
 	cam->fovy += delta;
 	camSetFrustum(cam, cam->projectionType, cam->fovy, cam->distance,
 		cam->ratio, cam->width, cam->height);
 }
 
-void camAddRatio(camCamera *cam, GLdouble delta) {
+void camAddRatio(camCamera *cam, vecReal delta) {
 	cam->ratio += delta;
 	camSetFrustum(cam, cam->projectionType, cam->fovy, cam->distance,
 		cam->ratio, cam->width, cam->height);
 }
 
-void camSetWidthHeight(camCamera *cam, GLdouble width, GLdouble height) {
+void camSetWidthHeight(camCamera *cam, vecReal width, vecReal height) {
 	cam->width = width;
 	cam->height = height;
 	camSetFrustum(cam, cam->projectionType, cam->fovy, cam->distance,
 		cam->ratio, cam->width, cam->height);
 }
 
-void camAddDistance(camCamera *cam, GLdouble delta) {
+void camAddDistance(camCamera *cam, vecReal delta) {
 	cam->distance += delta;
 	camSetFrustum(cam, cam->projectionType, cam->fovy, cam->distance,
 		cam->ratio, cam->width, cam->height);
 	camLookAt(cam, cam->target, cam->distance, cam->phi, cam->theta);
 }
 
-void camAddPhi(camCamera *cam, GLdouble delta) {
+void camAddPhi(camCamera *cam, vecReal delta) {
 	cam->phi += delta;
 	camLookAt(cam, cam->target, cam->distance, cam->phi, cam->theta);
 }
 
-void camAddTheta(camCamera *cam, GLdouble delta) {
+void camAddTheta(camCamera *cam, vecReal delta) {
 	cam->theta += delta;
 	camLookAt(cam, cam->target, cam->distance, cam->phi, cam->theta);
 }
 
-void camSetTarget(camCamera *cam, GLdouble target[3]) {
+void camSetTarget(camCamera *cam, vecReal target[3]) {
 	vecCopy(3, target, cam->target);
 	camLookAt(cam, cam->target, cam->distance, cam->phi, cam->theta);
 }
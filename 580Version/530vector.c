@@ -4,12 +4,28 @@
 This file specifies the interfaces for various vector functions.
 */
 
+/*** Scalar type ***/
+
+/* The type of the numbers in every vector and matrix, and so in the vertices
+and uniforms that are built from them, as in 160Version/100vector.c. It is
+GLfloat, which is what OpenGL takes, so that vertices and uniforms go to it
+as they are, at half the size. Compile with -DvecDOUBLE to make it GLdouble,
+for checking the GLfloat build against. vecGLTYPE is the matching OpenGL type,
+for glVertexAttribPointer. */
+#ifdef vecDOUBLE
+typedef GLdouble vecReal;
+#define vecGLTYPE GL_DOUBLE
+#else
+typedef GLfloat vecReal;
+#define vecGLTYPE GL_FLOAT
+#endif
+
 /*** In general dimensions ***/
 
 /* Assumes that there are dim + 2 arguments, the last dim of which are
 GLdoubles.
 Sets the dim-dimensional vector v to those GLdoubles. */
-void vecSet(int dim, GLdouble v[], ...) {
+void vecSet(int dim, vecReal v[], ...) {
 
   va_list argumentPointer;
   va_start(argumentPointer, v);
@@ -20,7 +36,7 @@ void vecSet(int dim, GLdouble v[], ...) {
 }
 
 /* Copies the dim-dimensional vector v to the dim-dimensional vector copy. */
-void vecCopy(int dim, GLdouble v[], GLdouble copy[]) {
+void vecCopy(int dim, vecReal v[], vecReal copy[]) {
   for (int i = 0; i < dim; i++) {
     copy[i] = v[i];
   }
@@ -34,29 +50,29 @@ void vecPrintD(int dim, GLfloat v[]) {
 }
 
 /* Adds the dim-dimensional vectors v and w. */
-void vecAdd(int dim, GLdouble v[], GLdouble w[], GLdouble vPlusW[]) {
+void vecAdd(int dim, vecReal v[], vecReal w[], vecReal vPlusW[]) {
   for (int i = 0; i < dim; i++) {
     vPlusW[i] = v[i] + w[i];
   }
 }
 
 /* Subtracts the dim-dimensional vectors v and w. */
-void vecSubtract(int dim, GLdouble v[], GLdouble w[], GLdouble vMinusW[]) {
+void vecSubtract(int dim, vecReal v[], vecReal w[], vecReal vMinusW[]) {
   for (int i = 0; i < dim; i++) {
     vMinusW[i] = v[i] - w[i];
   }
 }
 
 /* Scales the dim-dimensional vector w by the number c. */
-void vecScale(int dim, GLdouble c, GLdouble w[], GLdouble cTimesW[]) {
+void vecScale(int dim, vecReal c, vecReal w[], vecReal cTimesW[]) {
   for (int i = 0; i < dim; i++) {
     cTimesW[i] = c * w[i];
   }
 }
 
 /* Returns the dot product of the dim-dimensional vectors v and w. */
-GLdouble vecDot(int dim, GLdouble v[], GLdouble w[]) {
-  GLdouble sum = 0.0;
+vecReal vecDot(int dim, vecReal v[], vecReal w[]) {
+  vecReal sum = 0.0;
   for (int i = 0; i < dim; i++) {
     sum += v[i] * w[i];
   }
@@ -64,17 +80,17 @@ GLdouble vecDot(int dim, GLdouble v[], GLdouble w[]) {
 }
 
 /* Returns the length of the dim-dimensional vector v. */
-GLdouble vecLength(int dim, GLdouble v[]) { return sqrt(vecDot(dim, v, v)); }
+vecReal vecLength(int dim, vecReal v[]) { return sqrt(vecDot(dim, v, v)); }
 
 /* Returns the length of the dim-dimensional vector v. If the length is
 non-zero, then also places a scaled version of v into the dim-dimensional
 vector unit, so that unit has length 1. */
-GLdouble vecUnit(int dim, GLdouble v[], GLdouble unit[]) {
-  GLdouble len = vecLength(dim, v);
+vecReal vecUnit(int dim, vecReal v[], vecReal unit[]) {
+  vecReal len = vecLength(dim, v);
   if (len == 0.0) {
     return len;
   } else {
-    GLdouble frac = 1 / len;
+    vecReal frac = 1 / len;
     vecScale(dim, frac, v, unit);
     return len;
   }
@@ -82,7 +98,7 @@ GLdouble vecUnit(int dim, GLdouble v[], GLdouble unit[]) {
 
 /* Computes the cross product of the 3-dimensional vectors v and w, and places
 it into vCrossW. */
-void vec3Cross(GLdouble v[3], GLdouble w[3], GLdouble vCrossW[3]) {
+void vec3Cross(vecReal v[3], vecReal w[3], vecReal vCrossW[3]) {
   vCrossW[0] = (v[1] * w[2]) - (v[2] * w[1]);
   vCrossW[1] = (v[2] * w[0]) - (v[0] * w[2]);
   vCrossW[2] = (v[0] * w[1]) - (v[1] * w[0]);
@@ -91,8 +107,8 @@ void vec3Cross(GLdouble v[3], GLdouble w[3], GLdouble vCrossW[3]) {
 /* Computes the 3-dimensional vector v from its spherical coordinates.
 rho >= 0.0 is the radius. 0 <= phi <= pi is the co-latitude. -pi <= theta <= pi
 is the longitude or azimuth. */
-void vec3Spherical(GLdouble rho, GLdouble phi, GLdouble theta,
-                   GLdouble v[3]) {  // phi  = pi/2 , theta = pi
+void vec3Spherical(vecReal rho, vecReal phi, vecReal theta,
+                   vecReal v[3]) {  // phi  = pi/2 , theta = pi
   v[0] = rho * sin(phi) * cos(theta);
   v[1] = rho * sin(phi) * sin(theta);
   v[2] = rho * cos(phi);
@@ -100,6 +116,25 @@ void vec3Spherical(GLdouble rho, GLdouble phi, GLdouble theta,
 
 /*** OpenGL ***/
 
-void vecOpenGL(int dim, GLdouble v[], GLfloat openGL[]) {
+void vecOpenGL(int dim, vecReal v[], GLfloat openGL[]) {
   for (int i = 0; i < dim; i += 1) openGL[i] = v[i];
 }
+
+/* Loads the dim-dimensional vector v, where 1 <= dim <= 4, into the uniform at
+location. Unless vecReal is GLdouble, nothing is converted. */
+void vecUniform(GLint location, int dim, vecReal v[]) {
+#ifdef vecDOUBLE
+  GLfloat openGL[4];
+  vecOpenGL(dim, v, openGL);
+#else
+  GLfloat *openGL = v;
+#endif
+  if (dim == 1)
+    glUniform1fv(location, 1, openGL);
+  else if (dim == 2)
+    glUniform2fv(location, 1, openGL);
+  else if (dim == 3)
+    glUniform3fv(location, 1, openGL);
+  else if (dim == 4)
+    glUniform4fv(location, 1, openGL);
+}
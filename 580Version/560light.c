@@ -9,21 +9,21 @@
 except through accessor functions. */
 typedef struct lightLight lightLight;
 struct lightLight {
-	GLdouble translation[3];
-	GLdouble color[3];
-	GLdouble attenuation[3];
+	vecReal translation[3];
+	vecReal color[3];
+	vecReal attenuation[3];
 	GLuint lightType;
-	GLdouble rotation[3][3];
-	GLdouble spotAngle;
+	vecReal rotation[3][3];
+	vecReal spotAngle;
 };
 
 /* Sets the light's rotation. */
-void lightSetRotation(lightLight *light, GLdouble rot[3][3]) {
-	vecCopy(9, (GLdouble *)rot, (GLdouble *)(light->rotation));
+void lightSetRotation(lightLight *light, vecReal rot[3][3]) {
+	vecCopy(9, (vecReal *)rot, (vecReal *)(light->rotation));
 }
 
 /* Sets the light's translation. */
-void lightSetTranslation(lightLight *light, GLdouble transl[3]) {
+void lightSetTranslation(lightLight *light, vecReal transl[3]) {
 	vecCopy(3, transl, light->translation);
 }
 
@@ -33,19 +33,19 @@ void lightSetType(lightLight *light, GLuint lightType) {
 }
 
 /* Sets the light's RGB color. */
-void lightSetColor(lightLight *light, GLdouble rgb[3]) {
+void lightSetColor(lightLight *light, vecReal rgb[3]) {
 	vecCopy(3, rgb, light->color);
 }
 
 /* Sets the light's attenuation coefficients. The light intensity at distance d 
 from the light is 1 / (a0 + a1 d + a2 d^2) times whatever it would be 
 unattenuated. So, to deactivate attenuation, use values 1.0, 0.0, 0.0. */
-void lightSetAttenuation(lightLight *light, GLdouble atten[3]) {
+void lightSetAttenuation(lightLight *light, vecReal atten[3]) {
 	vecCopy(3, atten, light->attenuation);
 }
 
 /* Sets the full (not half) angle of a spot light. */
-void lightSetSpotAngle(lightLight *light, GLdouble fullAngle) {
+void lightSetSpotAngle(lightLight *light, vecReal fullAngle) {
 	light->spotAngle = fullAngle;
 }
 
@@ -53,10 +53,10 @@ void lightSetSpotAngle(lightLight *light, GLdouble fullAngle) {
 world coordinates position. From that position, the light shines in the 
 direction described by the spherical coordinates phi and theta (as in 
 vec3Spherical). */
-void lightShineFrom(lightLight *light, GLdouble position[3], GLdouble phi, 
-		GLdouble theta) {
-	GLdouble negZ[3], y[3];
-	GLdouble yStd[3] = {0.0, 1.0, 0.0}, negZStd[3] = {0.0, 0.0, -1.0};
+void lightShineFrom(lightLight *light, vecReal position[3], vecReal phi, 
+		vecReal theta) {
+	vecReal negZ[3], y[3];
+	vecReal yStd[3] = {0.0, 1.0, 0.0}, negZStd[3] = {0.0, 0.0, -1.0};
 	vec3Spherical(1.0, phi, theta, negZ);
 	vec3Spherical(1.0, M_PI / 2.0 - phi, theta + M_PI, y);
 	mat33BasisRotation(yStd, negZStd, y, negZ, light->rotation);
@@ -73,13 +73,10 @@ spot light angle. */
 void lightRender(lightLight *light, GLint positionLoc, GLint colorLoc, 
 		GLint attenLoc, GLint dirLoc, GLint cosLoc) {
 	GLfloat vec[3];
-	vecOpenGL(3, light->color, vec);
-	glUniform3fv(colorLoc, 1, vec);
+	vecUniform(colorLoc, 3, light->color);
 	if (light->lightType == lightOMNI || light->lightType == lightSPOT) {
-		vecOpenGL(3, light->translation, vec);
-		glUniform3fv(positionLoc, 1, vec);
-		vecOpenGL(3, light->attenuation, vec);
-		glUniform3fv(attenLoc, 1, vec);
+		vecUniform(positionLoc, 3, light->translation);
+		vecUniform(attenLoc, 3, light->attenuation);
 	}
 	if (light->lightType == lightDIRECTIONAL || light->lightType == lightSPOT) {
 		vec[0] = -light->rotation[0][2];
@@ -79,23 +79,23 @@ void handleKey(GLFWwindow *window, int key, int scancode, int action,
 		else if (key == GLFW_KEY_J)
 			camAddDistance(&cam, 0.5);
 		else if (key == GLFW_KEY_Y) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[1] += 1.0;
 			lightSetTranslation(&light, vec);
 		} else if (key == GLFW_KEY_H) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[1] -= 1.0;
 			lightSetTranslation(&light, vec);
 		}
 		else if (key == GLFW_KEY_T) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[0] += 1.0;
 			lightSetTranslation(&light, vec);
 		} else if (key == GLFW_KEY_G) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[0] -= 1.0;
 			lightSetTranslation(&light, vec);
@@ -124,7 +124,7 @@ int initializeScene(void) {
     		GL_REPEAT, GL_REPEAT) != 0)
     	return 5;
 	GLuint attrDims[3] = {3, 2, 3};
-    double zs[12][12] = {
+    vecReal zs[12][12] = {
 		{5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 20.0},
 		{5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 20.0, 25.0},
 		{5.0, 5.0, 10.0, 12.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 20.0, 25.0},
@@ -137,7 +137,7 @@ int initializeScene(void) {
 		{0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 20.0, 20.0},
 		{5.0, 5.0, 5.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 20.0, 20.0, 20.0},
 		{10.0, 10.0, 5.0, 5.0, 0.0, 0.0, 0.0, 5.0, 10.0, 15.0, 20.0, 25.0}};
-	double ws[12][12] = {
+	vecReal ws[12][12] = {
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
@@ -151,7 +151,7 @@ int initializeScene(void) {
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0}};
 	meshMesh mesh, meshLand;
-	if (meshInitializeLandscape(&meshLand, 12, 12, 5.0, (double *)zs) != 0)
+	if (meshInitializeLandscape(&meshLand, 12, 12, 5.0, (vecReal *)zs) != 0)
 		return 6;
 	if (meshInitializeDissectedLandscape(&mesh, &meshLand, M_PI / 3.0, 1) != 0)
 		return 7;
@@ -163,7 +163,7 @@ int initializeScene(void) {
 	if (meshInitializeDissectedLandscape(&mesh, &meshLand, M_PI / 3.0, 0) != 0)
 		return 8;
 	meshDestroy(&meshLand);
-	double *vert, normal[2];
+	vecReal *vert, normal[2];
 	for (int i = 0; i < mesh.vertNum; i += 1) {
 		vert = meshGetVertexPointer(&mesh, i);
 		normal[0] = -vert[6];
@@ -175,7 +175,7 @@ int initializeScene(void) {
 	meshGLVAOInitialize(&meshV, 0, attrLocs);
 	meshGLVAOInitialize(&meshV, 1, sdwProg.attrLocs);
 	meshDestroy(&mesh);
-	if (meshInitializeLandscape(&mesh, 12, 12, 5.0, (double *)ws) != 0)
+	if (meshInitializeLandscape(&mesh, 12, 12, 5.0, (vecReal *)ws) != 0)
 		return 9;
 	meshGLInitialize(&meshW, &mesh, 3, attrDims, 2);
 	meshGLVAOInitialize(&meshW, 0, attrLocs);
@@ -203,11 +203,11 @@ int initializeScene(void) {
 		return 13;
 	if (sceneInitialize(&nodeH, 3, 1, &meshH, &nodeV, NULL) != 0)
 		return 12;
-	GLdouble trans[3] = {40.0, 28.0, 5.0};
+	vecReal trans[3] = {40.0, 28.0, 5.0};
 	sceneSetTranslation(&nodeT, trans);
 	vecSet(3, trans, 0.0, 0.0, 7.0);
 	sceneSetTranslation(&nodeL, trans);
-	GLdouble unif[3] = {0.0, 0.0, 0.0};
+	vecReal unif[3] = {0.0, 0.0, 0.0};
 	sceneSetUniform(&nodeH, unif);
 	sceneSetUniform(&nodeV, unif);
 	sceneSetUniform(&nodeT, unif);
@@ -247,7 +247,7 @@ midway through, then does not properly deallocate all resources. But that's
 okay, because the program terminates almost immediately after this function
 returns. */
 int initializeCameraLight(void) {
-    GLdouble vec[3] = {30.0, 30.0, 5.0};
+    vecReal vec[3] = {30.0, 30.0, 5.0};
 	camSetControls(&cam, camPERSPECTIVE, M_PI / 6.0, 10.0, 768.0, 768.0, 100.0,
 		M_PI / 4.0, M_PI / 4.0, vec);
 	lightSetType(&light, lightSPOT);
@@ -362,7 +362,7 @@ int initializeShaderProgram(void) {
 }
 
 void render(void) {
-	GLdouble identity[4][4];
+	vecReal identity[4][4];
 	mat44Identity(identity);
 	/* Save the viewport transformation. */
 	GLint viewport[4];
@@ -380,9 +380,7 @@ void render(void) {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glUseProgram(program);
 	camRender(&cam, viewingLoc);
-	GLfloat vec[3];
-	vecOpenGL(3, cam.translation, vec);
-	glUniform3fv(camPosLoc, 1, vec);
+	vecUniform(camPosLoc, 3, cam.translation);
 	/* For each light, we have to connect it to the shader program, as always.
 	For each shadow-casting light, we must also connect its shadow map. */
 	lightRender(&light, lightPosLoc, lightColLoc, lightAttLoc, lightDirLoc,
@@ -21,7 +21,7 @@
 #include "580scene.c"
 #include "560light.c"
 
-GLdouble alpha = 0.0;
+vecReal alpha = 0.0;
 GLuint program;
 GLint attrLocs[3];
 GLint viewingLoc, modelingLoc;
@@ -111,11 +111,11 @@ int initializeScene(void) {
       0)
     return 6;
   /* Customize the uniforms. */
-  GLdouble trans[3] = {1.0, 0.0, 0.0};
+  vecReal trans[3] = {1.0, 0.0, 0.0};
   sceneSetTranslation(&childNode, trans);
   vecSet(3, trans, 0.0, 1.0, 0.0);
   sceneSetTranslation(&siblingNode, trans);
-  GLdouble unif[3] = {1.0, 1.0, 1.0};
+  vecReal unif[3] = {1.0, 1.0, 1.0};
 
   sceneSetTexture(&siblingNode, tex);
   sceneSetTexture(&childNode, tex);
@@ -124,9 +124,9 @@ int initializeScene(void) {
   sceneSetUniform(&childNode, unif);
   sceneSetUniform(&rootNode, unif);
 
-  GLdouble transl[3] = {3.0, 3.0, 3.0};
-  GLdouble rgb[3] = {1.0, 1.0, 1.0};
-  GLdouble atten[3] = {1.0, 0.0, 0.0};
+  vecReal transl[3] = {3.0, 3.0, 3.0};
+  vecReal rgb[3] = {1.0, 1.0, 1.0};
+  vecReal atten[3] = {1.0, 0.0, 0.0};
 
   lightSetType(&light, lightSPOT);
   lightSetTranslation(&light, transl);
@@ -229,13 +229,9 @@ void render(void) {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glUseProgram(program);
   camRender(&cam, viewingLoc);
-  GLdouble camPos[3];
-  vecCopy(3, cam.translation, camPos);
-  GLfloat camFloat[3];
-  vecOpenGL(3, camPos, camFloat);
-  glUniform3fv(camPosLoc, 1, camFloat);
+  vecUniform(camPosLoc, 3, cam.translation);
   /* This animation code is different from that in 520mainCamera.c. */
-  GLdouble rot[3][3], identity[4][4], axis[3] = {1.0, 1.0, 1.0};
+  vecReal rot[3][3], identity[4][4], axis[3] = {1.0, 1.0, 1.0};
   vecUnit(3, axis, axis);
   alpha += 0.01;
   mat33AngleAxisRotation(alpha, axis, rot);
@@ -292,7 +288,7 @@ int main(void) {
   if (initializeScene() != 0) return 4;
 
 
-  GLdouble target[3] = {0.0, 0.0, 0.0};
+  vecReal target[3] = {0.0, 0.0, 0.0};
   camSetControls(&cam, camPERSPECTIVE, M_PI / 6.0, 10.0, 512.0, 512.0, 10.0,
                  M_PI / 4.0, M_PI / 4.0, target);
   while (glfwWindowShouldClose(window) == 0) {
@@ -9,7 +9,7 @@ typedef struct meshMesh meshMesh;
 struct meshMesh {
   GLuint triNum, vertNum, attrDim;
   GLuint *tri;    /* triNum * 3 GLuints */
-  GLdouble *vert; /* vertNum * attrDim GLdoubles */
+  vecReal *vert; /* vertNum * attrDim numbers */
 };
 
 /* Initializes a mesh with enough memory to hold its triangles and vertices.
@@ -19,9 +19,9 @@ backing resources. */
 int meshInitialize(meshMesh *mesh, GLuint triNum, GLuint vertNum,
                    GLuint attrDim) {
   mesh->tri = (GLuint *)malloc(triNum * 3 * sizeof(GLuint) +
-                               vertNum * attrDim * sizeof(GLdouble));
+                               vertNum * attrDim * sizeof(vecReal));
   if (mesh->tri != NULL) {
-    mesh->vert = (GLdouble *)&(mesh->tri[triNum * 3]);
+    mesh->vert = (vecReal *)&(mesh->tri[triNum * 3]);
     mesh->triNum = triNum;
     mesh->vertNum = vertNum;
     mesh->attrDim = attrDim;
@@ -49,7 +49,7 @@ GLuint *meshGetTrianglePointer(meshMesh *mesh, GLuint tri) {
 }
 
 /* Sets the vertth vertex to have attributes attr. */
-void meshSetVertex(meshMesh *mesh, GLuint vert, GLdouble attr[]) {
+void meshSetVertex(meshMesh *mesh, GLuint vert, vecReal attr[]) {
   GLuint k;
   if (vert < mesh->vertNum)
     for (k = 0; k < mesh->attrDim; k += 1)
@@ -57,9 +57,9 @@ void meshSetVertex(meshMesh *mesh, GLuint vert, GLdouble attr[]) {
 }
 
 /* Returns a pointer to the vertth vertex. For example:
-        GLdouble *vertex13 = meshGetVertexPointer(&mesh, 13);
+        vecReal *vertex13 = meshGetVertexPointer(&mesh, 13);
         printf("x = %f, y = %f\n", vertex13[0], vertex13[1]); */
-GLdouble *meshGetVertexPointer(meshMesh *mesh, GLuint vert) {
+vecReal *meshGetVertexPointer(meshMesh *mesh, GLuint vert) {
   if (vert < mesh->vertNum)
     return &mesh->vert[vert * mesh->attrDim];
   else
@@ -102,9 +102,9 @@ void meshGLVAOInitialize(meshGLMesh *meshGL, GLuint index, GLint attrLocs[]) {
 
   for (GLuint i = 0; i < meshGL->attrNum; i++) {
     GLuint attrDim = meshGL->attrDims[i];
-    glVertexAttribPointer(attrLocs[i], attrDim, GL_DOUBLE, GL_FALSE,
-                          meshGL->attrDim * sizeof(GLdouble),
-                          BUFFER_OFFSET(offset_num * sizeof(GLdouble)));
+    glVertexAttribPointer(attrLocs[i], attrDim, vecGLTYPE, GL_FALSE,
+                          meshGL->attrDim * sizeof(vecReal),
+                          BUFFER_OFFSET(offset_num * sizeof(vecReal)));
 
     offset_num += attrDim;
   }
@@ -136,7 +136,7 @@ int meshGLInitialize(meshGLMesh *meshGL, meshMesh *mesh, GLuint attrNum,
     glGenBuffers(2, meshGL->buffers);
     glBindBuffer(GL_ARRAY_BUFFER, meshGL->buffers[0]);
     glBufferData(GL_ARRAY_BUFFER,
-        meshGL->vertNum * meshGL->attrDim * sizeof(GLdouble),
+        meshGL->vertNum * meshGL->attrDim * sizeof(vecReal),
         (GLvoid *)(mesh->vert), GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshGL->buffers[1]);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshGL->triNum * 3 * sizeof(GLuint),
@@ -170,13 +170,13 @@ void meshGLDestroy(meshGLMesh *meshGL) {
 /* Initializes a mesh to two triangles forming a rectangle of the given sides.
 The four attributes are X, Y, S, T. Do not call meshInitialize separately; it
 is called inside this function. Don't forget to call meshDestroy when done. */
-int meshInitializeRectangle(meshMesh *mesh, GLdouble left, GLdouble right,
-                            GLdouble bottom, GLdouble top) {
+int meshInitializeRectangle(meshMesh *mesh, vecReal left, vecReal right,
+                            vecReal bottom, vecReal top) {
   GLuint error = meshInitialize(mesh, 2, 4, 2 + 2);
   if (error == 0) {
     meshSetTriangle(mesh, 0, 0, 1, 2);
     meshSetTriangle(mesh, 1, 0, 2, 3);
-    GLdouble attr[4];
+    vecReal attr[4];
     vecSet(4, attr, left, bottom, 0.0, 0.0);
     meshSetVertex(mesh, 0, attr);
     vecSet(4, attr, right, bottom, 1.0, 0.0);
@@ -193,10 +193,10 @@ int meshInitializeRectangle(meshMesh *mesh, GLdouble left, GLdouble right,
 center (x, y) and radii rx, ry. The four attributes are X, Y, S, T. Do not call
 meshInitialize separately; it is called inside this function. Don't forget to
 call meshDestroy when done. */
-int meshInitializeEllipse(meshMesh *mesh, GLdouble x, GLdouble y, GLdouble rx,
-                          GLdouble ry, GLuint sideNum) {
+int meshInitializeEllipse(meshMesh *mesh, vecReal x, vecReal y, vecReal rx,
+                          vecReal ry, GLuint sideNum) {
   GLuint i, error;
-  GLdouble theta, cosTheta, sinTheta, attr[4] = {x, y, 0.5, 0.5};
+  vecReal theta, cosTheta, sinTheta, attr[4] = {x, y, 0.5, 0.5};
   error = meshInitialize(mesh, sideNum, sideNum + 1, 2 + 2);
   if (error == 0) {
     meshSetVertex(mesh, 0, attr);
@@ -218,9 +218,9 @@ int meshInitializeEllipse(meshMesh *mesh, GLdouble x, GLdouble y, GLdouble rx,
 /* Assumes that attributes 0, 1, 2 are XYZ. Assumes that the vertices of the
 triangle are in counter-clockwise order when viewed from 'outside' the
 triangle. Computes the outward-pointing unit normal vector for the triangle. */
-void meshTrueNormal(GLdouble a[], GLdouble b[], GLdouble c[],
-                    GLdouble normal[3]) {
-  GLdouble bMinusA[3], cMinusA[3];
+void meshTrueNormal(vecReal a[], vecReal b[], vecReal c[],
+                    vecReal normal[3]) {
+  vecReal bMinusA[3], cMinusA[3];
   vecSubtract(3, b, a, bMinusA);
   vecSubtract(3, c, a, cMinusA);
   vec3Cross(bMinusA, cMinusA, normal);
@@ -232,7 +232,7 @@ flat-shaded normals. If a vertex belongs to more than triangle, then some
 unspecified triangle's normal wins. */
 void meshFlatNormals(meshMesh *mesh, GLuint n) {
   GLuint i, *tri;
-  GLdouble *a, *b, *c, normal[3];
+  vecReal *a, *b, *c, normal[3];
   for (i = 0; i < mesh->triNum; i += 1) {
     tri = meshGetTrianglePointer(mesh, i);
     a = meshGetVertexPointer(mesh, tri[0]);
@@ -250,7 +250,7 @@ smooth-shaded normals. Does not do anything special to handle multiple vertices
 with the same coordinates. */
 void meshSmoothNormals(meshMesh *mesh, GLuint n) {
   GLuint i, *tri;
-  GLdouble *a, *b, *c, normal[3] = {0.0, 0.0, 0.0};
+  vecReal *a, *b, *c, normal[3] = {0.0, 0.0, 0.0};
   /* Zero the normals. */
   for (i = 0; i < mesh->vertNum; i += 1) {
     a = meshGetVertexPointer(mesh, i);
@@ -279,9 +279,9 @@ are XYZ position, ST texture, and NOP unit normal vector. The normals are
 discontinuous at the edges (flat shading, not smooth). To facilitate this, some
 vertices have equal XYZ but different NOP, for 24 vertices in all. Don't forget
 to meshDestroy when finished. */
-int meshInitializeBox(meshMesh *mesh, GLdouble left, GLdouble right,
-                      GLdouble bottom, GLdouble top, GLdouble base,
-                      GLdouble lid) {
+int meshInitializeBox(meshMesh *mesh, vecReal left, vecReal right,
+                      vecReal bottom, vecReal top, vecReal base,
+                      vecReal lid) {
   GLuint error = meshInitialize(mesh, 12, 24, 3 + 2 + 3);
   if (error == 0) {
     /* Make the triangles. */
@@ -298,7 +298,7 @@ int meshInitializeBox(meshMesh *mesh, GLdouble left, GLdouble right,
     meshSetTriangle(mesh, 10, 20, 21, 22);
     meshSetTriangle(mesh, 11, 20, 22, 23);
     /* Make the vertices after 0, using vertex 0 as temporary storage. */
-    GLdouble *v = mesh->vert;
+    vecReal *v = mesh->vert;
     vecSet(8, v, right, bottom, base, 1.0, 0.0, 0.0, 0.0, -1.0);
     meshSetVertex(mesh, 1, v);
     vecSet(8, v, right, top, base, 1.0, 1.0, 0.0, 0.0, -1.0);
@@ -353,10 +353,10 @@ int meshInitializeBox(meshMesh *mesh, GLdouble left, GLdouble right,
 
 /* Rotates a 2-dimensional vector through an angle. The input can safely alias
 the output. */
-void meshRotateVector(GLdouble theta, GLdouble v[2], GLdouble vRot[2]) {
-  GLdouble cosTheta = cos(theta);
-  GLdouble sinTheta = sin(theta);
-  GLdouble vRot0 = cosTheta * v[0] - sinTheta * v[1];
+void meshRotateVector(vecReal theta, vecReal v[2], vecReal vRot[2]) {
+  vecReal cosTheta = cos(theta);
+  vecReal sinTheta = sin(theta);
+  vecReal vRot0 = cosTheta * v[0] - sinTheta * v[1];
   vRot[1] = sinTheta * v[0] + cosTheta * v[1];
   vRot[0] = vRot0;
 }
@@ -369,8 +369,8 @@ should be in ascending or descending order. The sideNum parameter controls the
 fineness of the mesh. The attributes are XYZ position, ST texture, and NOP unit
 normal vector. The normals are smooth. Don't forget to meshDestroy when
 finished. */
-int meshInitializeRevolution(meshMesh *mesh, GLuint zNum, GLdouble z[],
-                             GLdouble r[], GLdouble t[], GLuint sideNum) {
+int meshInitializeRevolution(meshMesh *mesh, GLuint zNum, vecReal z[],
+                             vecReal r[], vecReal t[], GLuint sideNum) {
   GLuint i, j, error;
   error = meshInitialize(mesh, (zNum - 2) * sideNum * 2,
                          (zNum - 2) * (sideNum + 1) + 2, 3 + 2 + 3);
@@ -393,8 +393,8 @@ int meshInitializeRevolution(meshMesh *mesh, GLuint zNum, GLdouble z[],
             (j - 1) * (sideNum + 1) + 1 + i + 1, j * (sideNum + 1) + 1 + i + 1);
       }
     /* Make the vertices, using vertex 0 as temporary storage. */
-    GLdouble *v = mesh->vert;
-    GLdouble p[3], q[3], o[3];
+    vecReal *v = mesh->vert;
+    vecReal p[3], q[3], o[3];
     for (j = 1; j <= zNum - 2; j += 1) {
       // Form the sideNum + 1 vertices in the jth layer.
       vecSet(3, p, z[j + 1] - z[j], 0.0, r[j] - r[j + 1]);
@@ -427,17 +427,17 @@ int meshInitializeRevolution(meshMesh *mesh, GLuint zNum, GLdouble z[],
 and layerNum parameters control the fineness of the mesh. The attributes are
 XYZ position, ST texture, and NOP unit normal vector. The normals are smooth.
 Don't forget to meshDestroy when finished. */
-int meshInitializeSphere(meshMesh *mesh, GLdouble r, GLuint layerNum,
+int meshInitializeSphere(meshMesh *mesh, vecReal r, GLuint layerNum,
                          GLuint sideNum) {
   GLuint error, i;
-  GLdouble *ts = (GLdouble *)malloc((layerNum + 1) * 3 * sizeof(GLdouble));
+  vecReal *ts = (vecReal *)malloc((layerNum + 1) * 3 * sizeof(vecReal));
   if (ts == NULL)
     return 1;
   else {
-    GLdouble *zs = &ts[layerNum + 1];
-    GLdouble *rs = &ts[2 * layerNum + 2];
+    vecReal *zs = &ts[layerNum + 1];
+    vecReal *rs = &ts[2 * layerNum + 2];
     for (i = 0; i <= layerNum; i += 1) {
-      ts[i] = (GLdouble)i / layerNum;
+      ts[i] = (vecReal)i / layerNum;
       zs[i] = -r * cos(ts[i] * M_PI);
       rs[i] = r * sin(ts[i] * M_PI);
     }
@@ -452,27 +452,27 @@ origin, of radius r and length l > 2 * r. The sideNum and layerNum parameters
 control the fineness of the mesh. The attributes are XYZ position, ST texture,
 and NOP unit normal vector. The normals are smooth. Don't forget to meshDestroy
 when finished. */
-int meshInitializeCapsule(meshMesh *mesh, GLdouble r, GLdouble l,
+int meshInitializeCapsule(meshMesh *mesh, vecReal r, vecReal l,
                           GLuint layerNum, GLuint sideNum) {
   GLuint error, i;
-  GLdouble theta;
-  GLdouble *ts = (GLdouble *)malloc((6 * layerNum + 6) * sizeof(GLdouble));
+  vecReal theta;
+  vecReal *ts = (vecReal *)malloc((6 * layerNum + 6) * sizeof(vecReal));
   if (ts == NULL)
     return 1;
   else {
-    GLdouble *zs = &ts[2 * layerNum + 2];
-    GLdouble *rs = &ts[4 * layerNum + 4];
+    vecReal *zs = &ts[2 * layerNum + 2];
+    vecReal *rs = &ts[4 * layerNum + 4];
     zs[0] = -l / 2.0;
     rs[0] = 0.0;
     ts[0] = 0.0;
     for (i = 1; i <= layerNum; i += 1) {
-      theta = M_PI / 2.0 * (3 + i / (GLdouble)layerNum);
+      theta = M_PI / 2.0 * (3 + i / (vecReal)layerNum);
       zs[i] = -l / 2.0 + r + r * sin(theta);
       rs[i] = r * cos(theta);
       ts[i] = (zs[i] + l / 2.0) / l;
     }
     for (i = 0; i < layerNum; i += 1) {
-      theta = M_PI / 2.0 * i / (GLdouble)layerNum;
+      theta = M_PI / 2.0 * i / (vecReal)layerNum;
       zs[layerNum + 1 + i] = l / 2.0 - r + r * sin(theta);
       rs[layerNum + 1 + i] = r * cos(theta);
       ts[layerNum + 1 + i] = (zs[layerNum + 1 + i] + l / 2.0) / l;
@@ -487,6 +487,32 @@ int meshInitializeCapsule(meshMesh *mesh, GLdouble r, GLdouble l,
   }
 }
 
+/* The following functions return the geometric error of the meshes above,
+meaning how far, at most, the flat triangles stray from the smooth surface that
+they stand for, in the mesh's own units. A chain of levels of detail orders its
+meshes by this error (see sceneSetLODs). */
+
+/* Returns the error of meshInitializeRevolution around the Z-axis, where rMax
+is the largest r. The error along the curve itself depends on the curve, so
+that is up to the caller. */
+vecReal meshRevolutionError(vecReal rMax, GLuint sideNum) {
+  return rMax * (1.0 - cos(M_PI / sideNum));
+}
+
+/* Returns the error of meshInitializeSphere. Each layer spans M_PI / layerNum
+of the profile, and each side 2 * M_PI / sideNum around the axis. */
+vecReal meshSphereError(vecReal r, GLuint layerNum, GLuint sideNum) {
+  return fmax(r * (1.0 - cos(M_PI / (2.0 * layerNum))),
+              meshRevolutionError(r, sideNum));
+}
+
+/* Returns the error of meshInitializeCapsule, whose caps span M_PI / 2.0 of
+the profile in layerNum layers each. The cylinder itself is exact along Z. */
+vecReal meshCapsuleError(vecReal r, GLuint layerNum, GLuint sideNum) {
+  return fmax(r * (1.0 - cos(M_PI / (4.0 * layerNum))),
+              meshRevolutionError(r, sideNum));
+}
+
 /* Builds a non-closed 'landscape' mesh based on a grid of Z-values. There are
 width * height Z-values, which arrive in the data parameter. The mesh is made
 of (width - 1) * (height - 1) squares, each made of two triangles. The spacing
@@ -494,16 +520,16 @@ parameter controls the spacing of the X- and Y-coordinates of the vertices. The
 attributes are XYZ position, ST texture, and NOP unit normal vector. Don't
 forget to call meshDestroy when finished with the mesh. To understand the exact
 layout of the data, try this example code:
-GLdouble zs[3][4] = {
+vecReal zs[3][4] = {
         {10.0, 9.0, 7.0, 6.0},
         {6.0, 5.0, 3.0, 1.0},
         {4.0, 3.0, -1.0, -2.0}};
-int error = meshInitializeLandscape(&mesh, 3, 4, 20.0, (GLdouble *)zs); */
+int error = meshInitializeLandscape(&mesh, 3, 4, 20.0, (vecReal *)zs); */
 int meshInitializeLandscape(meshMesh *mesh, GLuint width, GLuint height,
-                            GLdouble spacing, GLdouble *data) {
+                            vecReal spacing, vecReal *data) {
   GLuint i, j, error;
   GLuint a, b, c, d;
-  GLdouble *vert, diffSWNE, diffSENW;
+  vecReal *vert, diffSWNE, diffSENW;
   error = meshInitialize(mesh, 2 * (width - 1) * (height - 1), width * height,
                          3 + 2 + 3);
   if (error == 0) {
@@ -547,10 +573,10 @@ more than angle. If noMoreThan is false, then triangles are kept that deviate
 from horizontal by more than angle. Don't forget to call meshDestroy when
 finished. Warning: May contain extraneous vertices not used by any triangle. */
 int meshInitializeDissectedLandscape(meshMesh *mesh, meshMesh *land,
-                                     GLdouble angle, GLuint noMoreThan) {
+                                     vecReal angle, GLuint noMoreThan) {
   GLuint error, i, j = 0, triNum = 0;
   GLuint *tri, *newTri;
-  GLdouble normal[3];
+  vecReal normal[3];
   /* Count the triangles that are nearly horizontal. */
   for (i = 0; i < land->triNum; i += 1) {
     tri = meshGetTrianglePointer(land, i);
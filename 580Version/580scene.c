@@ -1,4 +1,4 @@
-
+#include <string.h>
 
 /*** Creation and destruction ***/
 
@@ -6,23 +6,46 @@
 through the accessor functions. */
 typedef struct sceneNode sceneNode;
 struct sceneNode {
-  GLdouble rotation[3][3];
-  GLdouble translation[3];
+  vecReal rotation[3][3];
+  vecReal translation[3];
   GLuint unifDim;
-  GLdouble *unif;
+  vecReal *unif;
   meshGLMesh *meshGL;
   sceneNode *firstChild, *nextSibling;
   texTexture **tex;
   GLuint texNum;
+  /* An optional chain of levels of detail, finest first (see sceneSetLODs).
+  lod is the level chosen most recently, which meshGL points to, and lodCenter
+  is where, in the node's own coordinates, the distance is judged from. */
+  GLuint lodNum, lod;
+  meshGLMesh **lodMeshes;
+  vecReal *lodErrors;
+  vecReal lodCenter[3];
+  /* The modeling matrices, cached (see sceneUpdate): local from the rotation
+  and translation, and world from parent, the parent's world matrix, times
+  local. dirty is set when the rotation or translation changes. */
+  vecReal local[4][4], parent[4][4], world[4][4];
+  int dirty;
+  /* The node's place in the scene that it was last compiled into (see
+  sceneCompile), or -1. */
+  GLint index;
 };
 
+/* A level of detail is fine enough while its error covers at most this many
+pixels on screen. */
+#define sceneLODTOLERANCE 1.0
+/* A node only moves to a coarser level once that level's error falls to this
+fraction of the tolerance, so that a node near the boundary between two levels
+does not flip between them from frame to frame. */
+#define sceneLODHYSTERESIS 0.7
+
 /* Initializes a sceneNode struct. The translation and rotation are initialized
 to trivial values. The user must remember to call sceneDestroy or
 sceneDestroyRecursively when finished. Returns 0 if no error occurred. */
 int sceneInitialize(sceneNode *node, GLuint unifDim, GLuint texNum,
                     meshGLMesh *mesh, sceneNode *firstChild,
                     sceneNode *nextSibling) {
-  node->unif = (GLdouble *)malloc(unifDim * sizeof(GLdouble) +
+  node->unif = (vecReal *)malloc(unifDim * sizeof(vecReal) +
                                   texNum * sizeof(texTexture *));
   if (node->unif == NULL) return 1;
   node->tex = (texTexture **)&(node->unif[unifDim]);
@@ -33,6 +56,13 @@ int sceneInitialize(sceneNode *node, GLuint unifDim, GLuint texNum,
   node->firstChild = firstChild;
   node->nextSibling = nextSibling;
   node->texNum = texNum;
+  node->lodNum = 0;
+  node->lod = 0;
+  node->lodMeshes = NULL;
+  node->lodErrors = NULL;
+  vecSet(3, node->lodCenter, 0.0, 0.0, 0.0);
+  node->dirty = 1;
+  node->index = -1;
   return 0;
 }
 
@@ -41,17 +71,20 @@ resources backing the mesh, etc. */
 void sceneDestroy(sceneNode *node) {
   if (node->unif != NULL) free(node->unif);
   node->unif = NULL;
+  free(node->lodMeshes);
+  node->lodMeshes = NULL;
+  node->lodNum = 0;
 }
 
 /*** Accessors ***/
 
 /* Copies the unifDim-dimensional vector from unif into the node. */
-void sceneSetUniform(sceneNode *node, double unif[]) {
+void sceneSetUniform(sceneNode *node, vecReal unif[]) {
   vecCopy(node->unifDim, unif, node->unif);
 }
 
 /* Sets one uniform in the node, based on its index in the unif array. */
-void sceneSetOneUniform(sceneNode *node, int index, double unif) {
+void sceneSetOneUniform(sceneNode *node, int index, vecReal unif) {
   node->unif[index] = unif;
 }
 
@@ -67,27 +100,63 @@ void sceneSetOneTexture(sceneNode *node, int index, texTexture *tex) {
   node->tex[index] = tex;
 }
 
-/* Calls sceneDestroy recursively on the node's descendants and younger
-siblings, and then on the node itself. */
+/* Calls sceneDestroy on the node, its younger siblings, and their
+descendants. Only the descendants are reached by recursion, so that long lists
+of siblings do not make deep recursion. */
 void sceneDestroyRecursively(sceneNode *node) {
-  if (node->firstChild != NULL) sceneDestroyRecursively(node->firstChild);
-  if (node->nextSibling != NULL) sceneDestroyRecursively(node->nextSibling);
-  sceneDestroy(node);
+  while (node != NULL) {
+    sceneNode *next = node->nextSibling;
+    if (node->firstChild != NULL) sceneDestroyRecursively(node->firstChild);
+    sceneDestroy(node);
+    node = next;
+  }
 }
 
 /* Sets the node's rotation. */
-void sceneSetRotation(sceneNode *node, GLdouble rot[3][3]) {
-  vecCopy(9, (GLdouble *)rot, (GLdouble *)(node->rotation));
+void sceneSetRotation(sceneNode *node, vecReal rot[3][3]) {
+  vecCopy(9, (vecReal *)rot, (vecReal *)(node->rotation));
+  node->dirty = 1;
 }
 
 /* Sets the node's translation. */
-void sceneSetTranslation(sceneNode *node, GLdouble transl[3]) {
+void sceneSetTranslation(sceneNode *node, vecReal transl[3]) {
   vecCopy(3, transl, node->translation);
+  node->dirty = 1;
 }
 
 /* Sets the scene's mesh. */
 void sceneSetMesh(sceneNode *node, meshGLMesh *mesh) { node->meshGL = mesh; }
 
+/* Gives the node a chain of lodNum levels of detail, which replaces its mesh.
+The meshes are ordered finest first, and errors[l] is the geometric error of
+meshes[l] (see meshSphereError etc.), which must grow with l. The distance is
+judged from the node's origin, unless sceneSetLODCenter says otherwise. The
+pointers to the meshes are copied. The node starts at the finest
+level. Returns 0 if no error occurred. */
+int sceneSetLODs(sceneNode *node, GLuint lodNum, meshGLMesh *meshes[],
+                 vecReal errors[]) {
+  meshGLMesh **lodMeshes = (meshGLMesh **)malloc(
+      lodNum * sizeof(meshGLMesh *) + lodNum * sizeof(vecReal));
+  if (lodMeshes == NULL) return 1;
+  free(node->lodMeshes);
+  node->lodMeshes = lodMeshes;
+  node->lodErrors = (vecReal *)&lodMeshes[lodNum];
+  for (GLuint l = 0; l < lodNum; l++) {
+    node->lodMeshes[l] = meshes[l];
+    node->lodErrors[l] = errors[l];
+  }
+  node->lodNum = lodNum;
+  node->lod = 0;
+  node->meshGL = meshes[0];
+  return 0;
+}
+
+/* Sets where, in the node's own coordinates, sceneChooseLODs judges the
+node's distance from, typically the middle of its meshes. */
+void sceneSetLODCenter(sceneNode *node, vecReal center[3]) {
+  vecCopy(3, center, node->lodCenter);
+}
+
 /* Sets the node's first child. */
 void sceneSetFirstChild(sceneNode *node, sceneNode *child) {
   node->firstChild = child;
@@ -101,10 +170,9 @@ void sceneSetNextSibling(sceneNode *node, sceneNode *sibling) {
 /* Adds a sibling to the given node. The sibling shows up as the youngest of
 its siblings. */
 void sceneAddSibling(sceneNode *node, sceneNode *sibling) {
-  if (node->nextSibling == NULL)
-    node->nextSibling = sibling;
-  else
-    sceneAddSibling(node->nextSibling, sibling);
+  while (node->nextSibling != NULL)
+    node = node->nextSibling;
+  node->nextSibling = sibling;
 }
 
 /* Adds a child to the given node. The child shows up as the youngest of its
@@ -120,12 +188,10 @@ void sceneAddChild(sceneNode *node, sceneNode *child) {
 equality of pointers. If the sibling is not present, then has no effect (fails
 silently). */
 void sceneRemoveSibling(sceneNode *node, sceneNode *sibling) {
-  if (node->nextSibling == NULL)
-    return;
-  else if (node->nextSibling == sibling)
+  while (node->nextSibling != NULL && node->nextSibling != sibling)
+    node = node->nextSibling;
+  if (node->nextSibling == sibling)
     node->nextSibling = sibling->nextSibling;
-  else
-    sceneRemoveSibling(node->nextSibling, sibling);
 }
 
 /* Removes a child from the given node. Equality of nodes is assessed as
@@ -140,101 +206,347 @@ void sceneRemoveChild(sceneNode *node, sceneNode *child) {
     sceneRemoveSibling(node->firstChild, child);
 }
 
+/*** Rendering ***/
+
+/* Brings the node's cached modeling matrices up to date, given the parent's
+world matrix. local is worked out again only if the node is dirty, and world
+only if local or parent has changed, so that a node that has not moved, under
+a parent that has not moved, costs one comparison. */
+void sceneUpdate(sceneNode *node, vecReal parent[4][4]) {
+  int parentMoved = (memcmp(parent, node->parent, sizeof(node->parent)) != 0);
+  if (node->dirty)
+    mat44Isometry(node->rotation, node->translation, node->local);
+  if (node->dirty || parentMoved) {
+    mat44Copy(parent, node->parent);
+    mat444Multiply(parent, node->local, node->world);
+  }
+  node->dirty = 0;
+}
+
+/* Draws one node: loads its modeling matrix world into modelingLoc and its
+uniforms and textures as in sceneRender, and renders its mesh. */
+void sceneDraw(vecReal world[4][4], vecReal unif[], texTexture *tex[],
+               GLuint texNum, meshGLMesh *mesh, GLint modelingLoc,
+               GLuint unifNum, GLuint unifDims[], GLint unifLocs[],
+               GLuint vaoIndex, GLint textureLocs[]) {
+  mat44Uniform(modelingLoc, world);
+  GLuint offset_num = 0;
+  for (GLuint i = 0; i < unifNum; i++) {
+    vecUniform(unifLocs[i], unifDims[i], &unif[offset_num]);
+    offset_num = offset_num + unifDims[i];
+  }
+  for (GLuint i = 0; i < texNum; i++)
+    texRender(tex[i], GL_TEXTURE0 + i, i, textureLocs[i]);
+  meshGLRender(mesh, vaoIndex);
+  for (GLuint i = 0; i < texNum; i++)
+    texUnrender(tex[i], GL_TEXTURE0 + i);
+}
+
 /* Renders the node, its younger siblings, and their descendants. parent is the
 modeling matrix at the parent of the node. If the node has no parent, then this
 matrix is the 4x4 identity matrix. Loads the modeling transformation into
 modelingLoc. The attribute information exists to be passed to meshGLRender. The
-uniform information is analogous, but sceneRender loads it, not meshGLRender. */
-void sceneRender(sceneNode *node, GLdouble parent[4][4], GLint modelingLoc,
+uniform information is analogous, but sceneRender loads it, not meshGLRender.
+The modeling matrices come from sceneUpdate, so in every pass, shadow passes
+included, nodes that have not moved cost no matrix arithmetic. Only children
+are reached by recursion; siblings are walked in a loop. For large scenes, see
+sceneCompile. */
+void sceneRender(sceneNode *node, vecReal parent[4][4], GLint modelingLoc,
                  GLuint unifNum, GLuint unifDims[], GLint unifLocs[],
                  GLuint vaoIndex,
                  GLint textureLocs[]) {
-  /* Set the uniform modeling matrix. */
-
-  // printf("node->tex: %f,%f\n", node->tex[0]->openGL, node->tex[1]->openGL);
-
-  GLdouble model[4][4];
-  mat44Isometry(node->rotation, node->translation, model);
-  GLdouble iso[4][4];
-  mat444Multiply(parent, model, iso);
-  GLfloat unif_mat[4][4];
-  mat44OpenGL(iso, unif_mat);
-  glUniformMatrix4fv(modelingLoc, 1, GL_FALSE, (GLfloat *)unif_mat);
-  /* !! */
-  GLuint offset_num = 0;
-  /* Set the other uniforms. The casting from double to float is annoying. */
-  for (GLuint i = 0; i < unifNum; i++) {
-    GLuint unifDim = unifDims[i];
-    if (unifDim == 1) {
-      GLfloat values[1];
-      vecOpenGL(unifDim, &node->unif[offset_num], values);
-      glUniform1fv(unifLocs[i], 1, values);
-    } else if (unifDim == 2) {
-      GLfloat values[2];
-      vecOpenGL(unifDim, &node->unif[offset_num], values);
-      glUniform2fv(unifLocs[i], 1, values);
-    } else if (unifDim == 3) {
-      GLfloat values[3];
-      vecOpenGL(unifDim, &node->unif[offset_num], values);
-      glUniform3fv(unifLocs[i], 1, values);
-    } else if (unifDim == 4) {
-      GLfloat values[4];
-      vecOpenGL(unifDim, &node->unif[offset_num], values);
-      glUniform4fv(unifLocs[i], 1, values);
+  for (; node != NULL; node = node->nextSibling) {
+    sceneUpdate(node, parent);
+    sceneDraw(node->world, node->unif, node->tex, node->texNum, node->meshGL,
+              modelingLoc, unifNum, unifDims, unifLocs, vaoIndex, textureLocs);
+    if (node->firstChild != NULL)
+      sceneRender(node->firstChild, node->world, modelingLoc, unifNum,
+                  unifDims, unifLocs, vaoIndex, textureLocs);
+  }
+}
+
+/* Returns the level of detail, out of lodNum with the given errors, for a node
+whose modeling matrix is world and whose level was lod last time, judged at its
+center (see sceneChooseLODs). */
+GLuint sceneChooseLOD(vecReal world[4][4], vecReal center[3], GLuint lodNum,
+                      GLuint lod, vecReal errors[], camCamera *cam,
+                      vecReal height) {
+  /* How far in front of the camera the node's center is. */
+  vecReal depth = 0.0;
+  for (GLuint i = 0; i < 3; i++) {
+    vecReal point = world[i][3];
+    for (GLuint j = 0; j < 3; j++)
+      point += world[i][j] * center[j];
+    depth -= cam->rotation[i][2] * (point - cam->translation[i]);
+  }
+  vecReal span = cam->projection[camPROJT] - cam->projection[camPROJB];
+  if (cam->projectionType == camPERSPECTIVE && depth <= 0.0)
+    /* The camera is inside or past the node, so nothing can be spared. */
+    return 0;
+  vecReal pixels = height / span;
+  if (cam->projectionType == camPERSPECTIVE)
+    pixels *= -cam->projection[camPROJN] / depth;
+  while (lod > 0 && errors[lod] * pixels > sceneLODTOLERANCE)
+    lod -= 1;
+  while (lod + 1 < lodNum && errors[lod + 1] * pixels <=
+         sceneLODTOLERANCE * sceneLODHYSTERESIS)
+    lod += 1;
+  return lod;
+}
+
+/* Chooses the level of detail of the node, its younger siblings, and their
+descendants, from the camera, and points each node's mesh at it. parent is as
+in sceneRender, and height is the height of the viewport in pixels. Each node
+is judged at its center (see sceneSetLODCenter), assuming that the modeling
+transformations do not scale. The coarsest level whose error covers at most
+sceneLODTOLERANCE pixels is chosen, but with hysteresis toward the level chosen
+last time. Call this once per frame, before every pass that renders the scene,
+so that the passes agree. */
+void sceneChooseLODs(sceneNode *node, vecReal parent[4][4], camCamera *cam,
+                     vecReal height) {
+  for (; node != NULL; node = node->nextSibling) {
+    sceneUpdate(node, parent);
+    if (node->lodNum > 0) {
+      node->lod = sceneChooseLOD(node->world, node->lodCenter, node->lodNum,
+                                 node->lod, node->lodErrors, cam, height);
+      node->meshGL = node->lodMeshes[node->lod];
     }
-    offset_num = offset_num + unifDim;
+    if (node->firstChild != NULL)
+      sceneChooseLODs(node->firstChild, node->world, cam, height);
   }
-  /* !! */
-  /* Render the mesh, the children, and the younger siblings. */
+}
 
-  for (GLuint i = 0; i < node->texNum; i++) {
-    if (i == 0) {
-      texRender(node->tex[i], GL_TEXTURE0, i, textureLocs[i]);
-    } else if (i == 1) {
-      texRender(node->tex[i], GL_TEXTURE1, i, textureLocs[i]);
-    } else if (i == 2) {
-      texRender(node->tex[i], GL_TEXTURE2, i, textureLocs[i]);
-    } else if (i == 3) {
-      texRender(node->tex[i], GL_TEXTURE3, i, textureLocs[i]);
-    } else if (i == 4) {
-      texRender(node->tex[i], GL_TEXTURE4, i, textureLocs[i]);
-    } else if (i == 5) {
-      texRender(node->tex[i], GL_TEXTURE5, i, textureLocs[i]);
-    } else if (i == 6) {
-      texRender(node->tex[i], GL_TEXTURE6, i, textureLocs[i]);
-    } else if (i == 7) {
-      texRender(node->tex[i], GL_TEXTURE7, i, textureLocs[i]);
+
+
+/*** Compiled scenes ***/
+
+/* A scene flattened by sceneCompile into arrays with one entry per node, in
+breadth-first order, so that every node comes after its parent and siblings
+are next to each other. Rendering walks the arrays in one loop, without
+recursion or pointer chasing, which is what scenes of tens of thousands of
+nodes need. parent[k] is the index of node k's parent, or -1 for the roots,
+which are the compiled node and its younger siblings. The uniforms of node k
+are unif[unifStart[k]] through unif[unifStart[k + 1] - 1], and likewise its
+textures and its levels of detail. Feel free to read from this struct's
+members, but don't write to them except through the accessor functions. */
+typedef struct sceneCompiled sceneCompiled;
+struct sceneCompiled {
+  GLuint nodeNum;
+  GLint *parent;
+  vecReal (*rotation)[3][3], (*translation)[3];
+  vecReal (*local)[4][4], (*world)[4][4];
+  vecReal rootParent[4][4]; /* the roots' parent, as of the last update */
+  int rootValid;            /* whether rootParent has been set yet */
+  int *dirty;               /* whether local must be worked out again */
+  int *moved;               /* whether world changed in the last update */
+  meshGLMesh **meshGL;
+  GLuint *lod, *lodStart;
+  meshGLMesh **lodMeshes;
+  vecReal *lodErrors;
+  vecReal (*lodCenter)[3];
+  GLuint *unifStart, *texStart;
+  vecReal *unif;
+  texTexture **tex;
+};
+
+/* Appends the node and its younger siblings, with the given parent index, to
+the growing arrays nodes and parents, which hold num of cap entries. Returns 0
+if no error occurred. */
+int sceneGather(sceneNode ***nodes, GLint **parents, GLuint *num, GLuint *cap,
+                sceneNode *node, GLint parent) {
+  for (; node != NULL; node = node->nextSibling) {
+    if (*num == *cap) {
+      sceneNode **moreNodes = (sceneNode **)realloc(
+          *nodes, 2 * *cap * sizeof(sceneNode *));
+      if (moreNodes == NULL) return 1;
+      *nodes = moreNodes;
+      GLint *moreParents = (GLint *)realloc(*parents,
+                                            2 * *cap * sizeof(GLint));
+      if (moreParents == NULL) return 1;
+      *parents = moreParents;
+      *cap *= 2;
     }
+    (*nodes)[*num] = node;
+    (*parents)[*num] = parent;
+    *num += 1;
   }
-  meshGLRender(node->meshGL, vaoIndex);
-  for (GLuint i = 0; i < node->texNum; i++) {
-    if (i == 0) {
-      texUnrender(node->tex[i], GL_TEXTURE0);
-    } else if (i == 1) {
-      texUnrender(node->tex[i], GL_TEXTURE1);
-    } else if (i == 2) {
-      texUnrender(node->tex[i], GL_TEXTURE2);
-    } else if (i == 3) {
-      texUnrender(node->tex[i], GL_TEXTURE3);
-    } else if (i == 4) {
-      texUnrender(node->tex[i], GL_TEXTURE4);
-    } else if (i == 5) {
-      texUnrender(node->tex[i], GL_TEXTURE5);
-    } else if (i == 6) {
-      texUnrender(node->tex[i], GL_TEXTURE6);
-    } else if (i == 7) {
-      texUnrender(node->tex[i], GL_TEXTURE7);
+  return 0;
+}
+
+/* Compiles the node, its younger siblings, and their descendants into the
+scene, and sets each node's index to its place there. Everything but the
+meshes and textures themselves is copied, so the nodes may be changed or
+destroyed afterward without affecting the scene; to move a compiled node, use
+the sceneCompiledSet functions. Returns 0 if no error occurred. On success,
+the user must call sceneCompiledDestroy when finished with the scene. */
+int sceneCompile(sceneCompiled *scene, sceneNode *node) {
+  /* Gather the nodes breadth first. The gathered nodes are also the queue of
+  nodes whose children are still to be gathered, so no recursion is needed. */
+  GLuint num = 0, cap = 64, k, i;
+  sceneNode **nodes = (sceneNode **)malloc(cap * sizeof(sceneNode *));
+  GLint *parents = (GLint *)malloc(cap * sizeof(GLint));
+  int error = (nodes == NULL || parents == NULL);
+  if (!error)
+    error = sceneGather(&nodes, &parents, &num, &cap, node, -1);
+  for (k = 0; k < num && !error; k++)
+    error = sceneGather(&nodes, &parents, &num, &cap, nodes[k]->firstChild, k);
+  if (error) {
+    free(nodes);
+    free(parents);
+    return 1;
+  }
+
+  /* Allocate every array in one block: pointers first, then numbers, then
+  integers, so that each is aligned. */
+  GLuint unifNum = 0, texNum = 0, lodNum = 0;
+  for (k = 0; k < num; k++) {
+    unifNum += nodes[k]->unifDim;
+    texNum += nodes[k]->texNum;
+    lodNum += nodes[k]->lodNum;
+  }
+  char *block = (char *)malloc(
+      (num + lodNum) * sizeof(meshGLMesh *) + texNum * sizeof(texTexture *) +
+      (num * (9 + 3 + 16 + 16 + 3) + lodNum + unifNum) * sizeof(vecReal) +
+      num * sizeof(GLint) + 2 * num * sizeof(int) +
+      (num + 3 * (num + 1)) * sizeof(GLuint));
+  if (block == NULL) {
+    free(nodes);
+    free(parents);
+    return 1;
+  }
+  scene->nodeNum = num;
+  scene->meshGL = (meshGLMesh **)block;
+  scene->lodMeshes = &scene->meshGL[num];
+  scene->tex = (texTexture **)&scene->lodMeshes[lodNum];
+  scene->rotation = (vecReal (*)[3][3])&scene->tex[texNum];
+  scene->translation = (vecReal (*)[3])&scene->rotation[num];
+  scene->local = (vecReal (*)[4][4])&scene->translation[num];
+  scene->world = &scene->local[num];
+  scene->lodCenter = (vecReal (*)[3])&scene->world[num];
+  scene->lodErrors = (vecReal *)&scene->lodCenter[num];
+  scene->unif = &scene->lodErrors[lodNum];
+  scene->parent = (GLint *)&scene->unif[unifNum];
+  scene->dirty = (int *)&scene->parent[num];
+  scene->moved = &scene->dirty[num];
+  scene->lod = (GLuint *)&scene->moved[num];
+  scene->lodStart = &scene->lod[num];
+  scene->unifStart = &scene->lodStart[num + 1];
+  scene->texStart = &scene->unifStart[num + 1];
+
+  scene->lodStart[0] = 0;
+  scene->unifStart[0] = 0;
+  scene->texStart[0] = 0;
+  scene->rootValid = 0;
+  for (k = 0; k < num; k++) {
+    sceneNode *n = nodes[k];
+    n->index = k;
+    scene->parent[k] = parents[k];
+    vecCopy(9, (vecReal *)n->rotation, (vecReal *)scene->rotation[k]);
+    vecCopy(3, n->translation, scene->translation[k]);
+    scene->dirty[k] = 1;
+    scene->moved[k] = 0;
+    scene->meshGL[k] = n->meshGL;
+    scene->lod[k] = n->lod;
+    vecCopy(3, n->lodCenter, scene->lodCenter[k]);
+    for (i = 0; i < n->lodNum; i++) {
+      scene->lodMeshes[scene->lodStart[k] + i] = n->lodMeshes[i];
+      scene->lodErrors[scene->lodStart[k] + i] = n->lodErrors[i];
     }
+    vecCopy(n->unifDim, n->unif, &scene->unif[scene->unifStart[k]]);
+    for (i = 0; i < n->texNum; i++)
+      scene->tex[scene->texStart[k] + i] = n->tex[i];
+    scene->lodStart[k + 1] = scene->lodStart[k] + n->lodNum;
+    scene->unifStart[k + 1] = scene->unifStart[k] + n->unifDim;
+    scene->texStart[k + 1] = scene->texStart[k] + n->texNum;
   }
+  free(nodes);
+  free(parents);
+  return 0;
+}
+
+/* Deallocates the resources backing the compiled scene. Does not destroy the
+meshes or textures. */
+void sceneCompiledDestroy(sceneCompiled *scene) {
+  free(scene->meshGL);
+  scene->meshGL = NULL;
+  scene->nodeNum = 0;
+}
+
+/* Sets the rotation of the compiled node at the given index (see
+sceneNode's index). */
+void sceneCompiledSetRotation(sceneCompiled *scene, GLuint index,
+                              vecReal rot[3][3]) {
+  vecCopy(9, (vecReal *)rot, (vecReal *)scene->rotation[index]);
+  scene->dirty[index] = 1;
+}
+
+/* Sets the translation of the compiled node at the given index. */
+void sceneCompiledSetTranslation(sceneCompiled *scene, GLuint index,
+                                 vecReal transl[3]) {
+  vecCopy(3, transl, scene->translation[index]);
+  scene->dirty[index] = 1;
+}
 
-  if (node->firstChild != NULL) {
-    sceneRender(node->firstChild, iso, modelingLoc, unifNum, unifDims, unifLocs,
-                vaoIndex, textureLocs);
+/* Sets one uniform of the compiled node at the given index, based on its index
+in the node's unif array. */
+void sceneCompiledSetOneUniform(sceneCompiled *scene, GLuint index,
+                                int unifIndex, vecReal unif) {
+  scene->unif[scene->unifStart[index] + unifIndex] = unif;
+}
+
+/* Brings the world matrices up to date, with parent as the roots' parent, in
+one pass over the nodes. Each node comes after its parent, so a node's world
+matrix is worked out again, if at all, after its parent's. As with
+sceneUpdate, nodes that have not moved, under parents that have not moved, cost
+no matrix arithmetic. */
+void sceneCompiledUpdate(sceneCompiled *scene, vecReal parent[4][4]) {
+  int rootMoved = (!scene->rootValid ||
+                   memcmp(parent, scene->rootParent,
+                          sizeof(scene->rootParent)) != 0);
+  if (rootMoved) {
+    mat44Copy(parent, scene->rootParent);
+    scene->rootValid = 1;
+  }
+  for (GLuint k = 0; k < scene->nodeNum; k++) {
+    GLint up = scene->parent[k];
+    int moved = scene->dirty[k] || ((up < 0) ? rootMoved : scene->moved[up]);
+    if (scene->dirty[k]) {
+      mat44Isometry(scene->rotation[k], scene->translation[k],
+                    scene->local[k]);
+      scene->dirty[k] = 0;
+    }
+    if (moved)
+      mat444Multiply((up < 0) ? parent : scene->world[up], scene->local[k],
+                     scene->world[k]);
+    scene->moved[k] = moved;
   }
+}
 
-  if (node->nextSibling != NULL) {
-    sceneRender(node->nextSibling, parent, modelingLoc, unifNum, unifDims,
-                unifLocs, vaoIndex, textureLocs);
+/* Does what sceneChooseLODs does, for the compiled scene. */
+void sceneCompiledChooseLODs(sceneCompiled *scene, vecReal parent[4][4],
+                             camCamera *cam, vecReal height) {
+  sceneCompiledUpdate(scene, parent);
+  for (GLuint k = 0; k < scene->nodeNum; k++) {
+    GLuint lodNum = scene->lodStart[k + 1] - scene->lodStart[k];
+    if (lodNum > 0) {
+      scene->lod[k] = sceneChooseLOD(
+          scene->world[k], scene->lodCenter[k], lodNum, scene->lod[k],
+          &scene->lodErrors[scene->lodStart[k]], cam, height);
+      scene->meshGL[k] = scene->lodMeshes[scene->lodStart[k] + scene->lod[k]];
+    }
   }
-  /* !! */
+}
+
+/* Does what sceneRender does, for the compiled scene, in one loop over the
+nodes. */
+void sceneCompiledRender(sceneCompiled *scene, vecReal parent[4][4],
+                         GLint modelingLoc, GLuint unifNum, GLuint unifDims[],
+                         GLint unifLocs[], GLuint vaoIndex,
+                         GLint textureLocs[]) {
+  sceneCompiledUpdate(scene, parent);
+  for (GLuint k = 0; k < scene->nodeNum; k++)
+    sceneDraw(scene->world[k], &scene->unif[scene->unifStart[k]],
+              &scene->tex[scene->texStart[k]],
+              scene->texStart[k + 1] - scene->texStart[k], scene->meshGL[k],
+              modelingLoc, unifNum, unifDims, unifLocs, vaoIndex, textureLocs);
 }
@@ -22,17 +22,34 @@ double getTime(void) {
 #include "500shader.c"
 #include "530vector.c"
 #include "580mesh.c"
+#include "585simplify.c"
 #include "590matrix.c"
 #include "520camera.c"
 #include "540texture.c"
 #include "580scene.c"
 #include "560light.c"
 #include "590shadow.c"
+#include "595resolution.c"
 
 camCamera cam;
 texTexture texH, texV, texW, texT, texL;
-meshGLMesh meshH, meshV, meshW, meshT, meshL;
+meshGLMesh meshT;
+/* The landscape's and the water's levels of detail: the meshes themselves,
+and then simplified down to these many triangles. The landscape is simplified
+before it is cut into its horizontal and vertical parts, so that the parts
+still meet. */
+#define LANDLODNUM 3
+int landTriNums[LANDLODNUM] = {0, 120, 60};
+meshGLMesh meshH[LANDLODNUM], meshV[LANDLODNUM], meshW[LANDLODNUM];
+/* The leaves' levels of detail, finest first, each with this many layers and
+sides. */
+#define LODNUM 4
+GLuint lodLayers[LODNUM] = {8, 6, 4, 3}, lodSides[LODNUM] = {16, 12, 8, 6};
+meshGLMesh meshL[LODNUM];
 sceneNode nodeH, nodeV, nodeW, nodeT, nodeL;
+/* The nodes are built once and then compiled, and every pass renders the
+compiled scene. */
+sceneCompiled scene;
 /* We need just one shadow program, because all of our meshes have the same
 attribute structure. */
 shadowProgram sdwProg;
@@ -50,6 +67,9 @@ GLint lightPosLoc, lightColLoc, lightAttLoc, lightDirLoc, lightCosLoc;
 GLint lightPosLoc2, lightColLoc2, lightAttLoc2, lightDirLoc2, lightCosLoc2; //!!
 GLint camPosLoc;
 GLint viewingSdwLoc, textureSdwLoc, viewingSdwLoc2, textureSdwLoc2; //!!
+/* The scene is drawn offscreen, at a size that holds the frame rate. */
+resController res;
+resTarget resTgt;
 
 void handleError(int error, const char *description) {
 	fprintf(stderr, "handleError: %d\n%s\n", error, description);
@@ -58,6 +78,10 @@ void handleError(int error, const char *description) {
 void handleResize(GLFWwindow *window, int width, int height) {
     glViewport(0, 0, width, height);
 	camSetWidthHeight(&cam, width, height);
+	resSetWindowSize(&res, width, height);
+	resTargetDestroy(&resTgt);
+	if (resTargetInitialize(&resTgt, width, height) != 0)
+		glfwSetWindowShouldClose(window, 1);
 }
 
 void handleKey(GLFWwindow *window, int key, int scancode, int action,
@@ -82,23 +106,23 @@ void handleKey(GLFWwindow *window, int key, int scancode, int action,
 		else if (key == GLFW_KEY_J)
 			camAddDistance(&cam, 0.5);
 		else if (key == GLFW_KEY_Y) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[1] += 1.0;
 			lightSetTranslation(&light, vec);
 		} else if (key == GLFW_KEY_H) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[1] -= 1.0;
 			lightSetTranslation(&light, vec);
 		}
 		else if (key == GLFW_KEY_T) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[0] += 1.0;
 			lightSetTranslation(&light, vec);
 		} else if (key == GLFW_KEY_G) {
-			GLdouble vec[3];
+			vecReal vec[3];
 			vecCopy(3, light.translation, vec);
 			vec[0] -= 1.0;
 			lightSetTranslation(&light, vec);
@@ -127,7 +151,7 @@ int initializeScene(void) {
     		GL_REPEAT, GL_REPEAT) != 0)
     	return 5;
 	GLuint attrDims[3] = {3, 2, 3};
-    double zs[12][12] = {
+    vecReal zs[12][12] = {
 		{5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 20.0},
 		{5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 20.0, 25.0},
 		{5.0, 5.0, 10.0, 12.0, 5.0, 5.0, 5.0, 5.0, 5.0, 5.0, 20.0, 25.0},
@@ -140,7 +164,7 @@ int initializeScene(void) {
 		{0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 20.0, 20.0},
 		{5.0, 5.0, 5.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 20.0, 20.0, 20.0},
 		{10.0, 10.0, 5.0, 5.0, 0.0, 0.0, 0.0, 5.0, 10.0, 15.0, 20.0, 25.0}};
-	double ws[12][12] = {
+	vecReal ws[12][12] = {
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
@@ -153,64 +177,94 @@ int initializeScene(void) {
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0},
 		{1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0}};
-	meshMesh mesh, meshLand;
-	if (meshInitializeLandscape(&meshLand, 12, 12, 5.0, (double *)zs) != 0)
+	meshMesh mesh, lands[LANDLODNUM], waters[LANDLODNUM];
+	vecReal landErrors[LANDLODNUM], waterErrors[LANDLODNUM];
+	if (meshInitializeLandscape(&lands[0], 12, 12, 5.0, (vecReal *)zs) != 0 ||
+			simpInitializeChain(&lands[1], &landErrors[1], &lands[0],
+			LANDLODNUM - 1, &landTriNums[1]) != 0)
 		return 6;
-	if (meshInitializeDissectedLandscape(&mesh, &meshLand, M_PI / 3.0, 1) != 0)
-		return 7;
-	/* There are now two VAOs per mesh. */
-	meshGLInitialize(&meshH, &mesh, 3, attrDims, 2);
-	meshGLVAOInitialize(&meshH, 0, attrLocs);
-	meshGLVAOInitialize(&meshH, 1, sdwProg.attrLocs);
-	meshDestroy(&mesh);
-	if (meshInitializeDissectedLandscape(&mesh, &meshLand, M_PI / 3.0, 0) != 0)
-		return 8;
-	meshDestroy(&meshLand);
-	double *vert, normal[2];
-	for (int i = 0; i < mesh.vertNum; i += 1) {
-		vert = meshGetVertexPointer(&mesh, i);
-		normal[0] = -vert[6];
-		normal[1] = vert[5];
-		vert[3] = (vert[0] * normal[0] + vert[1] * normal[1]) / 20.0;
-		vert[4] = vert[2] / 20.0;
-	}
-	meshGLInitialize(&meshV, &mesh, 3, attrDims, 2);
-	meshGLVAOInitialize(&meshV, 0, attrLocs);
-	meshGLVAOInitialize(&meshV, 1, sdwProg.attrLocs);
-	meshDestroy(&mesh);
-	if (meshInitializeLandscape(&mesh, 12, 12, 5.0, (double *)ws) != 0)
+	if (meshInitializeLandscape(&waters[0], 12, 12, 5.0, (vecReal *)ws) != 0 ||
+			simpInitializeChain(&waters[1], &waterErrors[1], &waters[0],
+			LANDLODNUM - 1, &landTriNums[1]) != 0)
 		return 9;
-	meshGLInitialize(&meshW, &mesh, 3, attrDims, 2);
-	meshGLVAOInitialize(&meshW, 0, attrLocs);
-	meshGLVAOInitialize(&meshW, 1, sdwProg.attrLocs);
-	meshDestroy(&mesh);
+	landErrors[0] = 0.0;
+	waterErrors[0] = 0.0;
+	meshGLMesh *lodH[LANDLODNUM], *lodV[LANDLODNUM], *lodW[LANDLODNUM];
+	for (int l = 0; l < LANDLODNUM; l += 1) {
+		if (meshInitializeDissectedLandscape(&mesh, &lands[l], M_PI / 3.0, 1)
+				!= 0)
+			return 7;
+		/* There are now two VAOs per mesh. */
+		meshGLInitialize(&meshH[l], &mesh, 3, attrDims, 2);
+		meshGLVAOInitialize(&meshH[l], 0, attrLocs);
+		meshGLVAOInitialize(&meshH[l], 1, sdwProg.attrLocs);
+		meshDestroy(&mesh);
+		if (meshInitializeDissectedLandscape(&mesh, &lands[l], M_PI / 3.0, 0)
+				!= 0)
+			return 8;
+		meshDestroy(&lands[l]);
+		vecReal *vert, normal[2];
+		for (int i = 0; i < mesh.vertNum; i += 1) {
+			vert = meshGetVertexPointer(&mesh, i);
+			normal[0] = -vert[6];
+			normal[1] = vert[5];
+			vert[3] = (vert[0] * normal[0] + vert[1] * normal[1]) / 20.0;
+			vert[4] = vert[2] / 20.0;
+		}
+		meshGLInitialize(&meshV[l], &mesh, 3, attrDims, 2);
+		meshGLVAOInitialize(&meshV[l], 0, attrLocs);
+		meshGLVAOInitialize(&meshV[l], 1, sdwProg.attrLocs);
+		meshDestroy(&mesh);
+		meshGLInitialize(&meshW[l], &waters[l], 3, attrDims, 2);
+		meshGLVAOInitialize(&meshW[l], 0, attrLocs);
+		meshGLVAOInitialize(&meshW[l], 1, sdwProg.attrLocs);
+		meshDestroy(&waters[l]);
+		lodH[l] = &meshH[l];
+		lodV[l] = &meshV[l];
+		lodW[l] = &meshW[l];
+	}
 	if (meshInitializeCapsule(&mesh, 1.0, 10.0, 1, 8) != 0)
 		return 10;
 	meshGLInitialize(&meshT, &mesh, 3, attrDims, 2);
 	meshGLVAOInitialize(&meshT, 0, attrLocs);
 	meshGLVAOInitialize(&meshT, 1, sdwProg.attrLocs);
 	meshDestroy(&mesh);
-	if (meshInitializeSphere(&mesh, 5.0, 8, 16) != 0)
-		return 11;
-	meshGLInitialize(&meshL, &mesh, 3, attrDims, 2);
-	meshGLVAOInitialize(&meshL, 0, attrLocs);
-	meshGLVAOInitialize(&meshL, 1, sdwProg.attrLocs);
-	meshDestroy(&mesh);
-	if (sceneInitialize(&nodeW, 3, 1, &meshW, NULL, NULL) != 0)
+	meshGLMesh *lodMeshes[LODNUM];
+	vecReal lodErrors[LODNUM];
+	for (int l = 0; l < LODNUM; l += 1) {
+		if (meshInitializeSphere(&mesh, 5.0, lodLayers[l], lodSides[l]) != 0)
+			return 11;
+		meshGLInitialize(&meshL[l], &mesh, 3, attrDims, 2);
+		meshGLVAOInitialize(&meshL[l], 0, attrLocs);
+		meshGLVAOInitialize(&meshL[l], 1, sdwProg.attrLocs);
+		meshDestroy(&mesh);
+		lodMeshes[l] = &meshL[l];
+		lodErrors[l] = meshSphereError(5.0, lodLayers[l], lodSides[l]);
+	}
+	if (sceneInitialize(&nodeW, 3, 1, lodW[0], NULL, NULL) != 0 ||
+			sceneSetLODs(&nodeW, LANDLODNUM, lodW, waterErrors) != 0)
 		return 14;
-	if (sceneInitialize(&nodeL, 3, 1, &meshL, NULL, NULL) != 0)
+	if (sceneInitialize(&nodeL, 3, 1, lodMeshes[0], NULL, NULL) != 0 ||
+			sceneSetLODs(&nodeL, LODNUM, lodMeshes, lodErrors) != 0)
 		return 16;
 	if (sceneInitialize(&nodeT, 3, 1, &meshT, &nodeL, &nodeW) != 0)
 		return 15;
-	if (sceneInitialize(&nodeV, 3, 1, &meshV, NULL, &nodeT) != 0)
+	if (sceneInitialize(&nodeV, 3, 1, lodV[0], NULL, &nodeT) != 0 ||
+			sceneSetLODs(&nodeV, LANDLODNUM, lodV, landErrors) != 0)
 		return 13;
-	if (sceneInitialize(&nodeH, 3, 1, &meshH, &nodeV, NULL) != 0)
+	if (sceneInitialize(&nodeH, 3, 1, lodH[0], &nodeV, NULL) != 0 ||
+			sceneSetLODs(&nodeH, LANDLODNUM, lodH, landErrors) != 0)
 		return 12;
-	GLdouble trans[3] = {40.0, 28.0, 5.0};
+	/* Judge the landscape's distance from the middle of its grid. */
+	vecReal center[3] = {27.5, 27.5, 0.0};
+	sceneSetLODCenter(&nodeH, center);
+	sceneSetLODCenter(&nodeV, center);
+	sceneSetLODCenter(&nodeW, center);
+	vecReal trans[3] = {40.0, 28.0, 5.0};
 	sceneSetTranslation(&nodeT, trans);
 	vecSet(3, trans, 0.0, 0.0, 7.0);
 	sceneSetTranslation(&nodeL, trans);
-	GLdouble unif[3] = {0.0, 0.0, 0.0};
+	vecReal unif[3] = {0.0, 0.0, 0.0};
 	sceneSetUniform(&nodeH, unif);
 	sceneSetUniform(&nodeV, unif);
 	sceneSetUniform(&nodeT, unif);
@@ -228,7 +282,7 @@ int initializeScene(void) {
 	sceneSetTexture(&nodeT, &tex);
 	tex = &texL;
 	sceneSetTexture(&nodeL, &tex);
-	return 0;
+	return sceneCompile(&scene, &nodeH);
 }
 
 void destroyScene(void) {
@@ -237,11 +291,15 @@ void destroyScene(void) {
 	texDestroy(&texW);
 	texDestroy(&texT);
 	texDestroy(&texL);
-	meshGLDestroy(&meshH);
-	meshGLDestroy(&meshV);
-	meshGLDestroy(&meshW);
+	for (int l = 0; l < LANDLODNUM; l += 1) {
+		meshGLDestroy(&meshH[l]);
+		meshGLDestroy(&meshV[l]);
+		meshGLDestroy(&meshW[l]);
+	}
 	meshGLDestroy(&meshT);
-	meshGLDestroy(&meshL);
+	for (int l = 0; l < LODNUM; l += 1)
+		meshGLDestroy(&meshL[l]);
+	sceneCompiledDestroy(&scene);
 	sceneDestroyRecursively(&nodeH);
 }
 
@@ -250,7 +308,7 @@ midway through, then does not properly deallocate all resources. But that's
 okay, because the program terminates almost immediately after this function
 returns. */
 int initializeCameraLight(void) {
-    GLdouble vec[3] = {30.0, 30.0, 5.0};
+    vecReal vec[3] = {30.0, 30.0, 5.0};
 	camSetControls(&cam, camPERSPECTIVE, M_PI / 6.0, 10.0, 768.0, 768.0, 100.0,
 		M_PI / 4.0, M_PI / 4.0, vec);
 	lightSetType(&light, lightSPOT);
@@ -415,32 +473,30 @@ int initializeShaderProgram(void) {
 }
 
 void render(void) {
-	GLdouble identity[4][4];
+	vecReal identity[4][4];
 	mat44Identity(identity);
-	/* Save the viewport transformation. */
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	/* Choose the levels of detail from the camera, once for all of the passes,
+	so that the shadows match what is drawn. */
+	sceneCompiledChooseLODs(&scene, identity, &cam, res.renderHeight);
 	/* For each shadow-casting light, render its shadow map using minimal
 	uniforms and textures. */
 	GLint sdwTextureLocs[1] = {-1};
 	GLint sdw2TextureLocs[1] = {-1}; //!!!!
 	shadowMapRender(&sdwMap, &sdwProg, &light, -100.0, -1.0);
-	sceneRender(&nodeH, identity, sdwProg.modelingLoc, 0, NULL, NULL, 1,
-		sdwTextureLocs);
+	sceneCompiledRender(&scene, identity, sdwProg.modelingLoc, 0, NULL, NULL,
+		1, sdwTextureLocs);
 	shadowMapUnrender(); //!!!!
 	shadowMapRender(&sdwMap2, &sdwProg, &light2, -100.0, -1.0); //!!
-	sceneRender(&nodeH, identity, sdwProg.modelingLoc, 0, NULL, NULL, 1,
-		sdw2TextureLocs); //!!
-	/* Finish preparing the shadow maps, restore the viewport, and begin to
-	render the scene. */
+	sceneCompiledRender(&scene, identity, sdwProg.modelingLoc, 0, NULL, NULL,
+		1, sdw2TextureLocs); //!!
+	/* Finish preparing the shadow maps, and begin to render the scene, into
+	the offscreen target at the size that the controller chose. */
 	shadowMapUnrender();
-	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	resTargetRender(&resTgt, &res);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glUseProgram(program);
 	camRender(&cam, viewingLoc);
-	GLfloat vec[3];
-	vecOpenGL(3, cam.translation, vec);
-	glUniform3fv(camPosLoc, 1, vec);
+	vecUniform(camPosLoc, 3, cam.translation);
 	/* For each light, we have to connect it to the shader program, as always.
 	For each shadow-casting light, we must also connect its shadow map. */
 	lightRender(&light, lightPosLoc, lightColLoc, lightAttLoc, lightDirLoc,
@@ -450,11 +506,13 @@ void render(void) {
 		lightCosLoc2); //!!
 	shadowRender(&sdwMap2, viewingSdwLoc2, GL_TEXTURE8, 8, textureSdwLoc2); //!!
 	GLuint unifDims[1] = {3};
-	sceneRender(&nodeH, identity, modelingLoc, 1, unifDims, unifLocs, 0,
-		textureLocs);
+	sceneCompiledRender(&scene, identity, modelingLoc, 1, unifDims, unifLocs,
+		0, textureLocs);
 	/* For each shadow-casting light, turn it off when finished rendering. */
 	shadowUnrender(GL_TEXTURE7);
 	shadowUnrender(GL_TEXTURE8); //!!
+	/* Stretch the scene over the window. */
+	resTargetUnrender(&resTgt, &res);
 }
 
 int main(void) {
@@ -497,13 +555,19 @@ int main(void) {
     /* Initialize the shadow mapping before the meshes. Why? */
 	if (initializeCameraLight() != 0)
 		return 4;
+	/* Hold 60 frames/sec, drawing anywhere from half to full size. */
+	resInitialize(&res, 768, 768, 1.0 / 60.0, 0.5, 1.0);
+	if (resTargetInitialize(&resTgt, 768, 768) != 0)
+		return 6;
     if (initializeScene() != 0)
     	return 5;
     while (glfwWindowShouldClose(window) == 0) {
     	oldTime = newTime;
     	newTime = getTime();
     	if (floor(newTime) - floor(oldTime) >= 1.0)
-			fprintf(stderr, "main: %f frames/sec\n", 1.0 / (newTime - oldTime));
+			fprintf(stderr, "main: %f frames/sec, drawing %d x %d\n",
+				1.0 / (newTime - oldTime), res.renderWidth, res.renderHeight);
+		resUpdate(&res, newTime - oldTime);
 		render();
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -511,6 +575,7 @@ int main(void) {
     /* Deallocate more resources than ever. */
     shadowProgramDestroy(&sdwProg);
     shadowMapDestroy(&sdwMap);
+    resTargetDestroy(&resTgt);
 		shadowMapDestroy(&sdwMap2); //!!
     glDeleteProgram(program);
     destroyScene();
@@ -9,15 +9,15 @@ given in any order.
 /*** 2 x 2 Matrices ***/
 
 /* Pretty-prints the given matrix, with one line of text per row of matrix. */
-void mat22Print(GLdouble m[2][2]) {
+void mat22Print(vecReal m[2][2]) {
   for (int i = 0; i < 2; i += 1) printf("%f    %f\n", m[i][0], m[i][1]);
 }
 
 /* Returns the determinant of the matrix m. If the determinant is 0.0, then the
 matrix is not invertible, and mInv is untouched. If the determinant is not 0.0,
 then the matrix is invertible, and its inverse is placed into mInv. */
-GLdouble mat22Invert(GLdouble m[2][2], GLdouble mInv[2][2]) {
-  GLdouble deter = (m[0][0] * m[1][1]) - (m[0][1] * m[1][0]);
+vecReal mat22Invert(vecReal m[2][2], vecReal mInv[2][2]) {
+  vecReal deter = (m[0][0] * m[1][1]) - (m[0][1] * m[1][0]);
   if (deter == 0.0)
     return deter;
   else {
@@ -31,13 +31,13 @@ GLdouble mat22Invert(GLdouble m[2][2], GLdouble mInv[2][2]) {
 
 /* Multiplies a 2x2 matrix m by a 2-column v, storing the result in mTimesV.
 The output should not */
-void mat221Multiply(GLdouble m[2][2], GLdouble v[2], GLdouble mTimesV[2]) {
+void mat221Multiply(vecReal m[2][2], vecReal v[2], vecReal mTimesV[2]) {
   mTimesV[0] = (v[0] * m[0][0]) + (v[1] * m[0][1]);
   mTimesV[1] = (v[0] * m[1][0]) + (v[1] * m[1][1]);
 }
 
 /* Fills the matrix m from its two columns. */
-void mat22Columns(GLdouble col0[2], GLdouble col1[2], GLdouble m[2][2]) {
+void mat22Columns(vecReal col0[2], vecReal col1[2], vecReal m[2][2]) {
   m[0][0] = col0[0];
   m[1][0] = col0[1];
   m[0][1] = col1[0];
@@ -46,7 +46,7 @@ void mat22Columns(GLdouble col0[2], GLdouble col1[2], GLdouble m[2][2]) {
 
 /*** 3 x 3 Matrices ***/
 
-void mat33Transpose(GLdouble m[3][3], GLdouble m_T[3][3]) {
+void mat33Transpose(vecReal m[3][3], vecReal m_T[3][3]) {
   for (int i = 0; i < 3; i++) {
     for (int j = 0; j < 3; j++) {
       m_T[i][j] = m[j][i];
@@ -55,8 +55,8 @@ void mat33Transpose(GLdouble m[3][3], GLdouble m_T[3][3]) {
 }
 
 /* Multiplies the 3x3 matrix m by the 3x3 matrix n. */
-void mat333Multiply(GLdouble m[3][3], GLdouble n[3][3],
-                    GLdouble mTimesN[3][3]) {
+void mat333Multiply(vecReal m[3][3], vecReal n[3][3],
+                    vecReal mTimesN[3][3]) {
   for (int i = 0; i < 3; i++) {
     for (int j = 0; j < 3; j++) {
       mTimesN[i][j] = m[i][0] * n[0][j] + m[i][1] * n[1][j] + m[i][2] * n[2][j];
@@ -65,7 +65,7 @@ void mat333Multiply(GLdouble m[3][3], GLdouble n[3][3],
 }
 
 /* Multiplies the 3x3 matrix m by the 3x1 matrix v. */
-void mat331Multiply(GLdouble m[3][3], GLdouble v[3], GLdouble mTimesV[3]) {
+void mat331Multiply(vecReal m[3][3], vecReal v[3], vecReal mTimesV[3]) {
   for (int i = 0; i < 3; i++) {
     mTimesV[i] = m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2];
   }
@@ -75,10 +75,10 @@ void mat331Multiply(GLdouble m[3][3], GLdouble v[3], GLdouble mTimesV[3]) {
 coordinates. More precisely, the transformation first rotates through the angle
 theta (in radians, counterclockwise), and then translates by the vector (x, y).
 */
-void mat33Isometry(GLdouble theta, GLdouble x, GLdouble y,
-                   GLdouble isom[3][3]) {
-  GLdouble s = sin(theta);
-  GLdouble c = cos(theta);
+void mat33Isometry(vecReal theta, vecReal x, vecReal y,
+                   vecReal isom[3][3]) {
+  vecReal s = sin(theta);
+  vecReal c = cos(theta);
 
   isom[0][0] = c;
   isom[0][1] = (-1) * s;
@@ -94,10 +94,10 @@ void mat33Isometry(GLdouble theta, GLdouble x, GLdouble y,
 /* Given a length-1 3D vector axis and an angle theta (in radians), builds the
 rotation matrix for the rotation about that axis through that angle. Based on
 Rodrigues' rotation formula R = I + (sin theta) U + (1 - cos theta) U^2. */
-void mat33AngleAxisRotation(GLdouble theta, GLdouble axis[3],
-                            GLdouble rot[3][3]) {
-  GLdouble U[3][3];
-  GLdouble Usq[3][3];
+void mat33AngleAxisRotation(vecReal theta, vecReal axis[3],
+                            vecReal rot[3][3]) {
+  vecReal U[3][3];
+  vecReal Usq[3][3];
 
   U[0][0] = 0.0;
   U[0][1] = (-1) * axis[2];
@@ -109,7 +109,7 @@ void mat33AngleAxisRotation(GLdouble theta, GLdouble axis[3],
   U[2][1] = axis[0];
   U[2][2] = 0.0;
 
-  GLdouble I[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+  vecReal I[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
 
   mat333Multiply(U, U, Usq);
 
@@ -124,12 +124,12 @@ void mat33AngleAxisRotation(GLdouble theta, GLdouble axis[3],
 /* Given two length-1 3D vectors u, v that are perpendicular to each other.
 Given two length-1 3D vectors a, b that are perpendicular to each other. Builds
 the rotation matrix that rotates u to a and v to b. */
-void mat33BasisRotation(GLdouble u[3], GLdouble v[3], GLdouble a[3],
-                        GLdouble b[3], GLdouble rot[3][3]) {
-  GLdouble R[3][3];
-  GLdouble S[3][3];
+void mat33BasisRotation(vecReal u[3], vecReal v[3], vecReal a[3],
+                        vecReal b[3], vecReal rot[3][3]) {
+  vecReal R[3][3];
+  vecReal S[3][3];
 
-  GLdouble uDotv[3];
+  vecReal uDotv[3];
   vec3Cross(u, v, uDotv);
 
   for (int i = 0; i < 3; i++) {
@@ -144,7 +144,7 @@ void mat33BasisRotation(GLdouble u[3], GLdouble v[3], GLdouble a[3],
     R[i][2] = uDotv[i];
   }
 
-  GLdouble aDotb[3];
+  vecReal aDotb[3];
   vec3Cross(a, b, aDotb);
 
   for (int i = 0; i < 3; i++) {
@@ -159,7 +159,7 @@ void mat33BasisRotation(GLdouble u[3], GLdouble v[3], GLdouble a[3],
     S[i][2] = aDotb[i];
   }
 
-  GLdouble R_T[3][3];
+  vecReal R_T[3][3];
 
   for (int i = 0; i < 3; i++) {
     for (int j = 0; j < 3; j++) {
@@ -170,7 +170,7 @@ void mat33BasisRotation(GLdouble u[3], GLdouble v[3], GLdouble a[3],
   mat333Multiply(S, R_T, rot);
 }
 
-void mat33Identity(GLdouble m[3][3]) {
+void mat33Identity(vecReal m[3][3]) {
   m[0][0] = 1.0;
   m[0][1] = 0.0;
   m[0][2] = 0.0;
@@ -182,7 +182,7 @@ void mat33Identity(GLdouble m[3][3]) {
   m[2][2] = 1.0;
 }
 
-void mat44Identity(GLdouble m[4][4]) {
+void mat44Identity(vecReal m[4][4]) {
   m[0][0] = 1.0;
   m[0][1] = 0.0;
   m[0][2] = 0.0;
@@ -202,18 +202,31 @@ void mat44Identity(GLdouble m[4][4]) {
 }
 
 /* We want to pass matrices into OpenGL, but there are two obstacles. First,
-our matrix library uses GLdouble matrices, but OpenGL 2.x expects GLfloat
-matrices. Second, C matrices are implicitly stored one-row-after-another, while
-OpenGL expects matrices to be stored one-column-after-another. This function
-plows through both of those obstacles. */
-void mat44OpenGL(GLdouble m[4][4], GLfloat openGL[4][4]) {
+our matrix library may use GLdouble matrices (see vecReal), but OpenGL 2.x
+expects GLfloat matrices. Second, C matrices are implicitly stored
+one-row-after-another, while OpenGL expects matrices to be stored
+one-column-after-another. This function plows through both of those
+obstacles. */
+void mat44OpenGL(vecReal m[4][4], GLfloat openGL[4][4]) {
   for (int i = 0; i < 4; i += 1)
     for (int j = 0; j < 4; j += 1) openGL[i][j] = m[j][i];
 }
 
+/* Loads m into the uniform matrix at location. Unless vecReal is GLdouble,
+nothing is converted: OpenGL is asked to take m one-row-after-another. */
+void mat44Uniform(GLint location, vecReal m[4][4]) {
+#ifdef vecDOUBLE
+  GLfloat openGL[4][4];
+  mat44OpenGL(m, openGL);
+  glUniformMatrix4fv(location, 1, GL_FALSE, (GLfloat *)openGL);
+#else
+  glUniformMatrix4fv(location, 1, GL_TRUE, (GLfloat *)m);
+#endif
+}
+
 /* Multiplies m by n, placing the answer in mTimesN. */
-void mat444Multiply(GLdouble m[4][4], GLdouble n[4][4],
-                    GLdouble mTimesN[4][4]) {
+void mat444Multiply(vecReal m[4][4], vecReal n[4][4],
+                    vecReal mTimesN[4][4]) {
   for (int i = 0; i < 4; i++) {
     for (int j = 0; j < 4; j++) {
       mTimesN[i][j] = m[i][0] * n[0][j] + m[i][1] * n[1][j] +
@@ -223,7 +236,7 @@ void mat444Multiply(GLdouble m[4][4], GLdouble n[4][4],
 }
 
 /* Multiplies m by v, placing the answer in mTimesV. */
-void mat441Multiply(GLdouble m[4][4], GLdouble v[4], GLdouble mTimesV[4]) {
+void mat441Multiply(vecReal m[4][4], vecReal v[4], vecReal mTimesV[4]) {
   for (int i = 0; i < 4; i++) {
     mTimesV[i] =
         m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2] + m[i][3] * v[3];
@@ -232,7 +245,7 @@ void mat441Multiply(GLdouble m[4][4], GLdouble v[4], GLdouble mTimesV[4]) {
 
 /* Given a rotation and a translation, forms the 4x4 homogeneous matrix
 representing the rotation followed in time by the translation. */
-void mat44Isometry(GLdouble rot[3][3], GLdouble trans[3], GLdouble isom[4][4]) {
+void mat44Isometry(vecReal rot[3][3], vecReal trans[3], vecReal isom[4][4]) {
   for (int i = 0; i < 3; i++) {
     for (int j = 0; j < 3; j++) {
       isom[i][j] = rot[i][j];
@@ -249,13 +262,13 @@ void mat44Isometry(GLdouble rot[3][3], GLdouble trans[3], GLdouble isom[4][4]) {
 }
 
 /* Pretty-prints the given matrix, with one line of text per row of matrix. */
-void mat44Print(GLdouble m[4][4]) {
+void mat44Print(vecReal m[4][4]) {
   for (int i = 0; i < 4; i += 1)
     printf("%f    %f		%f		%f\n", m[i][0], m[i][1],
            m[i][2], m[i][3]);
 }
 
-void mat33Print(GLdouble m[3][3]) {
+void mat33Print(vecReal m[3][3]) {
   printf("**************\n");
   for (int i = 0; i < 3; i += 1)
     printf("%f    %f		%f\n", m[i][0], m[i][1], m[i][2]);
@@ -265,9 +278,9 @@ void mat33Print(GLdouble m[3][3]) {
 representing the inverse translation followed in time by the inverse rotation.
 That is, the isom produced by this function is the inverse to the isom
 produced by mat44Isometry on the same inputs. */
-void mat44InverseIsometry(GLdouble rot[3][3], GLdouble trans[3],
-                          GLdouble isom[4][4]) {
-  GLdouble rot_T[3][3];
+void mat44InverseIsometry(vecReal rot[3][3], vecReal trans[3],
+                          vecReal isom[4][4]) {
+  vecReal rot_T[3][3];
   mat33Transpose(rot, rot_T);
 
   for (int i = 0; i < 3; i++) {
@@ -288,7 +301,7 @@ void mat44InverseIsometry(GLdouble rot[3][3], GLdouble trans[3],
   isom[3][3] = 1.0;
 }
 
-void mat44Copy(GLdouble input[4][4], GLdouble copy[4][4]) {
+void mat44Copy(vecReal input[4][4], vecReal copy[4][4]) {
   for (int i = 0; i < 4; i++) {
     for (int j = 0; j < 4; j++) {
       copy[i][j] = input[i][j];
@@ -301,9 +314,9 @@ volume [left, right] x [bottom, top] x [far, near]. That is, on the near plane
 the box is the rectangle R = [left, right] x [bottom, top], and on the far
 plane the box is the same rectangle R. Keep in mind that 0 > near > far. Maps
 the viewing volume to [-1, 1] x [-1, 1] x [-1, 1]. */
-void mat44Orthographic(GLdouble left, GLdouble right, GLdouble bottom,
-                       GLdouble top, GLdouble far, GLdouble near,
-                       GLdouble proj[4][4]) {
+void mat44Orthographic(vecReal left, vecReal right, vecReal bottom,
+                       vecReal top, vecReal far, vecReal near,
+                       vecReal proj[4][4]) {
   proj[0][0] = 2.0 / (right - left);
   proj[0][1] = 0.0;
   proj[0][2] = 0.0;
@@ -325,7 +338,7 @@ void mat44Orthographic(GLdouble left, GLdouble right, GLdouble bottom,
 
 /* Builds a 4x4 matrix that maps a projected viewing volume
 [-1, 1] x [-1, 1] x [-1, 1] to screen [0, w - 1] x [0, h - 1] x [-1, 1]. */
-void mat44Viewport(GLdouble width, GLdouble height, GLdouble view[4][4]) {
+void mat44Viewport(vecReal width, vecReal height, vecReal view[4][4]) {
   view[0][0] = (width - 1.0) / 2.0;
   view[0][1] = 0.0;
   view[0][2] = 0.0;
@@ -349,9 +362,9 @@ is contained between the near and far planes, with 0 > near > far. On the near
 plane, the frustum is the rectangle R = [left, right] x [bottom, top]. On the
 far plane, the frustum is the rectangle (far / near) * R. Maps the viewing
 volume to [-1, 1] x [-1, 1] x [-1, 1]. */
-void mat44Perspective(GLdouble left, GLdouble right, GLdouble bottom,
-                      GLdouble top, GLdouble far, GLdouble near,
-                      GLdouble proj[4][4]) {
+void mat44Perspective(vecReal left, vecReal right, vecReal bottom,
+                      vecReal top, vecReal far, vecReal near,
+                      vecReal proj[4][4]) {
   proj[0][0] = (-2.0 * near) / (right - left);
   proj[0][1] = 0.0;
   proj[0][2] = (right + left) / (right - left);
@@ -131,7 +131,7 @@ void shadowMapDestroy(shadowMap *map) {
 
 /* Prepares a shadow map for rendering into it. */
 void shadowMapRender(shadowMap *map, shadowProgram *prog, lightLight *light,
-		GLdouble far, GLdouble near) {
+		vecReal far, vecReal near) {
 	glViewport(0, 0, map->width, map->height);
 	glBindFramebuffer(GL_FRAMEBUFFER, map->fbo);
 	glClear(GL_DEPTH_BUFFER_BIT);
@@ -141,8 +141,8 @@ void shadowMapRender(shadowMap *map, shadowProgram *prog, lightLight *light,
 	height matters --- not width and height. */
 	camSetRotation(&(map->camera), light->rotation);
 	camSetTranslation(&(map->camera), light->translation);
-	GLdouble focal = sqrt(near * far);
-	GLdouble ratio = -far / focal;
+	vecReal focal = sqrt(near * far);
+	vecReal ratio = -far / focal;
 	camSetFrustum(&(map->camera), camPERSPECTIVE, light->spotAngle, focal,
 		ratio, 1.0, 1.0);
 	camRender(&(map->camera), prog->viewingLoc);
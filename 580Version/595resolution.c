@@ -0,0 +1,170 @@
+/* A dynamic resolution controller for the OpenGL path, the same one as in
+160Version/220resolution.c. The scene is drawn into an offscreen target, at a
+scale of the window's size that the controller adjusts from frame to frame, to
+hold the frame time near a target. The target is then stretched over the window
+with bilinear filtering. Heavy frames thus cost fewer fragments, instead of
+dropping the frame rate. */
+
+/*** Controller ***/
+
+/* The frame time is averaged with this weight on each new frame. */
+#define resSMOOTHING 0.2
+/* Averages within this fraction of the target are on target, so that the
+scale does not hunt back and forth. */
+#define resDEADBAND 0.1
+/* The scale changes by at most this fraction per change, and then waits
+resSETTLE frames for the average to catch up before changing again. */
+#define resSTEP 0.1
+#define resSETTLE 4
+/* Render sizes are multiples of this many pixels. */
+#define resALIGN 8
+
+/* Feel free to read from this struct's members, but don't alter them. */
+typedef struct resController resController;
+struct resController {
+	GLint width, height;				/* the window's */
+	GLint renderWidth, renderHeight;	/* what to draw this frame */
+	GLdouble scale, minScale, maxScale;
+	GLdouble target;					/* seconds per frame */
+	GLdouble average;					/* smoothed seconds per frame, or 0.0 */
+	int settle;							/* frames to wait before the next change */
+};
+
+/* Rounds width * scale to a multiple of resALIGN, but at least resALIGN and at
+most width. */
+GLint resAlign(GLint width, GLdouble scale) {
+	GLint aligned = (GLint)(width * scale / resALIGN + 0.5) * resALIGN;
+	if (aligned < resALIGN)
+		aligned = resALIGN;
+	return (aligned > width) ? width : aligned;
+}
+
+/* Initializes the controller for a window of the given size, to hold frames
+near target seconds, by scaling each side of the window between minScale and
+maxScale (at most 1.0). It starts at maxScale. */
+void resInitialize(resController *res, GLint width, GLint height,
+		GLdouble target, GLdouble minScale, GLdouble maxScale) {
+	res->width = width;
+	res->height = height;
+	res->target = target;
+	res->minScale = minScale;
+	res->maxScale = (maxScale > 1.0) ? 1.0 : maxScale;
+	res->scale = res->maxScale;
+	res->average = 0.0;
+	res->settle = 0;
+	res->renderWidth = resAlign(width, res->scale);
+	res->renderHeight = resAlign(height, res->scale);
+}
+
+/* Feeds the controller the time, in seconds, that the latest frame took, and
+works out the size at which to draw the next one. A frame's cost is roughly
+proportional to its fragments, which go as the square of the scale, so the
+scale moves by the square root of the ratio of the target to the average.
+Returns 1 if the size changed and 0 if not. */
+int resUpdate(resController *res, GLdouble frameTime) {
+	GLint width = res->renderWidth, height = res->renderHeight;
+	if (res->average == 0.0)
+		res->average = frameTime;
+	else
+		res->average += resSMOOTHING * (frameTime - res->average);
+	if (res->settle > 0) {
+		res->settle -= 1;
+		return 0;
+	}
+	GLdouble ratio = res->target / res->average;
+	if (ratio > 1.0 - resDEADBAND && ratio < 1.0 + resDEADBAND)
+		return 0;
+	GLdouble scale = res->scale * sqrt(ratio);
+	scale = fmax(res->scale * (1.0 - resSTEP),
+		fmin(res->scale * (1.0 + resSTEP), scale));
+	res->scale = fmax(res->minScale, fmin(res->maxScale, scale));
+	res->renderWidth = resAlign(res->width, res->scale);
+	res->renderHeight = resAlign(res->height, res->scale);
+	if (res->renderWidth == width && res->renderHeight == height)
+		return 0;
+	res->settle = resSETTLE;
+	return 1;
+}
+
+/* Sets the window's size, for instance after the window is resized, and
+resizes the rendering to match at the current scale. */
+void resSetWindowSize(resController *res, GLint width, GLint height) {
+	res->width = width;
+	res->height = height;
+	res->renderWidth = resAlign(width, res->scale);
+	res->renderHeight = resAlign(height, res->scale);
+}
+
+
+
+/*** Offscreen target ***/
+
+/* Feel free to read from this struct's members, but don't alter them. */
+typedef struct resTarget resTarget;
+struct resTarget {
+	GLint width, height;
+	GLuint texture, depth, fbo;
+};
+
+/* Creates an offscreen target with color and depth, as large as the largest
+size that will be drawn, typically the window's size. Returns 0 on success,
+non-zero on failure. On success, the user must call resTargetDestroy when
+finished with the target. */
+int resTargetInitialize(resTarget *target, GLint width, GLint height) {
+	target->width = width;
+	target->height = height;
+	/* The color goes to a texture, filtered bilinearly when it is stretched. */
+	glGenTextures(1, &(target->texture));
+	glBindTexture(GL_TEXTURE_2D, target->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+		GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	/* The depth is never read, so it can be a renderbuffer. */
+	glGenRenderbuffers(1, &(target->depth));
+	glBindRenderbuffer(GL_RENDERBUFFER, target->depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &(target->fbo));
+	glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target->texture,
+		0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+		GL_RENDERBUFFER, target->depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr,
+			"resTargetInitialize: glCheckFramebufferStatus: %d\n", status);
+		return 1;
+	}
+	return 0;
+}
+
+/* Deallocates the resources backing the target. */
+void resTargetDestroy(resTarget *target) {
+	glDeleteFramebuffers(1, &(target->fbo));
+	glDeleteRenderbuffers(1, &(target->depth));
+	glDeleteTextures(1, &(target->texture));
+}
+
+/* Prepares the target for rendering into it, at the controller's size, which
+must fit in the target. */
+void resTargetRender(resTarget *target, const resController *res) {
+	glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+	glViewport(0, 0, res->renderWidth, res->renderHeight);
+}
+
+/* Stretches what was drawn into the target over the whole window, with
+bilinear filtering, and goes back to rendering into the window. */
+void resTargetUnrender(resTarget *target, const resController *res) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, res->renderWidth, res->renderHeight, 0, 0,
+		res->width, res->height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, res->width, res->height);
+}